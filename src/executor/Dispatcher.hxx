@@ -35,6 +35,7 @@
 #ifndef _EXECUTOR_DISPATCHER_HXX_
 #define _EXECUTOR_DISPATCHER_HXX_
 
+#include <algorithm>
 #include <vector>
 
 #include "executor/Notifiable.hxx"
@@ -46,6 +47,11 @@
    invoked.
 
    Handlers are called in no particular order.
+
+   For non-negated matching the dispatcher keeps an index of the handlers
+   grouped by mask and sorted by the masked identifier, so that each incoming
+   message only has to look at the handlers that match it. Fully masked
+   (exact match) handlers form a single group.
  */
 template <int NUM_PRIO>
 class DispatchFlowBase : public UntypedStateFlow<QList<NUM_PRIO>>
@@ -110,6 +116,11 @@ protected:
      */
     virtual void send_transfer() = 0;
 
+    /** Sends the current message to lastHandlerToCall_ after all other
+     * handlers have been served. The default implementation transfers the
+     * ownership of the message. @return next action. */
+    virtual Action send_last();
+
     /*typedef typename StateFlow<MessageType, QList<NUM_PRIO>>::Callback Callback;
     using StateFlow<MessageType, QList<NUM_PRIO>>::again;
     using StateFlow<MessageType, QList<NUM_PRIO>>::allocate_and_call;
@@ -141,7 +152,7 @@ protected:
 private:
     /// true if this flow should negate the match condition.
     bool negateMatch_;
-    template<class T>
+    template<class T, int N>
     friend class GenericHubFlow;
 
     /// Internal information we store about each registered handler:
@@ -172,10 +183,77 @@ private:
         }
     };
 
+    /// One entry of the handler index.
+    struct IndexEntry
+    {
+        /// Identifier bits of the handler, masked with the group's mask.
+        ID key;
+        /// Index of the handler in handlers_.
+        unsigned slot;
+
+        /// Sorting order of the index. @param o is the other entry. @return
+        /// true if this entry comes first.
+        bool operator<(const IndexEntry &o) const
+        {
+            return key < o.key || (key == o.key && slot < o.slot);
+        }
+    };
+
+    /// All handlers that are registered with the same mask.
+    struct MaskGroup
+    {
+        /// The mask of the handlers in this group.
+        ID mask;
+        /// Handlers of this group sorted by key, then slot.
+        vector<IndexEntry> entries;
+    };
+
+    /// Adds a handler to the index. Must be called with lock_ held. @param
+    /// slot is the index of the handler in handlers_.
+    void index_add_locked(unsigned slot);
+
+    /// Removes a handler from the index. Must be called with lock_ held and
+    /// before the handler is cleared. @param slot is the index of the handler
+    /// in handlers_.
+    void index_remove_locked(unsigned slot);
+
+    /// Fills candidates_ with the slots of the handlers that match an
+    /// identifier, in increasing order. Must be called with lock_ held.
+    /// @param id is the identifier of the incoming message.
+    void lookup_locked(ID id);
+
+    /// @return the number of handler slots to iterate through for the
+    /// current message. Must be called with lock_ held.
+    size_t num_candidates()
+    {
+        return negateMatch_ ? handlers_.size() : candidates_.size();
+    }
+
+    /// @return the index in handlers_ of a given iteration position, or
+    /// handlers_.size() if the slot does not exist anymore. Must be called
+    /// with lock_ held. @param pos is the iteration position.
+    size_t candidate_slot(size_t pos)
+    {
+        if (negateMatch_)
+        {
+            return pos;
+        }
+        size_t slot = candidates_[pos];
+        return slot < handlers_.size() ? slot : handlers_.size();
+    }
+
     /// Registered handlers.
     vector<HandlerInfo> handlers_;
 
-    /// Index of the next handler to look at.
+    /// Index of the registered handlers, one entry per distinct mask. Not used
+    /// with negateMatch_.
+    vector<MaskGroup> index_;
+
+    /// Slots of the handlers that may match the current message.
+    vector<unsigned> candidates_;
+
+    /// Iteration position for the current message (index into candidates_,
+    /// or into handlers_ with negateMatch_).
     size_t currentIndex_;
 
 protected:
@@ -350,6 +428,83 @@ void DispatchFlowBase<NUM_PRIO>::register_handler(UntypedHandler *handler,
     handlers_[idx].handler = handler;
     handlers_[idx].id = id;
     handlers_[idx].mask = mask;
+    index_add_locked(idx);
+}
+
+template<int NUM_PRIO>
+void DispatchFlowBase<NUM_PRIO>::index_add_locked(unsigned slot)
+{
+    const HandlerInfo &h = handlers_[slot];
+    auto g = index_.begin();
+    while (g != index_.end() && g->mask != h.mask)
+    {
+        ++g;
+    }
+    if (g == index_.end())
+    {
+        index_.emplace_back();
+        g = index_.end() - 1;
+        g->mask = h.mask;
+    }
+    IndexEntry e;
+    e.key = h.id & h.mask;
+    e.slot = slot;
+    g->entries.insert(
+        std::lower_bound(g->entries.begin(), g->entries.end(), e), e);
+}
+
+template<int NUM_PRIO>
+void DispatchFlowBase<NUM_PRIO>::index_remove_locked(unsigned slot)
+{
+    const HandlerInfo &h = handlers_[slot];
+    for (auto g = index_.begin(); g != index_.end(); ++g)
+    {
+        if (g->mask != h.mask)
+        {
+            continue;
+        }
+        IndexEntry e;
+        e.key = h.id & h.mask;
+        e.slot = slot;
+        auto it = std::lower_bound(g->entries.begin(), g->entries.end(), e);
+        HASSERT(it != g->entries.end() && it->slot == slot);
+        g->entries.erase(it);
+        if (g->entries.empty())
+        {
+            index_.erase(g);
+        }
+        return;
+    }
+    DIE("Handler missing from the dispatcher index.");
+}
+
+template<int NUM_PRIO>
+void DispatchFlowBase<NUM_PRIO>::lookup_locked(ID id)
+{
+    candidates_.clear();
+    unsigned groups = 0;
+    for (auto &g : index_)
+    {
+        IndexEntry e;
+        e.key = id & g.mask;
+        e.slot = 0;
+        size_t before = candidates_.size();
+        for (auto it =
+                 std::lower_bound(g.entries.begin(), g.entries.end(), e);
+             it != g.entries.end() && it->key == e.key; ++it)
+        {
+            candidates_.push_back(it->slot);
+        }
+        if (candidates_.size() > before)
+        {
+            ++groups;
+        }
+    }
+    if (groups > 1)
+    {
+        // Keeps the registration order across different masks.
+        std::sort(candidates_.begin(), candidates_.end());
+    }
 }
 
 template<int NUM_PRIO>
@@ -370,6 +525,7 @@ DispatchFlowBase<NUM_PRIO>::unregister_handler(UntypedHandler *handler,
     if (lastHandlerToCall_ == handlers_[idx].handler) {
         lastHandlerToCall_ = nullptr;
     }
+    index_remove_locked(idx);
     handlers_[idx].handler = nullptr;
     if (idx == handlers_.size() - 1)
     {
@@ -386,6 +542,7 @@ void DispatchFlowBase<NUM_PRIO>::unregister_handler_all(
     {
         if (handlers_[i].handler == handler)
         {
+            index_remove_locked(i);
             handlers_[i].handler = nullptr;
         }
     }
@@ -400,6 +557,11 @@ StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::entry()
 {
     currentIndex_ = 0;
     lastHandlerToCall_ = nullptr;
+    if (!negateMatch_)
+    {
+        OSMutexLock l(&lock_);
+        lookup_locked(get_message_id());
+    }
     return call_immediately(STATE(iterate));
 }
 
@@ -407,13 +569,19 @@ template<int NUM_PRIO>
 StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::iterate()
 {
     ID id = get_message_id();
+    bool done;
     {
         // @todo(balazs.racz) make the registered handlers structure for the
         // dispatcher lock-free. This mutex here is very expensive.
         OSMutexLock l(&lock_);
-        for (; currentIndex_ < handlers_.size(); ++currentIndex_)
+        for (; currentIndex_ < num_candidates(); ++currentIndex_)
         {
-            auto &h = handlers_[currentIndex_];
+            size_t slot = candidate_slot(currentIndex_);
+            if (slot >= handlers_.size())
+            {
+                continue;
+            }
+            auto &h = handlers_[slot];
             if (!h.handler)
             {
                 continue;
@@ -430,13 +598,14 @@ StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::iterate()
             if (!lastHandlerToCall_)
             {
                 // This was the first we found.
-                lastHandlerToCall_ = handlers_[currentIndex_].handler;
+                lastHandlerToCall_ = h.handler;
                 continue;
             }            
             break;
         }
+        done = currentIndex_ >= num_candidates();
     }
-    if (currentIndex_ >= handlers_.size())
+    if (done)
     {
         return iteration_done();
     }
@@ -448,7 +617,14 @@ StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::iterate()
 template<int NUM_PRIO>
 StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::clone_done()
 {
-    lastHandlerToCall_ = handlers_[currentIndex_].handler;
+    {
+        OSMutexLock l(&lock_);
+        size_t slot = currentIndex_ < num_candidates()
+            ? candidate_slot(currentIndex_)
+            : handlers_.size();
+        lastHandlerToCall_ =
+            slot < handlers_.size() ? handlers_[slot].handler : nullptr;
+    }
     ++currentIndex_;
     return call_immediately(STATE(iterate));
 }
@@ -458,9 +634,16 @@ StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::iteration_done()
 {
     if (lastHandlerToCall_)
     {
-        send_transfer();
+        return send_last();
     }
     return release_and_exit();
 }
 
+template<int NUM_PRIO>
+StateFlowBase::Action DispatchFlowBase<NUM_PRIO>::send_last()
+{
+    send_transfer();
+    return release_and_exit();
+}
+
 #endif // _EXECUTOR_DISPATCHER_HXX_
@@ -36,6 +36,7 @@
 #define _EXECUTOR_EXECUTABLE_HXX_
 
 #include "executor/Notifiable.hxx"
+#include "openmrn_features.h"
 #include "utils/QMember.hxx"
 
 /// An object that can be scheduled on an executor to run.
@@ -64,6 +65,20 @@ public:
     {
         HASSERT(0 && "unexpected call to alloc_result");
     }
+
+    /// @return the object that this executable belongs to. A multi-threaded
+    /// executor (@ref ExecutorPool) never runs two executables with the same
+    /// key concurrently. The default is the executable itself.
+    virtual const void *affinity_key()
+    {
+        return this;
+    }
+
+#if OPENMRN_FEATURE_EXECUTOR_STATS
+    /// Time when this executable was last added to an executor. Used for the
+    /// executor statistics.
+    long long enqueueTimeNsec_ {0};
+#endif
 };
 
 /** A notifiable class that calls a particular function object once when it is
@@ -38,6 +38,7 @@
 #include "executor/Executor.hxx"
 
 #include "openmrn_features.h"
+#include <errno.h>
 #include <unistd.h>
 
 #ifdef __WINNT__
@@ -76,11 +77,17 @@ ExecutorBase::ExecutorBase()
     , done_(0)
     , started_(0)
     , selectPrescaler_(0)
+    , runBudget_(config_executor_run_budget())
 {
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    HASSERT(epollFd_ >= 0);
+#else
     FD_ZERO(&selectRead_);
     FD_ZERO(&selectWrite_);
     FD_ZERO(&selectExcept_);
     selectNFds_ = 0;
+#endif
 }
 
 /** Lookup an executor by its name.
@@ -179,13 +186,54 @@ bool ExecutorBase::loop_once()
         return false;
     }
     current_ = msg;
-    msg->run();
+    run_executable(msg);
     current_ = nullptr;
     return true;
 }
 
+unsigned ExecutorBase::next_batch(Executable **batch, unsigned budget)
+{
+    unsigned priority;
+    batch[0] = next(&priority);
+    return batch[0] ? 1 : 0;
+}
+
+bool ExecutorBase::run_batch()
+{
+    Executable *batch[MAX_BATCH];
+    unsigned n = next_batch(batch, runBudget_);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        Executable *msg = batch[i];
+        if (msg == this)
+        {
+            // exit closure
+            done_ = 1;
+            return false;
+        }
+        ++sequence_;
+        current_ = msg;
+        run_executable(msg);
+        current_ = nullptr;
+    }
+    return true;
+}
+
 long long ICACHE_FLASH_ATTR  ExecutorBase::loop_some() {
     ScopedSetThreadHandle h(this);
+    if (runBudget_)
+    {
+        long long wait_length = activeTimers_.get_next_timeout();
+        if (empty())
+        {
+            return wait_length;
+        }
+        if (!run_batch())
+        {
+            return INT64_MAX;
+        }
+        return 0;
+    }
     for (int i = 12; i > 0; --i) {
         Executable *msg = nullptr;
         unsigned priority = UINT_MAX;
@@ -203,7 +251,7 @@ long long ICACHE_FLASH_ATTR  ExecutorBase::loop_some() {
         if (msg != NULL)
         {
             current_ = msg;
-            msg->run();
+            run_executable(msg);
             current_ = nullptr;
         }
     }
@@ -298,6 +346,16 @@ void *ExecutorBase::entry()
     /* wait for messages to process */
     for (; /* forever */;)
     {
+        if (runBudget_)
+        {
+            // Batch mode: timers and select once, then a batch of work.
+            wait_with_select(activeTimers_.get_next_timeout());
+            if (!run_batch())
+            {
+                return NULL;
+            }
+            continue;
+        }
         Executable *msg = nullptr;
         unsigned priority = UINT_MAX;
         if (!selectPrescaler_ || ((msg = next(&priority)) == nullptr))
@@ -321,7 +379,7 @@ void *ExecutorBase::entry()
         {
             ++sequence_;
             current_ = msg;
-            msg->run();
+            run_executable(msg);
             current_ = nullptr;
         }
     }
@@ -329,28 +387,201 @@ void *ExecutorBase::entry()
     return NULL;
 }
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+
 void ExecutorBase::select(Selectable *job)
 {
-    fd_set *s = get_select_set(job->type());
+    TypedQueue<Selectable> ready;
+    {
+        AtomicHolder h(&selectLock_);
+        int fd = job->fd_;
+        if ((unsigned)fd >= epollSlots_.size())
+        {
+            epollSlots_.resize(fd + 1);
+        }
+        Selectable *&w = epollSlots_[fd].waiting_[job->selectType_ - 1];
+        if (w)
+        {
+            LOG(FATAL,
+                "Multiple Selectables are waiting for the same fd %d type %u",
+                fd, job->selectType_);
+        }
+        w = job;
+        // The kernel picks up the new registration even if the executor
+        // thread is blocked in epoll_wait, so there is no need to wake it up.
+        epoll_update_locked(fd, &ready);
+    }
+    wakeup_selectables(&ready);
+}
+
+bool ExecutorBase::is_selected(Selectable *job)
+{
+    AtomicHolder h(&selectLock_);
     int fd = job->fd_;
-    if (FD_ISSET(fd, s))
+    return (unsigned)fd < epollSlots_.size() &&
+        epollSlots_[fd].waiting_[job->selectType_ - 1] != nullptr;
+}
+
+void ExecutorBase::unselect(Selectable *job)
+{
+    TypedQueue<Selectable> ready;
     {
-        LOG(FATAL,
-            "Multiple Selectables are waiting for the same fd %d type %u", fd,
-            job->selectType_);
+        AtomicHolder h(&selectLock_);
+        int fd = job->fd_;
+        if ((unsigned)fd >= epollSlots_.size() ||
+            !epollSlots_[fd].waiting_[job->selectType_ - 1])
+        {
+            LOG(FATAL,
+                "Tried to remove a non-active selectable: fd %d type %u", fd,
+                job->selectType_);
+        }
+        epollSlots_[fd].waiting_[job->selectType_ - 1] = nullptr;
+        epoll_update_locked(fd, &ready);
+    }
+    wakeup_selectables(&ready);
+}
+
+void ExecutorBase::epoll_update_locked(int fd, TypedQueue<Selectable> *ready)
+{
+    EpollSlot &slot = epollSlots_[fd];
+    uint32_t events = 0;
+    if (slot.waiting_[Selectable::READ - 1])
+    {
+        events |= EPOLLIN;
+    }
+    if (slot.waiting_[Selectable::WRITE - 1])
+    {
+        events |= EPOLLOUT;
+    }
+    if (slot.waiting_[Selectable::EXCEPT - 1])
+    {
+        events |= EPOLLPRI;
+    }
+    if (events == slot.events_)
+    {
+        return;
+    }
+    struct epoll_event ev;
+    ev.events = events;
+    ev.data.fd = fd;
+    if (!events)
+    {
+        // Fails harmlessly if the fd was closed in the meantime; the kernel
+        // has removed it already.
+        ::epoll_ctl(epollFd_, EPOLL_CTL_DEL, fd, &ev);
+        slot.events_ = 0;
+        return;
+    }
+    int op = slot.events_ ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    int ret = ::epoll_ctl(epollFd_, op, fd, &ev);
+    if (ret < 0 && (errno == ENOENT || errno == EEXIST))
+    {
+        // The kernel drops closed fds from the epoll set, so our view of the
+        // registration may be stale if the fd got reopened.
+        op = op == EPOLL_CTL_ADD ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+        ret = ::epoll_ctl(epollFd_, op, fd, &ev);
+    }
+    if (ret < 0 && errno == EPERM)
+    {
+        // Regular files cannot be added to epoll. select() reports them as
+        // always ready, so we wake up the waiters right away.
+        for (unsigned t = 0; t < 3; ++t)
+        {
+            Selectable *s = slot.waiting_[t];
+            if (s)
+            {
+                slot.waiting_[t] = nullptr;
+                ready->push_front(s);
+            }
+        }
+        slot.events_ = 0;
+        return;
+    }
+    slot.events_ = events;
+}
+
+void ExecutorBase::wait_with_select(long long wait_length)
+{
+    if (!empty()) {
+        wait_length = 0;
+    }
+    long long max_sleep = MSEC_TO_NSEC(config_executor_max_sleep_msec());
+    if (wait_length > max_sleep)
+    {
+        wait_length = max_sleep;
+    }
+    struct epoll_event events[MAX_EPOLL_EVENTS];
+    int ret = selectHelper_.epoll_wait(
+        epollFd_, events, MAX_EPOLL_EVENTS, wait_length);
+    if (ret <= 0) {
+        return; // nothing to do
+    }
+    TypedQueue<Selectable> woken;
+    {
+        AtomicHolder h(&selectLock_);
+        for (int i = 0; i < ret; ++i)
+        {
+            int fd = events[i].data.fd;
+            if ((unsigned)fd >= epollSlots_.size())
+            {
+                continue;
+            }
+            uint32_t ev = events[i].events;
+            // Errors and hangups make select() report the fd as both readable
+            // and writable; we wake up every waiter to get the same behavior.
+            uint32_t ready[3] = {EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP,
+                EPOLLOUT | EPOLLERR | EPOLLHUP,
+                EPOLLPRI | EPOLLERR | EPOLLHUP};
+            EpollSlot &slot = epollSlots_[fd];
+            for (unsigned t = 0; t < 3; ++t)
+            {
+                Selectable *s = slot.waiting_[t];
+                if (s && (ev & ready[t]))
+                {
+                    slot.waiting_[t] = nullptr;
+                    woken.push_front(s);
+                }
+            }
+            epoll_update_locked(fd, &woken);
+        }
+    }
+    wakeup_selectables(&woken);
+}
+
+#else // OPENMRN_FEATURE_EXECUTOR_EPOLL
+
+void ExecutorBase::select(Selectable *job)
+{
+    {
+        AtomicHolder h(&selectLock_);
+        fd_set *s = get_select_set(job->type());
+        int fd = job->fd_;
+        if (FD_ISSET(fd, s))
+        {
+            LOG(FATAL,
+                "Multiple Selectables are waiting for the same fd %d type %u",
+                fd, job->selectType_);
+        }
+        FD_SET(fd, s);
+        if (fd >= selectNFds_)
+        {
+            selectNFds_ = fd + 1;
+        }
+        HASSERT(!job->next);
+        // Inserts the job into the select queue.
+        selectables_.push_front(job);
     }
-    FD_SET(fd, s);
-    if (fd >= selectNFds_)
+    if (os_thread_self() != selectHelper_.main_thread())
     {
-        selectNFds_ = fd + 1;
+        // Called from a worker thread of an executor pool. The select thread
+        // needs to pick up the new fd.
+        selectHelper_.wakeup();
     }
-    HASSERT(!job->next);
-    // Inserts the job into the select queue.
-    selectables_.push_front(job);
 }
 
 bool ExecutorBase::is_selected(Selectable *job)
 {
+    AtomicHolder h(&selectLock_);
     fd_set *s = get_select_set(job->type());
     int fd = job->fd_;
     return FD_ISSET(fd, s);
@@ -358,6 +589,7 @@ bool ExecutorBase::is_selected(Selectable *job)
 
 void ExecutorBase::unselect(Selectable *job)
 {
+    AtomicHolder h(&selectLock_);
     fd_set *s = get_select_set(job->type());
     int fd = job->fd_;
     if (!FD_ISSET(fd, s))
@@ -383,9 +615,12 @@ void ExecutorBase::unselect(Selectable *job)
 
 void ExecutorBase::wait_with_select(long long wait_length)
 {
+    selectLock_.lock();
     fd_set fd_r(selectRead_);
     fd_set fd_w(selectWrite_);
     fd_set fd_x(selectExcept_);
+    int nfds = selectNFds_;
+    selectLock_.unlock();
     if (!empty()) {
         wait_length = 0;
     }
@@ -394,29 +629,46 @@ void ExecutorBase::wait_with_select(long long wait_length)
     {
         wait_length = max_sleep;
     }
-    int ret = selectHelper_.select(selectNFds_, &fd_r, &fd_w, &fd_x, wait_length);
+    int ret = selectHelper_.select(nfds, &fd_r, &fd_w, &fd_x, wait_length);
     if (ret <= 0) {
         return; // nothing to do
     }
-    unsigned max_fd = 0;
-    for (auto it = selectables_.begin(); it != selectables_.end();) {
-        fd_set* s = nullptr;
-        fd_set* os = get_select_set(it->type());
-        switch(it->type()) {
-        case Selectable::READ: s = &fd_r; break;
-        case Selectable::WRITE: s = &fd_w; break;
-        case Selectable::EXCEPT: s = &fd_x; break;
-        }
-        if (FD_ISSET(it->fd_, s)) {
-            add(it->wakeup_, it->priority_);
-            FD_CLR(it->fd_, os);
-            selectables_.erase(it);
-            continue;
+    TypedQueue<Selectable> woken;
+    {
+        AtomicHolder h(&selectLock_);
+        unsigned max_fd = 0;
+        for (auto it = selectables_.begin(); it != selectables_.end();) {
+            fd_set* s = nullptr;
+            fd_set* os = get_select_set(it->type());
+            switch(it->type()) {
+            case Selectable::READ: s = &fd_r; break;
+            case Selectable::WRITE: s = &fd_w; break;
+            case Selectable::EXCEPT: s = &fd_x; break;
+            }
+            if (FD_ISSET(it->fd_, s)) {
+                Selectable *job = &*it;
+                FD_CLR(it->fd_, os);
+                selectables_.erase(it);
+                woken.push_front(job);
+                continue;
+            }
+            max_fd = std::max(max_fd, it->fd_ + 1U);
+            ++it;
         }
-        max_fd = std::max(max_fd, it->fd_ + 1U);
-        ++it;
+        selectNFds_ = max_fd;
+    }
+    wakeup_selectables(&woken);
+}
+
+#endif // OPENMRN_FEATURE_EXECUTOR_EPOLL
+
+void ExecutorBase::wakeup_selectables(TypedQueue<Selectable> *ready)
+{
+    while (!ready->empty())
+    {
+        Selectable *s = ready->pop_front();
+        add(s->wakeup_, s->priority_);
     }
-    selectNFds_ = max_fd;
 }
 
 #endif
@@ -452,4 +704,7 @@ ExecutorBase::~ExecutorBase()
     {
         shutdown();
     }
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    ::close(epollFd_);
+#endif
 }
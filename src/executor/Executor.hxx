@@ -38,11 +38,14 @@
 
 #include <functional>
 #include <atomic>
+#include <vector>
 
 #include "executor/Executable.hxx"
+#include "executor/ExecutorStats.hxx"
 #include "executor/Notifiable.hxx"
 #include "executor/Selectable.hxx"
 #include "executor/Timer.hxx"
+#include "utils/MpscQueue.hxx"
 #include "utils/Queue.hxx"
 #include "utils/SimpleQueue.hxx"
 #include "utils/LinkedObject.hxx"
@@ -50,6 +53,10 @@
 #include "utils/macros.h"
 #include "os/OSSelectWakeup.hxx"
 
+#if OPENMRN_FEATURE_EXECUTOR_MPSC_QUEUE
+#include <sched.h>
+#endif
+
 #ifdef ESP_NONOS
 extern "C" {
 #include <ets_sys.h>
@@ -102,7 +109,8 @@ public:
      * @param job Selectable structure that describes the descriptor to watch.
      * The pointer must stay alive until it is activated, or is unselected.
      *
-     * Must be called on the executor thread.
+     * Must be called on the executor thread (or one of the worker threads of
+     * an @ref ExecutorPool).
      *
      * @param job is a Selectable pointer that is not currently watched.
      */
@@ -121,7 +129,8 @@ public:
      * This stops watching the given file descriptor. The job must have been
      * previously inserted into the Executor and must be not yet activated.
      *
-     * Must be called on the executor thread.
+     * Must be called on the executor thread (or one of the worker threads of
+     * an @ref ExecutorPool).
      *
      * @param job is a Selectable pointer that was previously inserted.
      */
@@ -140,6 +149,28 @@ public:
      */
     long long loop_some() ICACHE_FLASH_ATTR;
 
+    /** Sets the batch mode of the executor loop. With a non-zero budget the
+     * executor takes up to that many executables from each priority band at
+     * once, and runs them back to back. Timers and select are checked only
+     * once per batch. Work arriving during a batch (including higher priority
+     * work) waits until the batch is done.
+     *
+     * @param budget maximum number of executables to take from one priority
+     * band per batch (at most MAX_BATCH in total). 0 turns off batch mode. */
+    void set_run_budget(unsigned budget)
+    {
+        runBudget_ = budget;
+    }
+
+    /// @return the current run budget. See @ref set_run_budget.
+    unsigned run_budget()
+    {
+        return runBudget_;
+    }
+
+    /// Largest number of executables run in one batch.
+    static constexpr unsigned MAX_BATCH = 16;
+
     /** @returns the list of active timers. */
     ActiveTimers* active_timers() { return &activeTimers_; }
 
@@ -166,6 +197,14 @@ public:
     /// Helper function for debugging and tracing.
     /// @return currently running executable or nullptr if none active.
     Executable* volatile current() { return current_; }
+
+#if OPENMRN_FEATURE_EXECUTOR_STATS
+    /// @return the per-Executable run time statistics of this executor.
+    ExecutorStats *stats()
+    {
+        return &stats_;
+    }
+#endif
     
 protected:
     /** Thread entry point.
@@ -178,6 +217,31 @@ protected:
     /** Helper object for interruptible select calls. */
     OSSelectWakeup selectHelper_;
 
+    /** Marks the time when an executable is put into the queue. Compiles to
+     * nothing unless the executor statistics are enabled.
+     * @param msg the executable being added. */
+    static void stamp_enqueue(Executable *msg)
+    {
+#if OPENMRN_FEATURE_EXECUTOR_STATS
+        msg->enqueueTimeNsec_ = OSTime::get_monotonic();
+#endif
+    }
+
+    /** Calls the run() method of an executable, and records its statistics
+     * if enabled.
+     * @param msg the executable to run. */
+    void run_executable(Executable *msg)
+    {
+#if OPENMRN_FEATURE_EXECUTOR_STATS
+        long long start = OSTime::get_monotonic();
+        long long wait = start - msg->enqueueTimeNsec_;
+        msg->run(); // may delete msg.
+        stats_.record(msg, wait, OSTime::get_monotonic() - start);
+#else
+        msg->run();
+#endif
+    }
+
 private:
     /** Retrieve an item from the front of the queue.
      * @param priority pass back the priority of the queue pulled from
@@ -185,6 +249,18 @@ private:
      */
     virtual Executable *next(unsigned *priority) = 0;
 
+    /** Retrieve a batch of items from the queue. The default implementation
+     * returns a single executable.
+     * @param batch array of MAX_BATCH entries to fill in, in the order of
+     * execution. If the exit closure is found, it will be the last entry.
+     * @param budget maximum number of entries to take per priority band.
+     * @return number of entries filled in. */
+    virtual unsigned next_batch(Executable **batch, unsigned budget);
+
+    /** Runs one batch of executables from the queue.
+     * @return false if the executor needs to exit. */
+    bool run_batch();
+
     /** Executes a select call, and schedules any necessary executables based
      * on the return. Will not sleep at all if not empty, otherwise sleeps at
      * most next_timer_nsec nanoseconds (from now).
@@ -192,6 +268,31 @@ private:
      * @param next_timer_nsec is the maximum time to sleep in nanoseconds. */
     void wait_with_select(long long next_timer_nsec);
 
+    /** Schedules the executables of Selectables whose fd became ready. Must be
+     * called without selectLock_ held, because add() may take other locks.
+     * @param ready is the list of Selectables to wake up; will be emptied. */
+    void wakeup_selectables(TypedQueue<Selectable> *ready);
+
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    /// Selectables waiting for a given fd, one per select type.
+    struct EpollSlot
+    {
+        /// Waiting Selectable for READ, WRITE, EXCEPT (index type - 1).
+        Selectable *waiting_[3] = {nullptr, nullptr, nullptr};
+        /// Event mask currently registered with the kernel for this fd.
+        uint32_t events_ = 0;
+    };
+
+    /// Maximum number of ready fds we process in one wakeup.
+    static constexpr unsigned MAX_EPOLL_EVENTS = 32;
+
+    /// Brings the kernel registration of an fd in sync with the waiting
+    /// Selectables. Must be called with selectLock_ held. @param fd is the
+    /// file descriptor whose slot changed. @param ready collects the
+    /// Selectables that need to be woken up right away (see
+    /// wakeup_selectables).
+    void epoll_update_locked(int fd, TypedQueue<Selectable> *ready);
+#else
     /// Helper function.
     ///
     /// @param type a select type: READ, WRITE or EXCEPT
@@ -209,6 +310,7 @@ private:
         LOG(FATAL, "Unexpected select type %d", type);
         return nullptr;
     }
+#endif
 
     /** name of this Executor */
     const char *name_;
@@ -219,6 +321,12 @@ private:
     /** List of active timers. */
     ActiveTimers activeTimers_;
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    /** epoll instance watching the fds of the active Selectables. */
+    int epollFd_;
+    /** Active Selectables, indexed by fd. */
+    std::vector<EpollSlot> epollSlots_;
+#else
     /** fd to select for read. */
     fd_set selectRead_;
     /** fd to select for write. */
@@ -229,6 +337,15 @@ private:
     int selectNFds_;
     /** Head of the linked list for the select calls. */
     TypedQueue<Selectable> selectables_;
+#endif
+#if OPENMRN_FEATURE_EXECUTOR_STATS
+    /** Run time statistics of the executables. */
+    ExecutorStats stats_;
+#endif
+    /** Protects the select sets and the selectables_ list. These are
+     * manipulated from other threads than the executor's own when the
+     * executor is an @ref ExecutorPool. */
+    Atomic selectLock_;
 
     /** Set to 1 when the executor thread has exited and it is safe to delete
      * *this. */
@@ -238,6 +355,8 @@ private:
     /// How many executables we schedule blindly before calling a select() in
     /// order to find more data to read/write in the FDs being waited upon.
     unsigned selectPrescaler_ : 5;
+    /// Batch mode budget. See @ref set_run_budget.
+    unsigned runBudget_;
 
 protected:
     /// Sequence number.
@@ -299,14 +418,22 @@ public:
      */
     ~Executor();
 
-    /** Send a message to this Executor's queue.
+    /** Send a message to this Executor's queue. With
+     * OPENMRN_FEATURE_EXECUTOR_MPSC_QUEUE this does not take a lock; the
+     * executable goes to a lock-free ingress queue which the executor thread
+     * drains.
      * @param msg Executable instance to insert into the input queue
      * @param priority priority of message
      */
     void add(Executable *msg, unsigned priority = UINT_MAX) OVERRIDE
     {
+        stamp_enqueue(msg);
+#if OPENMRN_FEATURE_EXECUTOR_MPSC_QUEUE
+        ingress_[priority >= NUM_PRIO ? NUM_PRIO - 1 : priority].insert(msg);
+#else
         queue_.insert(
             msg, priority >= NUM_PRIO ? NUM_PRIO - 1 : priority);
+#endif
 #ifdef ESP_NONOS
         extern void wakeup_executor(ExecutorBase* executor);
         wakeup_executor(this);
@@ -323,6 +450,7 @@ public:
      */
     void add_from_isr(Executable *msg, unsigned priority = UINT_MAX) override
     {
+        stamp_enqueue(msg);
 #ifdef ESP32
         // On the ESP32 we need to call insert instead of insert_locked to
         // ensure that all code paths lock the queue for consistency since
@@ -346,10 +474,28 @@ public:
     }
 
     /// @return true if there are no executables waiting on this thread to be
-    /// executed. There could still be a current executable.
+    /// executed. There could still be a current executable. May be called
+    /// from any thread.
     bool empty() OVERRIDE
     {
+#if OPENMRN_FEATURE_EXECUTOR_MPSC_QUEUE
+        // queue_ belongs to the executor thread; other threads only see the
+        // atomic state.
+        if (queued_.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        for (unsigned i = 0; i < NUM_PRIO; ++i)
+        {
+            if (!ingress_[i].empty())
+            {
+                return false;
+            }
+        }
+        return true;
+#else
         return queue_.empty();
+#endif
     }
 
     uint32_t sequence() OVERRIDE { return sequence_; }
@@ -361,19 +507,113 @@ private:
      */
     Executable *next(unsigned *priority) OVERRIDE
     {
+#if OPENMRN_FEATURE_EXECUTOR_MPSC_QUEUE
+        drain_ingress();
+        auto result = queue_.next_locked();
+        if (result.item)
+        {
+            queued_.fetch_sub(1, std::memory_order_release);
+        }
+#else
         auto result = queue_.next();
+#endif
         *priority = result.index;
         return static_cast<Executable*>(result.item);
     }
 
+    /** Retrieve a batch of items from the queue.
+     * @param batch array of MAX_BATCH entries to fill in.
+     * @param budget maximum number of entries to take per priority band.
+     * @return number of entries filled in. */
+    unsigned next_batch(Executable **batch, unsigned budget) OVERRIDE
+    {
+        drain_ingress();
+        unsigned n = 0;
+        for (unsigned i = 0; i < NUM_PRIO && n < MAX_BATCH; ++i)
+        {
+            for (unsigned k = 0; k < budget && n < MAX_BATCH; ++k)
+            {
+                Executable *msg = static_cast<Executable *>(take(i));
+                if (!msg)
+                {
+                    break;
+                }
+                batch[n++] = msg;
+                if (msg == this)
+                {
+                    return n;
+                }
+            }
+        }
+        return n;
+    }
+
+    /// Moves everything from the ingress queues to the run queues. Called on
+    /// the executor thread only.
+    void drain_ingress()
+    {
+#if OPENMRN_FEATURE_EXECUTOR_MPSC_QUEUE
+        for (unsigned i = 0; i < NUM_PRIO; ++i)
+        {
+            while (true)
+            {
+                QMember *m = ingress_[i].next();
+                if (m)
+                {
+                    queued_.fetch_add(1, std::memory_order_relaxed);
+                    queue_.insert_locked(m, i);
+                    continue;
+                }
+                if (ingress_[i].empty())
+                {
+                    break;
+                }
+                // A producer is between the exchange and the link in
+                // MpscQueue::insert(). We let it finish instead of returning
+                // with empty() being false and nothing to run, which would
+                // make the executor loop spin.
+                sched_yield();
+            }
+        }
+#endif
+    }
+
+    /// Takes the first executable of a band from the run queue. Called on
+    /// the executor thread only. @param band is the priority band. @return
+    /// the executable, or nullptr if the band is empty.
+    QMember *take(unsigned band)
+    {
+#if OPENMRN_FEATURE_EXECUTOR_MPSC_QUEUE
+        QMember *item = queue_.next_locked(band);
+        if (item)
+        {
+            queued_.fetch_sub(1, std::memory_order_release);
+        }
+        return item;
+#else
+        return queue_.next(band);
+#endif
+    }
+
     /** Default Constructor.
      */
     Executor();
 
     DISALLOW_COPY_AND_ASSIGN(Executor);
 
+#if OPENMRN_FEATURE_EXECUTOR_MPSC_QUEUE
+    /// Executables added by any thread, per priority band.
+    MpscQueue ingress_[NUM_PRIO];
+    /// Number of executables in queue_. Lets other threads check empty()
+    /// without touching queue_.
+    std::atomic<unsigned> queued_ {0};
+    /// Internal queue of executables waiting to be scheduled. Accessed only
+    /// by the executor thread, hence used without locking.
+    QList<NUM_PRIO> queue_;
+#else
     /// Internal queue of executables waiting to be scheduled.
     QListProtected<NUM_PRIO> queue_;
+#endif
 };
 
 /** This class can be given an executor, and will notify itself when that
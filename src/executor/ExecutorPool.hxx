@@ -0,0 +1,462 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file ExecutorPool.hxx
+ *
+ * An executor that runs its executables on a pool of worker threads, with
+ * per-service affinity and work stealing between the workers.
+ *
+ * @author Balazs Racz
+ * @date 16 October 2026
+ */
+
+#ifndef _EXECUTOR_EXECUTORPOOL_HXX_
+#define _EXECUTOR_EXECUTORPOOL_HXX_
+
+#include <atomic>
+
+#include "executor/Executor.hxx"
+#include "openmrn_features.h"
+
+#if OPENMRN_FEATURE_SINGLE_THREADED
+#error ExecutorPool needs an operating system with threads.
+#endif
+
+/// Implementation of ExecutorBase that runs the executables on a number of
+/// worker threads, while keeping the same add() / loop_once() contract as
+/// @ref Executor.
+///
+/// Executables are grouped by Executable::affinity_key(), which is the
+/// Service for every StateFlow. Each group has a home worker, looked up in a
+/// small hashed affinity table, and all queued and running executables of a
+/// group are on that worker. Thus the flows of one Service never run
+/// concurrently, and existing Service / StateFlowBase code needs no locking
+/// to run on a pool. Independent services run in parallel on different
+/// workers, unless their keys hash to the same slot.
+///
+/// A worker that ran out of work steals from the other workers (in priority
+/// order) a group that is not running there, and the home of that group
+/// moves to the thief, together with all its queued executables.
+///
+/// Worker 0 is the executor's own thread. This one is responsible for the
+/// timers and for the select() calls; the remaining workers only run
+/// executables. Timer callbacks are therefore not serialized with the
+/// flows; they should only notify the flow (as StateFlowTimer does).
+template <unsigned NUM_PRIO>
+class ExecutorPool : public ExecutorBase, private Atomic
+{
+public:
+    /// Largest number of worker threads supported.
+    static constexpr unsigned MAX_WORKERS = 8;
+
+    /// Constructor.
+    /// @param name name of executor (used for all worker threads)
+    /// @param priority thread priority
+    /// @param stack_size thread stack size
+    /// @param num_workers how many threads should execute the executables,
+    /// including the executor's own thread. Must be 1..MAX_WORKERS.
+    ExecutorPool(
+        const char *name, int priority, size_t stack_size, unsigned num_workers)
+        : numWorkers_(num_workers)
+    {
+        HASSERT(num_workers > 0 && num_workers <= MAX_WORKERS);
+        for (unsigned i = 0; i < AFFINITY_SLOTS; ++i)
+        {
+            affinity_[i] = i % num_workers;
+        }
+        for (unsigned i = 1; i < numWorkers_; ++i)
+        {
+            workers_[i].parent_ = this;
+            workers_[i].start(name, priority, stack_size);
+        }
+        OSThread::start(name, priority, stack_size);
+    }
+
+    /// Destructor. Waits for all workers to run out of work and exit.
+    ~ExecutorPool()
+    {
+        shutdown();
+        {
+            AtomicHolder h(this);
+            stopping_ = true;
+            for (unsigned i = 1; i < numWorkers_; ++i)
+            {
+                workers_[i].sleeping_ = false;
+            }
+        }
+        for (unsigned i = 1; i < numWorkers_; ++i)
+        {
+            workers_[i].sem_.post();
+        }
+        for (unsigned i = 1; i < numWorkers_; ++i)
+        {
+            exitSem_.wait();
+        }
+    }
+
+    /** Send a message to this Executor's queue.
+     * @param msg Executable instance to insert into the input queue
+     * @param priority priority of message
+     */
+    void add(Executable *msg, unsigned priority = UINT_MAX) override
+    {
+        int wake;
+        {
+            AtomicHolder h(this);
+            wake = add_locked(msg, priority);
+        }
+        if (wake > 0)
+        {
+            workers_[wake].sem_.post();
+        }
+        else if (wake == 0)
+        {
+            selectHelper_.wakeup();
+        }
+    }
+
+#if OPENMRN_FEATURE_RTOS_FROM_ISR
+    /** Send a message to this Executor's queue. Callable from interrupt
+     * context.
+     * @param msg Executable instance to insert into the input queue
+     * @param priority priority of message
+     */
+    void add_from_isr(Executable *msg, unsigned priority = UINT_MAX) override
+    {
+        int wake;
+        {
+#ifdef ESP32
+            // On the ESP32 the Atomic lock is safe to take from an ISR, and
+            // the ISR is not guaranteed to exclude the other core.
+            AtomicHolder h(this);
+#endif // ESP32
+            wake = add_locked(msg, priority);
+        }
+        if (wake > 0)
+        {
+            int woken = 0;
+            workers_[wake].sem_.post_from_isr(&woken);
+            os_isr_exit_yield_test(woken);
+        }
+        else if (wake == 0)
+        {
+            selectHelper_.wakeup_from_isr();
+        }
+    }
+#endif // OPENMRN_FEATURE_RTOS_FROM_ISR
+
+    /// @return true if there are no executables waiting on any of the worker
+    /// threads to be executed.
+    bool empty() override
+    {
+        AtomicHolder h(this);
+        for (unsigned i = 0; i < numWorkers_; ++i)
+        {
+            for (unsigned p = 0; p < NUM_PRIO; ++p)
+            {
+                if (!workers_[i].queue_.empty(p))
+                {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    uint32_t sequence() override
+    {
+        return sequence_ + workerSequence_;
+    }
+
+    /// @return the number of worker threads (including the executor thread).
+    unsigned num_workers()
+    {
+        return numWorkers_;
+    }
+
+    /// @return how many times an executable was stolen by an idle worker from
+    /// a busy one.
+    uint32_t steal_count()
+    {
+        return stealCount_;
+    }
+
+private:
+    /// Number of bits in the affinity table index.
+    static constexpr unsigned AFFINITY_BITS = 6;
+    /// Number of entries in the affinity table.
+    static constexpr unsigned AFFINITY_SLOTS = 1u << AFFINITY_BITS;
+
+    /// State of one worker thread. Worker 0 does not use the thread.
+    class Worker : public OSThread
+    {
+    public:
+        Worker()
+            : parent_(nullptr)
+            , current_(nullptr)
+            , sleeping_(false)
+        {
+        }
+
+        /// Thread entry point. @return nullptr when the pool is destroyed.
+        void *entry() override
+        {
+            parent_->worker_loop(this);
+            parent_->exitSem_.post();
+            return nullptr;
+        }
+
+        /// Owning pool.
+        ExecutorPool *parent_;
+        /// Executables that have this worker as their home.
+        QList<NUM_PRIO> queue_;
+        /// The executable that this worker is running. Protected by the pool
+        /// lock.
+        Executable *current_;
+        /// The worker thread blocks on this when there is nothing to do.
+        OSSem sem_;
+        /// true if the worker thread is blocked on sem_ (or about to be).
+        bool sleeping_;
+    };
+
+    /// @param msg an executable. @return the affinity table index of msg.
+    static unsigned affinity_slot(Executable *msg)
+    {
+        uint32_t h =
+            (uint32_t)(((uintptr_t)msg->affinity_key()) >> 3) * 2654435761u;
+        return h >> (32 - AFFINITY_BITS);
+    }
+
+    /// Enqueues an executable on the correct worker. Caller must hold the
+    /// lock.
+    /// @param msg executable to enqueue.
+    /// @param priority priority band to use.
+    /// @return the index of a worker thread (>0) whose semaphore needs to be
+    /// posted, 0 if the select of the executor thread needs to be woken up,
+    /// or -1 if no thread needs to be woken up.
+    int add_locked(Executable *msg, unsigned priority)
+    {
+        stamp_enqueue(msg);
+        unsigned target = worker_for_locked(msg);
+        workers_[target].queue_.insert_locked(
+            msg, priority >= NUM_PRIO ? NUM_PRIO - 1 : priority);
+        if (target == 0)
+        {
+            return 0;
+        }
+        if (workers_[target].sleeping_)
+        {
+            workers_[target].sleeping_ = false;
+            return target;
+        }
+        if (!workers_[target].current_)
+        {
+            // Target is awake and will look at its queue before sleeping.
+            return -1;
+        }
+        if (affinity_slot(workers_[target].current_) == affinity_slot(msg))
+        {
+            // Same group is running; nobody else may take this.
+            return -1;
+        }
+        // Target is busy. Find an idle worker that may steal this.
+        for (unsigned i = 1; i < numWorkers_; ++i)
+        {
+            if (workers_[i].sleeping_)
+            {
+                workers_[i].sleeping_ = false;
+                return i;
+            }
+        }
+        if (!workers_[0].current_)
+        {
+            // The executor thread has no work; it will steal this after
+            // returning from select.
+            return 0;
+        }
+        return -1;
+    }
+
+    /// Decides which worker's queue an executable should go to. Caller must
+    /// hold the lock.
+    /// @param msg executable to enqueue.
+    /// @return worker index.
+    unsigned worker_for_locked(Executable *msg)
+    {
+        if (msg == static_cast<Executable *>(this))
+        {
+            // Exit closure must run on the executor thread.
+            return 0;
+        }
+        // This is also the worker running msg (or its group), if any.
+        return affinity_[affinity_slot(msg)];
+    }
+
+    /// Finds the next executable to run for a given worker. Caller must hold
+    /// the lock.
+    /// @param idx worker index
+    /// @param priority will be set to the priority band of the returned
+    /// executable.
+    /// @return executable to run, or nullptr if there is nothing to do.
+    Executable *take_locked(unsigned idx, unsigned *priority)
+    {
+        Worker *w = &workers_[idx];
+        w->current_ = nullptr;
+        auto result = w->queue_.next_locked();
+        Executable *msg = static_cast<Executable *>(result.item);
+        *priority = result.index;
+        if (!msg)
+        {
+            msg = steal_locked(idx, priority);
+        }
+        w->current_ = msg;
+        return msg;
+    }
+
+    /// Takes an executable from another worker's queue, and moves its group
+    /// to the thief. Caller must hold the lock.
+    /// @param idx index of the thief worker
+    /// @param priority will be set to the priority band of the returned
+    /// executable.
+    /// @return stolen executable, or nullptr if there was nothing to steal.
+    Executable *steal_locked(unsigned idx, unsigned *priority)
+    {
+        Executable *exit_closure = this;
+        for (unsigned p = 0; p < NUM_PRIO; ++p)
+        {
+            for (unsigned k = 1; k < numWorkers_; ++k)
+            {
+                Worker *victim = &workers_[(idx + k) % numWorkers_];
+                if (victim->queue_.pending(p) == 0)
+                {
+                    continue;
+                }
+                // The group running on the victim is pinned there.
+                int busy = victim->current_
+                    ? (int)affinity_slot(victim->current_)
+                    : -1;
+                Executable *msg = static_cast<Executable *>(
+                    victim->queue_.remove_first_locked(p,
+                        [exit_closure, busy](QMember *m) {
+                            Executable *e = static_cast<Executable *>(m);
+                            return e != exit_closure &&
+                                (int)affinity_slot(e) != busy;
+                        }));
+                if (!msg)
+                {
+                    continue;
+                }
+                unsigned slot = affinity_slot(msg);
+                affinity_[slot] = idx;
+                migrate_locked(victim, slot, idx);
+                ++stealCount_;
+                *priority = p;
+                return msg;
+            }
+        }
+        return nullptr;
+    }
+
+    /// Moves all queued executables of an affinity slot from one worker to
+    /// another, keeping their order. Caller must hold the lock.
+    /// @param from worker to take the executables from
+    /// @param slot affinity table index of the group
+    /// @param to index of the worker to queue them on
+    void migrate_locked(Worker *from, unsigned slot, unsigned to)
+    {
+        Executable *exit_closure = this;
+        auto in_group = [exit_closure, slot](QMember *m) {
+            Executable *e = static_cast<Executable *>(m);
+            return e != exit_closure && affinity_slot(e) == slot;
+        };
+        for (unsigned p = 0; p < NUM_PRIO; ++p)
+        {
+            while (QMember *m = from->queue_.remove_first_locked(p, in_group))
+            {
+                workers_[to].queue_.insert_locked(m, p);
+            }
+        }
+    }
+
+    /// Retrieve an item for the executor thread (worker 0).
+    /// @param priority pass back the priority of the queue pulled from
+    /// @return item retrieved from queue, else NULL if none waiting.
+    Executable *next(unsigned *priority) override
+    {
+        AtomicHolder h(this);
+        return take_locked(0, priority);
+    }
+
+    /// Main loop of the worker threads other than worker 0.
+    /// @param w the worker whose thread is calling.
+    void worker_loop(Worker *w)
+    {
+        unsigned idx = w - workers_;
+        while (true)
+        {
+            Executable *msg;
+            unsigned priority;
+            {
+                AtomicHolder h(this);
+                msg = take_locked(idx, &priority);
+                if (!msg)
+                {
+                    if (stopping_)
+                    {
+                        return;
+                    }
+                    w->sleeping_ = true;
+                }
+            }
+            if (!msg)
+            {
+                w->sem_.wait();
+                continue;
+            }
+            run_executable(msg);
+            ++workerSequence_;
+        }
+    }
+
+    /// Number of workers in use.
+    unsigned numWorkers_;
+    /// Worker states.
+    Worker workers_[MAX_WORKERS];
+    /// Hashed table of home worker indexes for executables.
+    uint8_t affinity_[AFFINITY_SLOTS];
+    /// Number of executables run by the workers other than worker 0.
+    std::atomic<uint32_t> workerSequence_ {0};
+    /// Number of steal events.
+    uint32_t stealCount_ {0};
+    /// true when the destructor asks the workers to exit.
+    bool stopping_ {false};
+    /// Posted by each worker thread (other than worker 0) when it exits.
+    OSSem exitSem_;
+
+    DISALLOW_COPY_AND_ASSIGN(ExecutorPool);
+};
+
+#endif // _EXECUTOR_EXECUTORPOOL_HXX_
@@ -0,0 +1,121 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file ExecutorStats.cpp
+ *
+ * Fixed-size table of per-Executable run time statistics collected by the
+ * executor loop.
+ *
+ * @author Balazs Racz
+ * @date 16 October 2026
+ */
+
+#include "executor/ExecutorStats.hxx"
+
+#include "openmrn_features.h"
+
+#include <string.h>
+
+#if OPENMRN_FEATURE_EXECUTOR_STATS
+
+void ExecutorStats::clear()
+{
+    AtomicHolder h(this);
+    memset(entries_, 0, sizeof(entries_));
+    memset(&overflow_, 0, sizeof(overflow_));
+    used_ = 0;
+}
+
+void ExecutorStats::add_sample(
+    Entry *entry, long long wait_nsec, long long run_nsec)
+{
+    if (wait_nsec < 0)
+    {
+        // Not enqueued through add().
+        wait_nsec = 0;
+    }
+    ++entry->runCount;
+    entry->totalRunNsec += run_nsec;
+    entry->totalWaitNsec += wait_nsec;
+    if (run_nsec > entry->maxRunNsec)
+    {
+        entry->maxRunNsec = run_nsec > UINT32_MAX ? UINT32_MAX : run_nsec;
+    }
+    if (wait_nsec > entry->maxWaitNsec)
+    {
+        entry->maxWaitNsec = wait_nsec > UINT32_MAX ? UINT32_MAX : wait_nsec;
+    }
+}
+
+void ExecutorStats::record(
+    Executable *e, long long wait_nsec, long long run_nsec)
+{
+    AtomicHolder h(this);
+    unsigned idx = slot(e);
+    for (unsigned i = 0; i < TABLE_SIZE; ++i)
+    {
+        Entry *entry = &entries_[idx];
+        if (entry->executable == e)
+        {
+            add_sample(entry, wait_nsec, run_nsec);
+            return;
+        }
+        if (!entry->executable)
+        {
+            if (used_ >= TABLE_SIZE * 3 / 4)
+            {
+                // Keeps the probe sequences short.
+                break;
+            }
+            ++used_;
+            entry->executable = e;
+            add_sample(entry, wait_nsec, run_nsec);
+            return;
+        }
+        if (++idx >= TABLE_SIZE)
+        {
+            idx = 0;
+        }
+    }
+    add_sample(&overflow_, wait_nsec, run_nsec);
+}
+
+unsigned ExecutorStats::snapshot(Entry *entries)
+{
+    AtomicHolder h(this);
+    unsigned n = 0;
+    for (unsigned i = 0; i < TABLE_SIZE; ++i)
+    {
+        if (entries_[i].executable)
+        {
+            entries[n++] = entries_[i];
+        }
+    }
+    entries[n++] = overflow_;
+    return n;
+}
+
+#endif // OPENMRN_FEATURE_EXECUTOR_STATS
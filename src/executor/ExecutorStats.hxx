@@ -0,0 +1,120 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file ExecutorStats.hxx
+ *
+ * Fixed-size table of per-Executable run time statistics collected by the
+ * executor loop.
+ *
+ * @author Balazs Racz
+ * @date 16 October 2026
+ */
+
+#ifndef _EXECUTOR_EXECUTORSTATS_HXX_
+#define _EXECUTOR_EXECUTORSTATS_HXX_
+
+#include <stdint.h>
+
+#include "executor/Executable.hxx"
+#include "utils/Atomic.hxx"
+#include "utils/macros.h"
+
+/// Per-Executable statistics of an executor: how many times each executable
+/// ran, how long it waited in the queue, and how long it ran.
+///
+/// Only compiled into the executors when OPENMRN_FEATURE_EXECUTOR_STATS is
+/// set to 1 (e.g. -DOPENMRN_FEATURE_EXECUTOR_STATS=1). The table has a fixed
+/// size and is keyed by the Executable pointer; recording never allocates.
+/// Executables that do not fit into the table are added to a common overflow
+/// entry. Since the key is a pointer, an executable that gets deleted and
+/// whose memory is reused by another one will be counted together.
+class ExecutorStats : private Atomic
+{
+public:
+    /// Number of executables tracked separately.
+    static constexpr unsigned TABLE_SIZE = 32;
+
+    /// Statistics of one executable.
+    struct Entry
+    {
+        /// Which executable these stats are for. nullptr for the overflow
+        /// entry.
+        Executable *executable;
+        /// How many times the executable ran.
+        uint32_t runCount;
+        /// Longest run() call in nanoseconds.
+        uint32_t maxRunNsec;
+        /// Longest time between add() and run() in nanoseconds.
+        uint32_t maxWaitNsec;
+        /// Sum of run() times in nanoseconds.
+        uint64_t totalRunNsec;
+        /// Sum of the queue waiting times in nanoseconds.
+        uint64_t totalWaitNsec;
+    };
+
+    ExecutorStats()
+    {
+        clear();
+    }
+
+    /// Records one run of an executable. Called by the executor loop.
+    /// @param e the executable (may be already deleted, only used as key).
+    /// @param wait_nsec how long the executable waited in the queue.
+    /// @param run_nsec how long the run() call took.
+    void record(Executable *e, long long wait_nsec, long long run_nsec);
+
+    /// Copies the statistics out of the table.
+    /// @param entries array of TABLE_SIZE + 1 entries to fill in. The last
+    /// one gets the overflow entry.
+    /// @return number of entries filled in (including the overflow entry).
+    unsigned snapshot(Entry *entries);
+
+    /// Resets all counters.
+    void clear();
+
+private:
+    /// @param e an executable. @return the hash table index to start looking
+    /// for e.
+    static unsigned slot(Executable *e)
+    {
+        return ((uint32_t)(((uintptr_t)e) >> 3) * 2654435761u) % TABLE_SIZE;
+    }
+
+    /// Adds one sample to an entry. @param entry the entry to update.
+    /// @param wait_nsec queue wait time. @param run_nsec run time.
+    static void add_sample(Entry *entry, long long wait_nsec, long long run_nsec);
+
+    /// The hash table of entries (open addressing).
+    Entry entries_[TABLE_SIZE];
+    /// Entry for the executables that did not fit into the table.
+    Entry overflow_;
+    /// Number of used entries in entries_.
+    unsigned used_;
+
+    DISALLOW_COPY_AND_ASSIGN(ExecutorStats);
+};
+
+#endif // _EXECUTOR_EXECUTORSTATS_HXX_
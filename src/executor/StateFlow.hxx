@@ -193,6 +193,13 @@ public:
         return service_;
     }
 
+    /// @return the service. All flows of a Service are serialized on a
+    /// multi-threaded executor.
+    const void *affinity_key() override
+    {
+        return service_;
+    }
+
 protected:
     /** Constructor.
      * @param service Service that this state flow is part of
@@ -1289,6 +1296,31 @@ protected:
         return queue_.empty();
     }
 
+    /** Removes the first queued message for which a predicate is true. Must
+     * be called with the lock (AtomicHolder on this) held.
+     *
+     * @param pred is called with the queued messages (as QMember*) until it
+     * returns true.
+     * @param priority will be set to the priority of the removed message.
+     * @return the removed message, NULL if pred was false for all messages. */
+    template <class Pred>
+    QMember *queue_remove_first(Pred pred, unsigned *priority)
+    {
+        typename QueueType::Result r = queue_.remove_first_locked(pred);
+        if (r.item)
+        {
+            *priority = r.index;
+        }
+        return r.item;
+    }
+
+    /// @return the queue of pending messages. Must be called with the lock
+    /// (AtomicHolder on this) held.
+    QueueType *queue_locked()
+    {
+        return &queue_;
+    }
+
 private:
     /** Implementation of the queue. */
     QueueType queue_;
@@ -81,6 +81,225 @@ void ActiveTimers::run()
     // call.
 }
 
+#if OPENMRN_FEATURE_TIMER_WHEEL
+
+long long ActiveTimers::get_next_timeout()
+{
+    OSMutexLock l(&lock_);
+
+    if (!numTimers_)
+    {
+        // Wakes up the timer service every now and then. It won't make any
+        // difference.
+        return SEC_TO_NSEC(3600);
+    }
+    long long now = OSTime::get_monotonic();
+    long long now_tick = now >> TICK_SHIFT;
+    bool found_timer = false;
+    // Every timer in the slots of the passed ticks is expired.
+    while (currentTick_ < now_tick && numTimers_)
+    {
+        if (!(currentTick_ & SLOT_MASK) && level0_empty_locked())
+        {
+            // Skips a whole rotation of empty slots.
+            if (currentTick_ + NUM_SLOTS > now_tick)
+            {
+                currentTick_ = now_tick;
+                break;
+            }
+            currentTick_ += NUM_SLOTS;
+            cascade_locked();
+            continue;
+        }
+        QMember **head = &wheel_[0][currentTick_ & SLOT_MASK];
+        while (*head)
+        {
+            found_timer = true;
+            expire_locked(static_cast<Timer *>(*head));
+        }
+        ++currentTick_;
+        cascade_locked();
+    }
+    if (!numTimers_)
+    {
+        currentTick_ = now_tick;
+        return found_timer ? 0 : SEC_TO_NSEC(3600);
+    }
+    // Timers in the current tick need to be checked one by one.
+    long long next_when = INT64_MAX;
+    Timer *t = static_cast<Timer *>(wheel_[0][currentTick_ & SLOT_MASK]);
+    while (t)
+    {
+        Timer *tn = static_cast<Timer *>(t->next);
+        if (t->when_ <= now)
+        {
+            found_timer = true;
+            expire_locked(t);
+        }
+        else if (t->when_ < next_when)
+        {
+            next_when = t->when_;
+        }
+        t = tn;
+    }
+    if (found_timer)
+    {
+        return 0;
+    }
+    if (next_when == INT64_MAX)
+    {
+        // Finds the next non-empty slot on level 0. All timers on level 0
+        // are within one rotation, so the slot order is the time order.
+        for (unsigned i = 1; i < NUM_SLOTS; ++i)
+        {
+            t = static_cast<Timer *>(
+                wheel_[0][(currentTick_ + i) & SLOT_MASK]);
+            for (; t; t = static_cast<Timer *>(t->next))
+            {
+                next_when = std::min(next_when, t->when_);
+            }
+            if (next_when != INT64_MAX)
+            {
+                break;
+            }
+        }
+    }
+    if (next_when == INT64_MAX)
+    {
+        // Level 0 is empty; we need to wake up at the next cascade.
+        next_when = ((currentTick_ | SLOT_MASK) + 1) << TICK_SHIFT;
+    }
+    return next_when - now;
+}
+
+bool ActiveTimers::empty()
+{
+    OSMutexLock l(&lock_);
+    return numTimers_ == 0;
+}
+
+void ActiveTimers::schedule_timer(Timer *timer)
+{
+    OSMutexLock l(&lock_);
+    insert_locked(timer);
+}
+
+void ActiveTimers::insert_locked(Timer *timer)
+{
+    HASSERT(timer);
+    HASSERT(timer->next == nullptr);
+    if (!numTimers_)
+    {
+        // The wheel is empty; we can start counting ticks from now.
+        currentTick_ = OSTime::get_monotonic() >> TICK_SHIFT;
+    }
+    link_locked(timer);
+    ++numTimers_;
+
+    // This will wake up the executor, which will schedule all expired timers
+    // and recompute sleep length.
+    notify();
+}
+
+void ActiveTimers::link_locked(Timer *timer)
+{
+    long long tick = timer->when_ >> TICK_SHIFT;
+    if (tick < currentTick_)
+    {
+        tick = currentTick_;
+    }
+    long long delta = tick - currentTick_;
+    unsigned level = 0;
+    while (level < NUM_LEVELS - 1 &&
+        delta >= (1LL << (SLOT_BITS * (level + 1))))
+    {
+        ++level;
+    }
+    if (delta >= (1LL << (SLOT_BITS * NUM_LEVELS)))
+    {
+        // Beyond the range of the wheel. Will be re-examined at the last
+        // cascade of the top level.
+        tick = currentTick_ + (1LL << (SLOT_BITS * NUM_LEVELS)) - 1;
+    }
+    QMember **head =
+        &wheel_[level][(tick >> (SLOT_BITS * level)) & SLOT_MASK];
+    timer->next = *head;
+    if (*head)
+    {
+        static_cast<Timer *>(*head)->prevLink_ = &timer->next;
+    }
+    *head = timer;
+    timer->prevLink_ = head;
+}
+
+void ActiveTimers::unlink_locked(Timer *timer)
+{
+    HASSERT(timer->prevLink_);
+    *timer->prevLink_ = timer->next;
+    if (timer->next)
+    {
+        static_cast<Timer *>(timer->next)->prevLink_ = timer->prevLink_;
+    }
+    timer->next = nullptr;
+    timer->prevLink_ = nullptr;
+}
+
+void ActiveTimers::expire_locked(Timer *timer)
+{
+    unlink_locked(timer);
+    --numTimers_;
+    timer->isActive_ = 0;
+    timer->isExpired_ = 1;
+    // Puts it on the executor.
+    executor_->add(timer, timer->priority_);
+}
+
+bool ActiveTimers::level0_empty_locked()
+{
+    for (unsigned i = 0; i < NUM_SLOTS; ++i)
+    {
+        if (wheel_[0][i])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void ActiveTimers::cascade_locked()
+{
+    for (unsigned level = 1; level < NUM_LEVELS; ++level)
+    {
+        if (currentTick_ & ((1LL << (SLOT_BITS * level)) - 1))
+        {
+            // Level below did not wrap around.
+            return;
+        }
+        QMember **head = &wheel_[level]
+                                [(currentTick_ >> (SLOT_BITS * level)) &
+                                    SLOT_MASK];
+        QMember *t = *head;
+        *head = nullptr;
+        while (t)
+        {
+            Timer *timer = static_cast<Timer *>(t);
+            t = timer->next;
+            timer->next = nullptr;
+            timer->prevLink_ = nullptr;
+            link_locked(timer);
+        }
+    }
+}
+
+void ActiveTimers::remove_locked(Timer *timer)
+{
+    HASSERT(timer);
+    unlink_locked(timer);
+    --numTimers_;
+}
+
+#else
+
 long long ActiveTimers::get_next_timeout()
 {
     OSMutexLock l(&lock_);
@@ -170,6 +389,8 @@ void ActiveTimers::remove_locked(Timer *timer)
     timer->next = nullptr;
 }
 
+#endif // OPENMRN_FEATURE_TIMER_WHEEL
+
 void ActiveTimers::update_timer(Timer *timer)
 {
     HASSERT(timer);
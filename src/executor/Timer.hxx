@@ -36,6 +36,7 @@
 #define _EXECUTOR_TIMER_HXX_
 
 #include "executor/Notifiable.hxx"
+#include "openmrn_features.h"
 #include "utils/Buffer.hxx"
 #include "utils/QMember.hxx"
 #include "os/OS.hxx"
@@ -44,7 +45,16 @@ class Timer;
 class ExecutorBase;
 
 /** Class that manages the list of active timers. The Executor uses this class
- * tightly in its sleep-execute loop. */
+ * tightly in its sleep-execute loop.
+ *
+ * By default the timers are kept in a list sorted by expiration time. With
+ * OPENMRN_FEATURE_TIMER_WHEEL the timers are kept in a hierarchical timing
+ * wheel instead: NUM_LEVELS levels of NUM_SLOTS slots each, where a level 0
+ * slot spans one tick (2^TICK_SHIFT nsec, about 1 msec), and each slot of a
+ * higher level spans a whole rotation of the level below. Timers are
+ * cascaded down a level when the lower level wraps around. Timers in the
+ * current tick are checked against their exact expiration time, so the
+ * precision is the same as with the sorted list. */
 class ActiveTimers : public Executable
 {
 public:
@@ -55,6 +65,15 @@ public:
         : executor_(executor)
         , isPending_(0)
     {
+#if OPENMRN_FEATURE_TIMER_WHEEL
+        for (unsigned l = 0; l < NUM_LEVELS; ++l)
+        {
+            for (unsigned i = 0; i < NUM_SLOTS; ++i)
+            {
+                wheel_[l][i] = nullptr;
+            }
+        }
+#endif
     }
 
     ~ActiveTimers();
@@ -113,12 +132,58 @@ private:
      * @param timer what to insert into the active list. */
     void insert_locked(::Timer *timer);
 
+#if OPENMRN_FEATURE_TIMER_WHEEL
+    /// Number of bits of the nanosecond time that make up one tick.
+    static constexpr unsigned TICK_SHIFT = 20;
+    /// Number of bits of the tick that are indexed in one level.
+    static constexpr unsigned SLOT_BITS = 6;
+    /// Number of slots in one level of the wheel.
+    static constexpr unsigned NUM_SLOTS = 1u << SLOT_BITS;
+    /// Mask for the slot index of one level.
+    static constexpr unsigned SLOT_MASK = NUM_SLOTS - 1;
+    /// Number of levels in the wheel. Timers further out than
+    /// 2^(SLOT_BITS*NUM_LEVELS) ticks (about 4.9 hours) are parked in the
+    /// last slot of the top level and re-cascaded from there.
+    static constexpr unsigned NUM_LEVELS = 4;
+
+    /** Puts a timer into the wheel slot that belongs to its expiration
+     * time. Does not wake up the executor. Caller must hold the lock.
+     * @param timer what to insert. */
+    void link_locked(::Timer *timer);
+
+    /** Takes a timer out of its wheel slot. Caller must hold the lock.
+     * @param timer what to remove. */
+    void unlink_locked(::Timer *timer);
+
+    /** Takes a timer out of the wheel and puts it onto the executor. Caller
+     * must hold the lock.
+     * @param timer the expired timer. */
+    void expire_locked(::Timer *timer);
+
+    /** @return true if there are no timers on level 0 of the wheel. Caller
+     * must hold the lock. */
+    bool level0_empty_locked();
+
+    /** Moves the timers of the higher levels down as currentTick_ enters a
+     * new rotation of the lower level. Caller must hold the lock. */
+    void cascade_locked();
+
+    /// Slot heads of the wheel. The timers in a slot are doubly linked.
+    QMember *wheel_[NUM_LEVELS][NUM_SLOTS];
+    /// The tick of the level 0 slot that is being processed.
+    long long currentTick_ {0};
+    /// Number of timers in the wheel.
+    unsigned numTimers_ {0};
+#endif
+
     /// Parent.
     ExecutorBase *executor_;
     /// Protects the timer list.
     OSMutex lock_;
+#if !OPENMRN_FEATURE_TIMER_WHEEL
     /// List of timers that are scheduled.
     QMember activeTimers_;
+#endif
     /// 1 if we in the executor's queue.
     std::atomic_uint_least8_t isPending_;
 
@@ -287,6 +352,11 @@ private:
 
     /** Points to the executor's timer structure. Not owned. */
     ActiveTimers *activeTimers_;
+#if OPENMRN_FEATURE_TIMER_WHEEL
+    /** Points to the link (slot head or previous timer's next) that points
+     * to this timer in the timing wheel. nullptr when not in the wheel. */
+    QMember **prevLink_ {nullptr};
+#endif
     /** what priority to schedule this timer at */
     unsigned priority_;
     /** when in nanoseconds timer should expire */
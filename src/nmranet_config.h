@@ -78,6 +78,15 @@ DECLARE_CONST(executor_select_prescaler);
  */
 DECLARE_CONST(executor_max_sleep_msec);
 
+/** Run budget of executors in batch mode.
+ *
+ * When non-zero, the executor takes up to this many Executables from each
+ * priority band at once and runs them back to back, checking timers and
+ * select only once per batch. Zero runs one Executable at a time. Can be
+ * changed at runtime by ExecutorBase::set_run_budget().
+ */
+DECLARE_CONST(executor_run_budget);
+
 /** Number of packets to queue in the CANbus device driver for send. Each packet
  * takes 16 bytes of RAM. */
 DECLARE_CONST(can_tx_buffer_size);
@@ -104,6 +113,16 @@ DECLARE_CONST(gridconnect_bridge_max_incoming_packets);
 /// output socket cannot send the data fast enough.
 DECLARE_CONST(gridconnect_bridge_max_outgoing_packets);
 
+/** Maximum number of buffers waiting to be written to the fd of a
+ * gridconnect port (such as a TCP client). 0 for no limit. Keep this below
+ * gridconnect_bridge_max_outgoing_packets when that is set, otherwise the
+ * bridge stalls before the port limit takes effect. */
+DECLARE_CONST(gridconnect_port_write_queue_limit);
+/** What happens when the write queue of a gridconnect port is full: 1 = drop
+ * the oldest buffer, 2 = drop event traffic first, 3 = close the
+ * connection. See HubQueuePolicy. */
+DECLARE_CONST(gridconnect_port_write_queue_policy);
+
 /** Number of bytes of gridconnect data to buffer before sending off the
  * lowlevel system (such as TCP socket). */
 DECLARE_CONST(gridconnect_buffer_size);
@@ -112,6 +131,11 @@ DECLARE_CONST(gridconnect_buffer_size);
  * off to the lowlevel system (such as a TCP socket). */
 DECLARE_CONST(gridconnect_buffer_delay_usec);
 
+/** If true, the gridconnect output buffering delay is sized from the measured
+ * packet rate, and gridconnect_buffer_delay_usec is used as the upper bound
+ * of the delay. */
+DECLARE_CONST(gridconnect_buffer_adaptive);
+
 /** Whether the GridConnect TCP server should use select (single-threaded) or
  * two threads per client (multi-threaded) execution model. */
 DECLARE_CONST(gridconnect_tcp_use_select);
@@ -119,13 +143,22 @@ DECLARE_CONST(gridconnect_tcp_use_select);
 /** Number of entries in the remote alias cache */
 DECLARE_CONST(remote_alias_cache_size);
 
+/** Set to CONSTANT_TRUE to index the remote alias cache with hash tables
+ * instead of sorted vectors. Recommended for caches with thousands of
+ * entries. */
+DECLARE_CONST(remote_alias_cache_hashed);
+
 /** Number of entries in the local alias cache */
 DECLARE_CONST(local_alias_cache_size);
 
-/** Keep this many allocated but unused aliases around. (Currently supported
- * values are 0 or 1.) */
+/** Keep this many allocated but unused aliases around. The local alias cache
+ * has to have room for them in addition to the local nodes. */
 DECLARE_CONST(reserve_unused_alias_count);
 
+/** Start reserving new aliases when only this many allocated but unused
+ * aliases (including the ones being reserved) are left. */
+DECLARE_CONST(reserve_unused_alias_low_watermark);
+
 /** Maximum number of local nodes */
 DECLARE_CONST(local_nodes_count);
 
@@ -162,6 +195,11 @@ DECLARE_CONST(bulk_alias_num_can_frames);
  * StreamReceiver }. */
 DECLARE_CONST(stream_receiver_default_window_size);
 
+/** How many stream windows { @ref StreamReceiver } may keep in RAM. With
+ * more than two, the receiver grants windows ahead of time on links where
+ * the stream proceed round trip takes longer than receiving a window. */
+DECLARE_CONST(stream_receiver_window_count);
+
 /** Stack size for @ref SocketListener threads. */
 DECLARE_CONST(socket_listener_stack_size);
 
@@ -49,6 +49,7 @@ AliasAllocator::AliasAllocator(NodeID if_id, IfCan *if_can)
     , cid_frame_sequence_(0)
     , conflict_detected_(0)
     , reserveUnusedAliases_(config_reserve_unused_alias_count())
+    , reserveLowWatermark_(config_reserve_unused_alias_low_watermark())
 {
     reinit_seed();
     // Moves all the allocated alias buffers over to the input queue for
@@ -102,6 +103,41 @@ unsigned AliasAllocator::num_reserved_aliases()
     return cnt;
 }
 
+void AliasAllocator::send(Buffer<AliasInfo> *msg, unsigned priority)
+{
+    {
+        AtomicHolder h(this);
+        ++numPending_;
+    }
+    StateFlow<Buffer<AliasInfo>, QList<1>>::send(msg, priority);
+}
+
+void AliasAllocator::refill_reserved_aliases()
+{
+    unsigned have = num_reserved_aliases() + numPending_;
+    if (have > reserveLowWatermark_)
+    {
+        return;
+    }
+    for (; have < reserveUnusedAliases_; ++have)
+    {
+        Buffer<AliasInfo> *b = alloc();
+        b->data()->do_not_reallocate();
+        this->send(b);
+    }
+}
+
+void AliasAllocator::record_alias_latency(long long nsec)
+{
+    unsigned bucket = 0;
+    for (long long limit = MSEC_TO_NSEC(1);
+         bucket < NUM_LATENCY_BUCKETS - 1 && nsec >= limit; limit *= 10)
+    {
+        ++bucket;
+    }
+    ++latencyHistogram_[bucket];
+}
+
 /** Removes all aliases that are reserved but not yet used. */
 void AliasAllocator::clear_reserved_aliases()
 {
@@ -161,7 +197,6 @@ NodeAlias AliasAllocator::get_allocated_alias(
 {
     NodeID found_id;
     NodeAlias found_alias = 0;
-    bool allocate_new = false;
     bool found = if_can()->local_aliases()->next_entry(
         CanDefs::get_reserved_alias_node_id(0), &found_id, &found_alias);
     if (found)
@@ -171,31 +206,16 @@ NodeAlias AliasAllocator::get_allocated_alias(
     if (found)
     {
         if_can()->local_aliases()->add(destination_id, found_alias);
-        if (reserveUnusedAliases_)
-        {
-            NodeID next_id;
-            NodeAlias next_alias = 0;
-            if (!if_can()->local_aliases()->next_entry(
-                    CanDefs::get_reserved_alias_node_id(0), &next_id,
-                    &next_alias) ||
-                !CanDefs::is_reserved_alias_node_id(next_id))
-            {
-                allocate_new = true;
-            }
-        }
     }
     else
     {
         found_alias = 0;
-        allocate_new = true;
         waitingClients_.insert(done);
-    }
-    if (allocate_new)
-    {
         Buffer<AliasInfo> *b = alloc();
         b->data()->do_not_reallocate();
         this->send(b);
     }
+    refill_reserved_aliases();
     return found_alias;
 }
 
@@ -339,6 +359,10 @@ StateFlowBase::Action AliasAllocator::send_rid_frame()
     if_can()->frame_dispatcher()->unregister_handler(
         &conflictHandler_, pending_alias()->alias, ~0x1FFFF000U);
     add_allocated_alias(pending_alias()->alias);
+    {
+        AtomicHolder h(this);
+        --numPending_;
+    }
     return release_and_exit();
 }
 
@@ -91,6 +91,14 @@ struct AliasInfo
  *
  * Users who need an allocated alias should get it from the queue in
  * reserved_aliases().
+ *
+ * The allocator keeps a pool of reserve_unused_alias_count reserved but
+ * unused aliases, so that new virtual nodes (e.g. trains created on demand)
+ * get an alias without waiting for the 200 msec conflict window. When the
+ * pool (counting the reservations in progress) drops to
+ * reserve_unused_alias_low_watermark, it is refilled in the background. The
+ * pool is kept in the local alias cache, so local_alias_cache_size has to
+ * account for it.
  */
 class AliasAllocator : public StateFlow<Buffer<AliasInfo>, QList<1>>
 {
@@ -144,6 +152,32 @@ public:
      * virtual nodes to use. */
     unsigned num_reserved_aliases();
 
+    /** @return the number of alias reservations in progress. */
+    unsigned num_pending_aliases()
+    {
+        return numPending_;
+    }
+
+    /** Sends a buffer for reserving a new alias. @param msg is the buffer.
+     * @param priority is ignored. */
+    void send(Buffer<AliasInfo> *msg, unsigned priority = UINT_MAX) override;
+
+    /// Number of buckets in the alias latency histogram.
+    static constexpr unsigned NUM_LATENCY_BUCKETS = 5;
+
+    /** Records how long a node waited for its alias.
+     * @param nsec the time from asking for the alias until getting it. */
+    void record_alias_latency(long long nsec);
+
+    /** @return how many nodes got their alias with a latency in a given
+     * bucket. @param bucket is 0 for less than 1 msec, 1, 2 and 3 for less
+     * than 10, 100 and 1000 msec, and 4 for the rest. */
+    unsigned alias_latency_count(unsigned bucket)
+    {
+        HASSERT(bucket < NUM_LATENCY_BUCKETS);
+        return latencyHistogram_[bucket];
+    }
+
     /** Removes all aliases that are reserved but not yet used. */
     void clear_reserved_aliases();
 
@@ -207,6 +241,10 @@ private:
     /// Generates the next alias to check in the seed_ variable.
     void next_seed();
 
+    /// Starts reserving new aliases if the pool of reserved aliases is at or
+    /// below the low watermark.
+    void refill_reserved_aliases();
+
     friend class AsyncAliasAllocatorTest;
     friend class AsyncIfTest;
 
@@ -233,9 +271,16 @@ private:
     /// Seed for generating random-looking alias numbers.
     unsigned seed_ : 12;
 
-    /// How many unused aliases we should reserve. Currently we only support 0
-    /// or 1 as value.
+    /// How many unused aliases we should reserve.
     unsigned reserveUnusedAliases_ : 8;
+    /// Refill the reserved aliases when there are this many or fewer.
+    unsigned reserveLowWatermark_ : 8;
+
+    /// How many alias reservation buffers are queued or being processed.
+    uint16_t numPending_ {0};
+
+    /// Alias latency histogram, see alias_latency_count().
+    uint32_t latencyHistogram_[NUM_LATENCY_BUCKETS] = {};
 
     /// Notifiable used for tracking outgoing frames.
     BarrierNotifiable n_;
@@ -48,12 +48,13 @@ namespace openlcb
 #define CONSTANT 0x1B0CA37ABA9 /**< constant for random number generation */
 
 /// This code removes the unique bits in the stored node alias in case this is
-/// a NOT_RESPONDING entry.
+/// a NOT_RESPONDING entry. Valid aliases are 12 bits, every larger stored
+/// value is a NOT_RESPONDING entry.
 /// @param stored alias in the metadata storage
 /// @return the alias if it's valid or NOT_RESPONDING ifthis is a sentinel
 static NodeAlias resolve_notresponding(NodeAlias stored)
 {
-    if ((stored & NOT_RESPONDING) == NOT_RESPONDING)
+    if (stored > 0xFFF)
     {
         return NOT_RESPONDING;
     }
@@ -71,7 +72,22 @@ int AliasCache::check_consistency()
         LOG(INFO, "idmap size != aliasmap size.");
         return 1;
     }
-    if (aliasMap.size() == entries)
+    if (aliasHash)
+    {
+        size_t alias_count = 0;
+        size_t id_count = 0;
+        for (size_t i = 0; i <= hashMask; ++i)
+        {
+            alias_count += aliasHash[i].empty() ? 0 : 1;
+            id_count += idHash[i].empty() ? 0 : 1;
+        }
+        if (alias_count != hashCount || id_count != hashCount)
+        {
+            LOG(INFO, "Hash table sizes are incorrect.");
+            return 28;
+        }
+    }
+    if (num_used() == entries)
     {
         if (!freeList.empty())
         {
@@ -87,7 +103,7 @@ int AliasCache::check_consistency()
             return 3;
         }
     }
-    if (aliasMap.size() == 0 && (!oldest.empty() || !newest.empty()))
+    if (num_used() == 0 && (!oldest.empty() || !newest.empty()))
     {
         LOG(INFO, "LRU head/tail elements should be null when map is empty.");
         return 4;
@@ -103,7 +119,7 @@ int AliasCache::check_consistency()
         }
         free_entries.insert(m);
     }
-    if (free_entries.size() + aliasMap.size() != entries)
+    if (free_entries.size() + num_used() != entries)
     {
         LOG(INFO, "Lost some metadata entries.");
         return 6;
@@ -124,7 +140,7 @@ int AliasCache::check_consistency()
             return 20;
         }
     }
-    if (aliasMap.size() == 0)
+    if (num_used() == 0)
     {
         if (!oldest.empty())
         {
@@ -160,7 +176,7 @@ int AliasCache::check_consistency()
             return 12; // newest is free
         }
     }
-    if (aliasMap.size() == 0)
+    if (num_used() == 0)
     {
         return 0;
     }
@@ -194,7 +210,7 @@ int AliasCache::check_consistency()
             LOG(INFO, "Prev link points to newest.");
             return 18;
         }
-        if (count != aliasMap.size())
+        if (count != num_used())
         {
             LOG(INFO, "LRU link list length is incorrect.");
             return 27;
@@ -235,23 +251,23 @@ int AliasCache::check_consistency()
             continue;
         }
         auto *e = pool + i;
-        if (idMap.find(e->get_node_id()) == idMap.end())
+        if (find_id(e->get_node_id()).empty())
         {
             LOG(INFO, "Metadata ID is not in the id map.");
             return 23;
         }
-        if (idMap.find(e->get_node_id())->idx_ != i)
+        if (find_id(e->get_node_id()).idx_ != i)
         {
             LOG(INFO,
                 "Id map entry does not point back to the expected index.");
             return 24;
         }
-        if (aliasMap.find(e->alias_) == aliasMap.end())
+        if (find_alias(e->alias_).empty())
         {
             LOG(INFO, "Metadata alias is not in the alias map.");
             return 25;
         }
-        if (aliasMap.find(e->alias_)->idx_ != i)
+        if (find_alias(e->alias_).idx_ != i)
         {
             LOG(INFO,
                 "Alis map entry does not point back to the expected index.");
@@ -263,10 +279,158 @@ int AliasCache::check_consistency()
 
 #endif
 
+void AliasCache::init_hash_index()
+{
+    size_t slots = 4;
+    while (slots < entries * 2)
+    {
+        slots <<= 1;
+    }
+    hashMask = slots - 1;
+    aliasHash = new PoolIdx[slots];
+    idHash = new PoolIdx[slots];
+}
+
+/// Mixes the bits of a key for hash indexing (finalizer of MurmurHash3).
+/// @param key the key to hash
+/// @return hash value
+static uint32_t hash_key(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return key;
+}
+
+size_t AliasCache::alias_home(NodeAlias alias)
+{
+    return hash_key(alias) & hashMask;
+}
+
+size_t AliasCache::id_home(NodeID id)
+{
+    return hash_key(id) & hashMask;
+}
+
+size_t AliasCache::alias_slot(NodeAlias alias)
+{
+    size_t slot = alias_home(alias);
+    // There is always an empty slot since the tables are at most half full.
+    while (!aliasHash[slot].empty() &&
+        aliasHash[slot].deref(this)->alias_ != alias)
+    {
+        slot = (slot + 1) & hashMask;
+    }
+    return slot;
+}
+
+size_t AliasCache::id_slot(NodeID id)
+{
+    size_t slot = id_home(id);
+    while (!idHash[slot].empty() &&
+        idHash[slot].deref(this)->get_node_id() != id)
+    {
+        slot = (slot + 1) & hashMask;
+    }
+    return slot;
+}
+
+void AliasCache::hash_erase(PoolIdx *table, size_t slot)
+{
+    size_t next = slot;
+    while (true)
+    {
+        next = (next + 1) & hashMask;
+        if (table[next].empty())
+        {
+            break;
+        }
+        Metadata *m = table[next].deref(this);
+        size_t home = table == aliasHash ? alias_home(m->alias_)
+                                         : id_home(m->get_node_id());
+        // The entry at next can be moved back to slot unless its home is
+        // cyclically in (slot, next].
+        if (((next - home) & hashMask) >= ((next - slot) & hashMask))
+        {
+            table[slot] = table[next];
+            slot = next;
+        }
+    }
+    table[slot].idx_ = NONE_ENTRY;
+}
+
+AliasCache::PoolIdx AliasCache::find_alias(NodeAlias alias)
+{
+    if (aliasHash)
+    {
+        return aliasHash[alias_slot(alias)];
+    }
+    auto it = aliasMap.find(alias);
+    if (it == aliasMap.end())
+    {
+        return PoolIdx();
+    }
+    return *it;
+}
+
+AliasCache::PoolIdx AliasCache::find_id(NodeID id)
+{
+    if (idHash)
+    {
+        return idHash[id_slot(id)];
+    }
+    auto it = idMap.find(id);
+    if (it == idMap.end())
+    {
+        return PoolIdx();
+    }
+    return *it;
+}
+
+void AliasCache::index_add(PoolIdx n)
+{
+    if (aliasHash)
+    {
+        Metadata *m = n.deref(this);
+        size_t slot = alias_slot(m->alias_);
+        HASSERT(aliasHash[slot].empty());
+        aliasHash[slot] = n;
+        slot = id_slot(m->get_node_id());
+        HASSERT(idHash[slot].empty());
+        idHash[slot] = n;
+        ++hashCount;
+        return;
+    }
+    aliasMap.insert(PoolIdx(n));
+    idMap.insert(PoolIdx(n));
+}
+
+void AliasCache::index_remove(Metadata *metadata)
+{
+    if (aliasHash)
+    {
+        hash_erase(aliasHash, alias_slot(metadata->alias_));
+        hash_erase(idHash, id_slot(metadata->get_node_id()));
+        --hashCount;
+        return;
+    }
+    aliasMap.erase(aliasMap.find(metadata->alias_));
+    idMap.erase(idMap.find(metadata->get_node_id()));
+}
+
 void AliasCache::clear()
 {
     idMap.clear();
     aliasMap.clear();
+    if (aliasHash)
+    {
+        for (size_t i = 0; i <= hashMask; ++i)
+        {
+            aliasHash[i].idx_ = NONE_ENTRY;
+            idHash[i].idx_ = NONE_ENTRY;
+        }
+        hashCount = 0;
+    }
     oldest.idx_ = NONE_ENTRY;
     newest.idx_ = NONE_ENTRY;
     freeList.idx_ = NONE_ENTRY;
@@ -301,16 +465,16 @@ void AliasCache::add(NodeID id, NodeAlias alias)
     
     Metadata *insert;
 
-    auto it = aliasMap.find(alias);
-    if (alias == NOT_RESPONDING)
+    PoolIdx it;
+    if (alias != NOT_RESPONDING)
     {
         // We can have more than one NOT_RESPONDING entry.
-        it = aliasMap.end();
+        it = find_alias(alias);
     }
-    if (it != aliasMap.end())
+    if (!it.empty())
     {
         /* we already have a mapping for this alias, so lets remove it */
-        insert = it->deref(this);
+        insert = it.deref(this);
         remove(insert->alias_);
 
         if (removeCallback)
@@ -319,11 +483,11 @@ void AliasCache::add(NodeID id, NodeAlias alias)
             (*removeCallback)(insert->get_node_id(), insert->alias_, context);
         }
     }
-    auto nit = idMap.find(id);
-    if (nit != idMap.end())
+    PoolIdx nit = find_id(id);
+    if (!nit.empty())
     {
         /* we already have a mapping for this id, so lets remove it */
-        insert = nit->deref(this);
+        insert = nit.deref(this);
         remove(insert->alias_);
 
         if (removeCallback)
@@ -356,8 +520,7 @@ void AliasCache::add(NodeID id, NodeAlias alias)
         }
         oldest = second;
 
-        aliasMap.erase(aliasMap.find(insert->alias_));
-        idMap.erase(idMap.find(insert->get_node_id()));
+        index_remove(insert);
 
         if (removeCallback)
         {
@@ -369,18 +532,18 @@ void AliasCache::add(NodeID id, NodeAlias alias)
     if (alias == NOT_RESPONDING)
     {
         // This code will make all NOT_RESPONDING aliases unique in our map.
+        // The first 4096 entries use NOT_RESPONDING | ofs, the others their
+        // own index (which is between 0x1000 and NOT_RESPONDING).
         unsigned ofs = insert - pool;
-        alias = NOT_RESPONDING | ofs;
-        auto it = aliasMap.find(alias);
-        HASSERT(it == aliasMap.end());
+        alias = ofs < 0x1000 ? (NOT_RESPONDING | ofs) : ofs;
+        HASSERT(find_alias(alias).empty());
     }
     insert->set_node_id(id);
     insert->alias_ = alias;
 
     PoolIdx n;
     n.idx_ = insert - pool;
-    aliasMap.insert(PoolIdx(n));
-    idMap.insert(PoolIdx(n));
+    index_add(n);
 
     /* update the time based list */
     insert->newer_.idx_ = NONE_ENTRY;
@@ -413,13 +576,12 @@ void AliasCache::add(NodeID id, NodeAlias alias)
  */
 void AliasCache::remove(NodeAlias alias)
 {
-    auto it = aliasMap.find(alias);
+    PoolIdx it = find_alias(alias);
 
-    if (it != aliasMap.end())
+    if (!it.empty())
     {
-        Metadata *metadata = it->deref(this);
-        aliasMap.erase(it);
-        idMap.erase(idMap.find(metadata->get_node_id()));
+        Metadata *metadata = it.deref(this);
+        index_remove(metadata);
 
         if (!metadata->newer_.empty())
         {
@@ -469,12 +631,34 @@ bool AliasCache::retrieve(unsigned entry, NodeID* node, NodeAlias* alias)
 
 bool AliasCache::next_entry(NodeID bound, NodeID *node, NodeAlias *alias)
 {
-    auto it = idMap.upper_bound(bound);
-    if (it == idMap.end())
+    Metadata *metadata = nullptr;
+    if (aliasHash)
     {
-        return false;
+        // The hash tables are not ordered; finds the smallest larger Node ID
+        // by walking all entries.
+        for (PoolIdx idx = newest; !idx.empty(); idx = idx.deref(this)->older_)
+        {
+            Metadata *m = idx.deref(this);
+            NodeID id = m->get_node_id();
+            if (id > bound && (!metadata || id < metadata->get_node_id()))
+            {
+                metadata = m;
+            }
+        }
+        if (!metadata)
+        {
+            return false;
+        }
+    }
+    else
+    {
+        auto it = idMap.upper_bound(bound);
+        if (it == idMap.end())
+        {
+            return false;
+        }
+        metadata = it->deref(this);
     }
-    Metadata *metadata = it->deref(this);
     if (alias)
     {
         *alias = resolve_notresponding(metadata->alias_);
@@ -494,11 +678,11 @@ NodeAlias AliasCache::lookup(NodeID id)
 {
     HASSERT(id != 0);
 
-    auto it = idMap.find(id);
+    PoolIdx it = find_id(id);
 
-    if (it != idMap.end())
+    if (!it.empty())
     {
-        Metadata *metadata = it->deref(this);
+        Metadata *metadata = it.deref(this);
 
         /* update timestamp */
         touch(metadata);
@@ -517,11 +701,11 @@ NodeID AliasCache::lookup(NodeAlias alias)
 {
     HASSERT(alias != 0);
 
-    auto it = aliasMap.find(alias);
+    PoolIdx it = find_alias(alias);
 
-    if (it != aliasMap.end())
+    if (!it.empty())
     {
-        Metadata *metadata = it->deref(this);
+        Metadata *metadata = it.deref(this);
 
         /* update timestamp */
         touch(metadata);
@@ -82,6 +82,15 @@ namespace openlcb
  *
  * A similar sorted vector is kept sorted by the NodeID values. This also takes
  * only 2 bytes per entry.
+ *
+ * Inserting into or removing from the sorted vectors moves entries, and the
+ * next lookup sorts the vector again. For very large caches (thousands of
+ * entries with a lot of churn) the cache can instead be hash indexed: two
+ * open addressing hash tables (linear probing, backward shift deletion) of
+ * PoolIdx, one by alias and one by NodeID, make add, remove and lookup O(1).
+ * The tables have at least twice as many slots as entries, taking 4-8 bytes
+ * per entry for each of the two indexes. In this mode next_entry() walks the
+ * LRU list, which is O(n).
  */
 class AliasCache
 {
@@ -92,10 +101,12 @@ public:
      * @param remove_callback callback to call when we remove a mapping from
      *        the cache however it will not be called in the remove() method
      * @param context context pointer to pass to remove_callback
+     * @param hashed if true, the cache is indexed by hash tables instead of
+     *        sorted vectors (see theory of operation)
      */
     AliasCache(NodeID seed, size_t _entries,
         void (*remove_callback)(NodeID id, NodeAlias alias, void *) = NULL,
-        void *context = NULL)
+        void *context = NULL, bool hashed = false)
         : pool(new Metadata[_entries])
         , aliasMap(this)
         , idMap(this)
@@ -104,8 +115,16 @@ public:
         , removeCallback(remove_callback)
         , context(context)
     {
-        aliasMap.reserve(_entries);
-        idMap.reserve(_entries);
+        HASSERT(_entries <= NOT_RESPONDING);
+        if (hashed)
+        {
+            init_hash_index();
+        }
+        else
+        {
+            aliasMap.reserve(_entries);
+            idMap.reserve(_entries);
+        }
         clear();
     }
 
@@ -181,6 +200,8 @@ public:
     ~AliasCache()
     {
         delete [] pool;
+        delete [] aliasHash;
+        delete [] idHash;
     }
 
     /** Visible for testing. Check internal consistency. */
@@ -345,6 +366,20 @@ private:
     /** Map of Node ID to corresponding Metadata */
     IdMap idMap;
 
+    /** Hash table of pool indexes by alias, nullptr if the cache is not hash
+     * indexed. */
+    PoolIdx *aliasHash = nullptr;
+
+    /** Hash table of pool indexes by Node ID, nullptr if the cache is not hash
+     * indexed. */
+    PoolIdx *idHash = nullptr;
+
+    /** Number of slots in the hash tables minus one. */
+    size_t hashMask = 0;
+
+    /** Number of entries in the hash tables. */
+    size_t hashCount = 0;
+
     /** list of unused mapping entries (index into pool) */
     PoolIdx freeList;
 
@@ -371,6 +406,60 @@ private:
      */
     void touch(Metadata* metadata);
 
+    /** Allocates the hash tables. */
+    void init_hash_index();
+
+    /** @return the number of mappings in the cache. */
+    size_t num_used()
+    {
+        return aliasHash ? hashCount : aliasMap.size();
+    }
+
+    /** Looks up an entry by alias without touching it.
+     * @param alias the alias to look for
+     * @return the entry, or an empty PoolIdx if not found
+     */
+    PoolIdx find_alias(NodeAlias alias);
+
+    /** Looks up an entry by Node ID without touching it.
+     * @param id the Node ID to look for
+     * @return the entry, or an empty PoolIdx if not found
+     */
+    PoolIdx find_id(NodeID id);
+
+    /** Adds an entry to the alias and Node ID indexes.
+     * @param n the entry, with its alias and Node ID already set
+     */
+    void index_add(PoolIdx n);
+
+    /** Removes an entry from the alias and Node ID indexes.
+     * @param metadata the entry to remove, must be in the indexes
+     */
+    void index_remove(Metadata *metadata);
+
+    /** @return the home slot of an alias in aliasHash. @param alias is the
+     * alias to hash. */
+    size_t alias_home(NodeAlias alias);
+
+    /** @return the home slot of a Node ID in idHash. @param id is the Node ID
+     * to hash. */
+    size_t id_home(NodeID id);
+
+    /** @return the slot of aliasHash that holds an alias, or the empty slot
+     * where it would be inserted. @param alias is the alias to look for. */
+    size_t alias_slot(NodeAlias alias);
+
+    /** @return the slot of idHash that holds a Node ID, or the empty slot
+     * where it would be inserted. @param id is the Node ID to look for. */
+    size_t id_slot(NodeID id);
+
+    /** Empties a slot of a hash table, moving back the entries of the same
+     * probe sequence.
+     * @param table aliasHash or idHash
+     * @param slot the slot to empty
+     */
+    void hash_erase(PoolIdx *table, size_t slot);
+
     DISALLOW_COPY_AND_ASSIGN(AliasCache);
 };
 
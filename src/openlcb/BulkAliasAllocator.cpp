@@ -41,6 +41,13 @@ namespace openlcb
 
 /// Implementation of the BulkAliasAllocatorInterface to allocate many aliases
 /// at the same time.
+///
+/// The reservations are pipelined: CID frames for all aliases are sent back
+/// to back in batches, and each batch is timestamped when its frames left.
+/// Between batches, and after the last one, RID frames are sent for every
+/// alias whose 200 msec conflict window has elapsed. A conflict only drops
+/// the affected alias and queues a replacement; the rest of the aliases
+/// proceed.
 class BulkAliasAllocator : public CallableFlow<BulkAliasRequest>
 {
 public:
@@ -65,6 +72,7 @@ public:
     }
 
     /// Picks a bunch of random aliases, sends CID frames for them to the bus.
+    /// Also sends the RID frames that are due.
     Action send_cid_frames()
     {
         unsigned needed = std::min(request()->numAliases_,
@@ -74,6 +82,7 @@ public:
             return call_immediately(STATE(wait_for_results));
         }
         bn_.reset(this);
+        send_rid_frames(relative_time());
         for (unsigned i = 0; i < needed; ++i)
         {
             NodeAlias next_alias = if_can()->alias_allocator()->get_new_seed();
@@ -105,7 +114,7 @@ public:
     }
 
     /// Sends out the RID frames for any alias that the 200 msec has already
-    /// elapsed, then waits a bit and tries again.
+    /// elapsed, then sleeps until the next one is due and tries again.
     Action wait_for_results()
     {
         if (nextToClaim_ == pendingAliasesByTime_.size())
@@ -118,31 +127,24 @@ public:
             return call_immediately(STATE(send_cid_frames));
         }
         auto ctime = relative_time();
-        unsigned num_sent = 0;
         bn_.reset(this);
-        while ((nextToClaim_ < pendingAliasesByTime_.size()) &&
-            (num_sent < (unsigned)(config_bulk_alias_num_can_frames())) &&
-            (pendingAliasesByTime_[nextToClaim_].cidTime_ + ALLOCATE_DELAY <
-                ctime))
-        {
-            NodeAlias a =
-                (NodeAlias)(pendingAliasesByTime_[nextToClaim_].alias_);
-            ++nextToClaim_;
-            auto it = pendingAliasesByKey_.find(a);
-            if (it->hasConflict_)
-            {
-                // we skip this alias because there was a conflict.
-                continue;
-            }
-            if_can()->alias_allocator()->add_allocated_alias(a);
-            ++num_sent;
-            send_can_frame(a, CanDefs::RID_FRAME, 0);
-        }
+        send_rid_frames(ctime);
         if (bn_.abort_if_almost_done())
         {
             // no frame sent
+            unsigned sleep = 1;
+            if (nextToClaim_ < pendingAliasesByTime_.size())
+            {
+                unsigned due =
+                    pendingAliasesByTime_[nextToClaim_].cidTime_ +
+                    ALLOCATE_DELAY + 1;
+                if (due > ctime)
+                {
+                    sleep = due - ctime;
+                }
+            }
             return sleep_and_call(
-                &timer_, MSEC_TO_NSEC(10), STATE(wait_for_results));
+                &timer_, MSEC_TO_NSEC(10) * sleep, STATE(wait_for_results));
         }
         else
         {
@@ -162,19 +164,52 @@ public:
     }
 
 private:
+    /// Sends RID frames (at most bulk_alias_num_can_frames) for the aliases
+    /// whose conflict window has elapsed, and marks them allocated. Takes a
+    /// share of the barrier bn_ for each frame.
+    /// @param ctime current time from relative_time().
+    void send_rid_frames(unsigned ctime)
+    {
+        unsigned num_sent = 0;
+        while ((nextToClaim_ < pendingAliasesByTime_.size()) &&
+            (num_sent < (unsigned)(config_bulk_alias_num_can_frames())) &&
+            (pendingAliasesByTime_[nextToClaim_].cidTime_ + ALLOCATE_DELAY <
+                ctime))
+        {
+            NodeAlias a =
+                (NodeAlias)(pendingAliasesByTime_[nextToClaim_].alias_);
+            ++nextToClaim_;
+            auto it = pendingAliasesByKey_.find(a);
+            if (it->hasConflict_)
+            {
+                // we skip this alias because there was a conflict.
+                continue;
+            }
+            it->claimed_ = 1;
+            if_can()->alias_allocator()->add_allocated_alias(a);
+            ++num_sent;
+            send_can_frame(a, CanDefs::RID_FRAME, 0);
+        }
+    }
+
     /// Callback from the stack for all incoming frames while we are
     /// operating. We sniff the alias uot of it and record any conflicts we
-    /// see.
+    /// see. Conflicts on aliases that are already claimed are handled by the
+    /// interface like for any other local alias.
     /// @param message an incoming CAN frame.
     void handle_conflict(Buffer<CanMessageData> *message)
     {
         auto rb = get_buffer_deleter(message);
         auto alias = CanDefs::get_src(GET_CAN_FRAME_ID_EFF(*message->data()));
         auto it = pendingAliasesByKey_.find(alias);
-        if (it != pendingAliasesByKey_.end() && !it->hasConflict_)
+        if (it != pendingAliasesByKey_.end() && !it->hasConflict_ &&
+            !it->claimed_)
         {
             it->hasConflict_ = 1;
             ++request()->numAliases_;
+            // Wakes up the flow if it is sleeping until the next RID is due,
+            // to pick a replacement alias.
+            timer_.ensure_triggered();
         }
     }
 
@@ -226,8 +261,9 @@ private:
         /// The value of the alias
         unsigned alias_ : 12;
         /// The time when the CID requests were sent. Counter in
-        /// relative_time(), i.e. 10 msec per increment.
-        unsigned cidTime_ : 8;
+        /// relative_time(), i.e. 10 msec per increment. 20 bits do not wrap
+        /// around for almost three hours.
+        unsigned cidTime_ : 20;
     };
     static_assert(sizeof(PendingAliasInfo) == 4, "memory bloat");
 
@@ -239,6 +275,7 @@ private:
         AliasLookupInfo(NodeAlias alias)
             : alias_(alias)
             , hasConflict_(0)
+            , claimed_(0)
         {
         }
 
@@ -246,6 +283,8 @@ private:
         uint16_t alias_ : 12;
         /// 1 if we have seen a conflict
         uint16_t hasConflict_ : 1;
+        /// 1 if the RID frame was sent
+        uint16_t claimed_ : 1;
     };
     static_assert(sizeof(AliasLookupInfo) == 2, "memory bloat");
     /// Comparator function on AliasLookupInfo objects.
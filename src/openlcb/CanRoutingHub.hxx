@@ -113,7 +113,10 @@ public:
     {
         OSMutexLock l(&lock_);
         HASSERT(port);
-        ports_[port].hubPort_ = port;
+        auto &p = ports_[port];
+        p.hubPort_ = port;
+        p.eventBit_ = routingTable_.add_port(
+            reinterpret_cast<CanHubPortInterface *>(port));
     }
 
     void unregister_port(HubPortInterface *port)
@@ -166,6 +169,8 @@ private:
             for (void *p : parent_->pendingRemove_)
             {
                 parent_->ports_.erase(p);
+                parent_->routingTable_.remove_port(
+                    reinterpret_cast<CanHubPortInterface *>(p));
             }
             parent_->pendingRemove_.clear();
 
@@ -203,6 +208,11 @@ private:
                 }
             }
 
+            if (forwardType_ == EVENT)
+            {
+                eventPorts_ = parent_->routingTable_.lookup_event_ports(event_);
+            }
+
             nextIt_ = parent_->ports_.begin();
 
             return call_immediately(STATE(try_next_entry));
@@ -315,28 +325,28 @@ private:
         Action try_next_entry()
         {
             OSMutexLock l(&parent_->lock_);
-            if (nextIt_ == parent_->ports_.end())
-            {
-                return done_processing();
-            }
-
-            if (forwardType_ == EVENT)
+            for (; nextIt_ != parent_->ports_.end(); ++nextIt_)
             {
-                if (parent_->routingTable_.check_pcer(
-                        static_cast<CanHubPortInterface *>(nextIt_->first),
-                        event_))
+                if (forwardType_ == EVENT && !port_has_event())
                 {
-                    forward_to_port();
+                    continue;
                 }
-            }
-            else
-            {
-                // forward all
                 forward_to_port();
             }
+            return done_processing();
+        }
 
-            nextIt_++;
-            return again();
+        /// @return true if the port at nextIt_ has a consumer or producer
+        /// for event_.
+        bool port_has_event()
+        {
+            int bit = nextIt_->second.eventBit_;
+            if (bit >= 0)
+            {
+                return (eventPorts_ >> bit) & 1;
+            }
+            return parent_->routingTable_.check_pcer(
+                static_cast<CanHubPortInterface *>(nextIt_->first), event_);
         }
 
         Action forward_addressed()
@@ -406,6 +416,8 @@ private:
         NodeAlias srcAddress_;      //< for all OpenLCB frames
         NodeAlias dstAddress_;      //< for addressed frames
         EventId event_;             //< for PCER messages
+        /// Ports in the event index that want event_ (for PCER messages).
+        RoutingLogic<CanHubPortInterface, NodeAlias>::PortMask eventPorts_;
         PortsMap::iterator nextIt_; //< which port to consider next
         GcCanRoutingHub *parent_;
         /// Gridconnect-rendered frame.
@@ -425,6 +437,9 @@ private:
         GcStreamParser segmenter_;
         CanHubPortInterface *canPort_{nullptr};
         HubPortInterface *hubPort_{nullptr};
+        /// Bit of this port in the event routing index, -1 if the port is
+        /// not in the index.
+        int eventBit_{-1};
     };
     /// Keyed by the skipMember_ value of the incoming data from a given port.
     std::map<void *, PortParser> ports_;
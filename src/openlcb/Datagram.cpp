@@ -41,6 +41,122 @@ namespace openlcb
 /// ack/nack response message.
 long long DATAGRAM_RESPONSE_TIMEOUT_NSEC = SEC_TO_NSEC(3);
 
+constexpr long long DatagramPeerTable::MIN_TIMEOUT_NSEC;
+
+DatagramPeerTable::DatagramPeerTable()
+{
+    for (unsigned i = 0; i < NUM_PEERS; ++i)
+    {
+        peers_[i] = {0, 0, 0, 0, 1, 0};
+    }
+}
+
+DatagramPeerTable::Peer *DatagramPeerTable::find(NodeID dst, bool create)
+{
+    if (!dst)
+    {
+        return nullptr;
+    }
+    Peer *victim = nullptr;
+    for (unsigned i = 0; i < NUM_PEERS; ++i)
+    {
+        Peer *p = peers_ + i;
+        if (p->id == dst)
+        {
+            p->lastUse = ++useCounter_;
+            return p;
+        }
+        // Entries with a configured window are only replaced if there is no
+        // other choice.
+        if (!victim || (victim->window > 1 && p->window == 1) ||
+            ((victim->window > 1) == (p->window > 1) &&
+                p->lastUse < victim->lastUse))
+        {
+            victim = p;
+        }
+    }
+    if (!create)
+    {
+        return nullptr;
+    }
+    *victim = {dst, 0, 0, ++useCounter_, 1, 0};
+    return victim;
+}
+
+void DatagramPeerTable::set_window(NodeID dst, unsigned window)
+{
+    HASSERT(window >= 1 && window <= 255);
+    AtomicHolder h(this);
+    Peer *p = find(dst, true);
+    if (p)
+    {
+        p->window = window;
+    }
+}
+
+unsigned DatagramPeerTable::window(NodeID dst)
+{
+    AtomicHolder h(this);
+    Peer *p = find(dst, false);
+    return p ? p->window : 1;
+}
+
+void DatagramPeerTable::add_rtt_sample(NodeID dst, long long rtt)
+{
+    AtomicHolder h(this);
+    Peer *p = find(dst, true);
+    if (!p)
+    {
+        return;
+    }
+    if (!p->srtt)
+    {
+        p->srtt = rtt;
+        p->rttvar = rtt / 2;
+    }
+    else
+    {
+        long long diff = p->srtt > rtt ? p->srtt - rtt : rtt - p->srtt;
+        p->rttvar = (3 * p->rttvar + diff) / 4;
+        p->srtt = (7 * p->srtt + rtt) / 8;
+    }
+    p->backoff = 0;
+}
+
+void DatagramPeerTable::timeout_expired(NodeID dst)
+{
+    AtomicHolder h(this);
+    Peer *p = find(dst, false);
+    if (p && p->backoff < 8)
+    {
+        ++p->backoff;
+    }
+}
+
+long long DatagramPeerTable::rtt(NodeID dst)
+{
+    AtomicHolder h(this);
+    Peer *p = find(dst, false);
+    return p ? p->srtt : 0;
+}
+
+long long DatagramPeerTable::response_timeout(NodeID dst)
+{
+    if (!maxRetries_)
+    {
+        return DATAGRAM_RESPONSE_TIMEOUT_NSEC;
+    }
+    AtomicHolder h(this);
+    Peer *p = find(dst, false);
+    if (!p || !p->srtt)
+    {
+        return DATAGRAM_RESPONSE_TIMEOUT_NSEC;
+    }
+    long long timeout = std::max(p->srtt + 4 * p->rttvar, MIN_TIMEOUT_NSEC)
+        << p->backoff;
+    return std::min(timeout, DATAGRAM_RESPONSE_TIMEOUT_NSEC);
+}
+
 DatagramService::DatagramService(If* iface,
                                  size_t num_registry_entries)
     : Service(iface->executor()), iface_(iface), dispatcher_(iface_, num_registry_entries)
@@ -148,6 +148,106 @@ protected:
     uint32_t result_;
 };
 
+/** Per-destination settings and round trip time estimates, shared by the
+ * datagram clients of a DatagramService.
+ *
+ * By default a datagram client follows the standard: it sends one datagram
+ * to a destination at a time, waits DATAGRAM_RESPONSE_TIMEOUT_NSEC for the
+ * response and never resends. With set_max_retries() the clients resend a
+ * datagram after a timeout or a rejection with the RESEND_OK bit, and the
+ * timeout adapts to the measured round trip time of the destination (as in
+ * TCP: smoothed RTT plus four times its variance, doubled after each
+ * timeout). With set_window() more than one datagram can be outstanding to a
+ * destination that is known to support this. */
+class DatagramPeerTable : private Atomic
+{
+public:
+    /// How many destinations are tracked. When the table is full, the least
+    /// recently used destination with the default window is replaced.
+    static constexpr unsigned NUM_PEERS = 8;
+    /// Lower bound of the adaptive response timeout.
+    static constexpr long long MIN_TIMEOUT_NSEC = MSEC_TO_NSEC(50);
+
+    DatagramPeerTable();
+
+    /// Sets how many datagrams can be outstanding from one source node to a
+    /// destination. The standard allows only one. Use a larger value only if
+    /// the destination is known to have buffers for that many datagrams and
+    /// to process them in order, because the responses are matched to the
+    /// datagrams in the order of sending. (If a datagram is lost, the later
+    /// responses are attributed one datagram early until the timeout.)
+    /// @param dst Node ID of the destination.
+    /// @param window number of datagrams, between 1 and 255.
+    void set_window(NodeID dst, unsigned window);
+
+    /// @return how many datagrams can be outstanding to a destination.
+    /// @param dst Node ID of the destination.
+    unsigned window(NodeID dst);
+
+    /// Sets how many times a datagram is resent after a timeout or a
+    /// temporary rejection. 0 (the default) turns off resending and the
+    /// adaptive timeout. @param count number of resends, at most 255.
+    void set_max_retries(unsigned count)
+    {
+        maxRetries_ = std::min(count, 255u);
+    }
+
+    /// @return how many times a datagram may be resent.
+    unsigned max_retries()
+    {
+        return maxRetries_;
+    }
+
+    /// Updates the round trip time estimate of a destination.
+    /// @param dst Node ID of the destination.
+    /// @param rtt time between sending a datagram (that was not resent) and
+    /// receiving its response, in nanoseconds.
+    void add_rtt_sample(NodeID dst, long long rtt);
+
+    /// Doubles the response timeout of a destination until the next RTT
+    /// sample arrives. @param dst Node ID of the destination.
+    void timeout_expired(NodeID dst);
+
+    /// @return the smoothed round trip time of a destination in
+    /// nanoseconds, 0 if unknown. @param dst Node ID of the destination.
+    long long rtt(NodeID dst);
+
+    /// @return how long to wait for the response of a datagram sent to dst,
+    /// in nanoseconds. @param dst Node ID of the destination.
+    long long response_timeout(NodeID dst);
+
+private:
+    /// Information about one destination.
+    struct Peer
+    {
+        /// Node ID of the destination. 0 if the entry is free.
+        NodeID id;
+        /// Smoothed round trip time, 0 if there was no sample yet.
+        long long srtt;
+        /// Round trip time variance.
+        long long rttvar;
+        /// Value of useCounter_ at the last use of this entry.
+        uint32_t lastUse;
+        /// Number of datagrams that can be outstanding.
+        uint8_t window;
+        /// The timeout is doubled this many times.
+        uint8_t backoff;
+    };
+
+    /// Looks up a destination. Must be called with the lock held.
+    /// @param dst Node ID of the destination.
+    /// @param create if true, a new entry is created when dst is not found.
+    /// @return the entry, nullptr if not found and not created.
+    Peer *find(NodeID dst, bool create);
+
+    /// Tracked destinations.
+    Peer peers_[NUM_PEERS];
+    /// Incremented at every lookup; used for replacing entries.
+    uint32_t useCounter_ {0};
+    /// See set_max_retries().
+    uint8_t maxRetries_ {0};
+};
+
 /** Transport-agnostic dispatcher of datagrams.
  *
  * There will be typically one instance of this for each interface with virtual
@@ -193,6 +293,13 @@ public:
         return iface_;
     }
 
+    /// @return per-destination settings and statistics of the datagram
+    /// clients.
+    DatagramPeerTable *peers()
+    {
+        return &peers_;
+    }
+
 private:
     /** Class for routing incoming datagram messages to the datagram handlers.
      *
@@ -242,6 +349,9 @@ private:
     /// Datagram clients.
     TypedQAsync<DatagramClient> clients_;
 
+    /// Per-destination settings of the datagram clients.
+    DatagramPeerTable peers_;
+
     /// Datagram dispatch handler.
     DatagramDispatcher dispatcher_;
 };
@@ -351,7 +351,7 @@ CanDatagramService::CanDatagramService(IfCan *iface,
     if_can()->add_owned_flow(dg_send);
     for (int i = 0; i < num_clients; ++i)
     {
-        auto *client_flow = new DatagramClientImpl(if_can(), dg_send);
+        auto *client_flow = new DatagramClientImpl(if_can(), dg_send, peers());
         if_can()->add_owned_flow(client_flow);
         client_allocator()->insert(static_cast<DatagramClient *>(client_flow));
     }
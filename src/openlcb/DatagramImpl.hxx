@@ -49,6 +49,10 @@ extern long long DATAGRAM_RESPONSE_TIMEOUT_NSEC;
 ///
 /// The base class of AddressedCanMessageWriteFlow is responsible for the
 /// discovery and address resolution of the destination node.
+///
+/// The settings in the DatagramPeerTable decide how many clients can have a
+/// datagram outstanding to the same destination, how long to wait for the
+/// response and whether to resend the datagram.
 class DatagramClientImpl : public DatagramClient,
                            public StateFlowBase,
                            public LinkedObject<DatagramClientImpl>
@@ -58,12 +62,17 @@ public:
     /// @param iface is the service on which to run this flow
     /// @param send_flow can receive an (addressed) Datagram message and send
     /// it to the appropriate destination -- takes care of fragmenting etc.
-    DatagramClientImpl(If *iface, MessageHandler *send_flow)
+    /// @param peers per-destination settings; if nullptr, the client sends
+    /// one datagram to a destination at a time and never resends.
+    DatagramClientImpl(
+        If *iface, MessageHandler *send_flow, DatagramPeerTable *peers = nullptr)
         : StateFlowBase(iface)
         , sendFlow_(send_flow)
+        , peers_(peers)
         , listener_(this)
         , isSleeping_(0)
         , sendPending_(0)
+        , inFlight_(0)
     {
     }
 
@@ -108,14 +117,17 @@ private:
     }
 
     /// Ensures that there is no other datagram client with the same src:dst
-    /// pair. This is required by the standard.
+    /// pair. This is required by the standard. (If the destination has a
+    /// larger window in the peer table, that many clients are allowed.)
     /// @return next state
     Action acquire_srcdst_lock()
     {
+        unsigned window = peers_ ? peers_->window(dst_.id) : 1;
         // First check if there is another datagram client sending a datagram
         // to the same target node.
         {
             AtomicHolder h(LinkedObject<DatagramClientImpl>::head_mu());
+            unsigned pending = 0;
             for (DatagramClientImpl *c =
                      LinkedObject<DatagramClientImpl>::head_;
                  c; c = c->LinkedObject<DatagramClientImpl>::link_next())
@@ -125,9 +137,11 @@ private:
                 if (c->src_.id != src_.id) continue; 
                 if (!iface()->matching_node(c->dst_, dst_))
                     continue;
-                // Now: there is another datagram client sending a datagram to
-                // this destination. We need to wait for that transaction to
-                // complete.
+                if (++pending < window)
+                    continue;
+                // Now: there are other datagram clients sending datagrams to
+                // this destination. We need to wait for one of those
+                // transactions to complete.
                 c->waitingClients_.push_front(this);
                 return wait();
             }
@@ -136,6 +150,110 @@ private:
         return do_send();
     }
 
+    /// @return true if c is sending a datagram from the same source to the
+    /// same destination as this client. @param c another client.
+    bool same_pair(DatagramClientImpl *c)
+    {
+        return c != this && c->src_.id == src_.id &&
+            iface()->matching_node(c->dst_, dst_);
+    }
+
+    /// Enters the queue of datagrams waiting for a response from the
+    /// destination. The responses are matched to the datagrams in the order
+    /// of sending, so this client takes the response that follows the
+    /// responses to the datagrams already outstanding to the destination.
+    void enter_response_queue()
+    {
+        AtomicHolder h(LinkedObject<DatagramClientImpl>::head_mu());
+        sendTime_ = os_get_time_monotonic();
+        ahead_ = 0;
+        seen_ = 0;
+        for (DatagramClientImpl *c = LinkedObject<DatagramClientImpl>::head_;
+             c; c = c->LinkedObject<DatagramClientImpl>::link_next())
+        {
+            if (c->inFlight_ && same_pair(c))
+            {
+                ++ahead_;
+            }
+        }
+        inFlight_ = 1;
+    }
+
+    /// Leaves the queue of datagrams waiting for a response without taking
+    /// one (e.g. after a timeout). The datagrams sent later expect one
+    /// response less.
+    void leave_response_queue()
+    {
+        AtomicHolder h(LinkedObject<DatagramClientImpl>::head_mu());
+        if (!inFlight_)
+        {
+            return;
+        }
+        inFlight_ = 0;
+        for (DatagramClientImpl *c = LinkedObject<DatagramClientImpl>::head_;
+             c; c = c->LinkedObject<DatagramClientImpl>::link_next())
+        {
+            if (c->inFlight_ && c->ahead_ && c->sendTime_ > sendTime_ &&
+                same_pair(c))
+            {
+                --c->ahead_;
+            }
+        }
+    }
+
+    /// Decides whether a response from the destination belongs to this
+    /// client, and if so, leaves the queue of datagrams waiting for a
+    /// response.
+    /// @return true if the response is for this client's datagram.
+    bool take_response()
+    {
+        {
+            AtomicHolder h(LinkedObject<DatagramClientImpl>::head_mu());
+            if (!inFlight_)
+            {
+                return false;
+            }
+            if (seen_ < ahead_)
+            {
+                // Response to an earlier datagram.
+                ++seen_;
+                return false;
+            }
+            inFlight_ = 0;
+        }
+        if (peers_ && !attempts_)
+        {
+            peers_->add_rtt_sample(
+                dst_.id, os_get_time_monotonic() - sendTime_);
+        }
+        return true;
+    }
+
+    /// Makes a copy of the datagram in resend_ if it may be resent.
+    /// @param b the datagram that is about to be sent.
+    void prepare_resend(Buffer<GenMessage> *b)
+    {
+        if (peers_ && attempts_ < peers_->max_retries())
+        {
+            resend_ = sendFlow_->alloc();
+            *resend_->data() = *b->data();
+        }
+    }
+
+    /// Sleeps until the response arrives or the timeout expires.
+    /// @return next state.
+    Action wait_for_response()
+    {
+        long long timeout = DATAGRAM_RESPONSE_TIMEOUT_NSEC;
+        if (peers_)
+        {
+            timeout = peers_->response_timeout(dst_.id);
+        }
+        isSleeping_ = 1;
+        return sleep_and_call(
+            &timer_, timeout, STATE(timeout_waiting_for_dg_response));
+    }
+
     /// Hands off the datagram to the send flow.
     /// @return next state.
     Action do_send()
@@ -147,13 +265,40 @@ private:
         done_ = b->new_child();
         b->set_done(nullptr);
 
+        attempts_ = 0;
         register_handlers();
+        enter_response_queue();
+        prepare_resend(b);
         // Transfers ownership.
         sendFlow_->send(b, priority_);
 
+        return wait_for_response();
+    }
+
+    /// Sends the copy of the datagram again, after a timeout or a temporary
+    /// rejection.
+    /// @return next state.
+    Action resend_datagram()
+    {
+        auto *b = resend_;
+        resend_ = nullptr;
+        ++attempts_;
+        result_ = OPERATION_PENDING;
+        enter_response_queue();
+        prepare_resend(b);
+        sendFlow_->send(b, priority_);
+        return wait_for_response();
+    }
+
+    /// Waits a bit before resending a datagram that was rejected
+    /// temporarily. The delay doubles with every attempt (up to 8 times).
+    /// @return next state.
+    Action resend_after_delay()
+    {
         isSleeping_ = 1;
-        return sleep_and_call(&timer_, DATAGRAM_RESPONSE_TIMEOUT_NSEC,
-            STATE(timeout_waiting_for_dg_response));
+        return sleep_and_call(&timer_,
+            RESEND_DELAY_NSEC << std::min(attempts_, (uint8_t)8),
+            STATE(resend_datagram));
     }
 
     enum
@@ -193,11 +338,24 @@ private:
 
     Action timeout_waiting_for_dg_response()
     {
+        isSleeping_ = 0;
+        if (peers_)
+        {
+            peers_->timeout_expired(dst_.id);
+        }
+        if (resend_)
+        {
+            leave_response_queue();
+            LOG(VERBOSE,
+                "CanDatagramWriteFlow: resending datagram to "
+                "destination %012" PRIx64 ".",
+                dst_.id);
+            return call_immediately(STATE(resend_datagram));
+        }
         LOG(INFO,
             "CanDatagramWriteFlow: No datagram response arrived from "
             "destination %012" PRIx64 ".",
             dst_.id);
-        isSleeping_ = 0;
         unregister_response_handler();
         result_ |= PERMANENT_ERROR | TIMEOUT;
         return call_immediately(STATE(datagram_finalize));
@@ -208,6 +366,7 @@ private:
         iface()->dispatcher()->unregister_handler(&listener_, MTI_1, MASK_1);
         iface()->dispatcher()->unregister_handler(&listener_, MTI_2, MASK_2);
         iface()->dispatcher()->unregister_handler(&listener_, MTI_3, MASK_3);
+        leave_response_queue();
         sendPending_ = 0;
         if (!waitingClients_.empty())
         {
@@ -225,6 +384,11 @@ private:
         HASSERT(!sendPending_);
         HASSERT(result_ & OPERATION_PENDING);
         result_ &= ~OPERATION_PENDING;
+        if (resend_)
+        {
+            resend_->unref();
+            resend_ = nullptr;
+        }
         if (done_)
         {
             done_->notify();
@@ -328,6 +492,10 @@ private:
             } // fall through
             case Defs::MTI_DATAGRAM_REJECTED:
             {
+                if (!take_response())
+                {
+                    return;
+                }
                 result_ &= ~0xffff;
                 result_ |= error_code;
                 // Ensures that an error response is visible in the flags.
@@ -335,10 +503,22 @@ private:
                 {
                     result_ |= PERMANENT_ERROR;
                 }
+                if ((result_ & RESEND_OK) && resend_ && isSleeping_)
+                {
+                    // Temporary error (e.g. the destination is out of
+                    // buffers). Tries again later.
+                    timer_.trigger();
+                    reset_flow(STATE(resend_after_delay));
+                    return;
+                }
                 break;
             }
             case Defs::MTI_DATAGRAM_OK:
             {
+                if (!take_response())
+                {
+                    return;
+                }
                 if (payload_length)
                 {
                     result_ &= ~(0xff << RESPONSE_FLAGS_SHIFT);
@@ -368,8 +548,6 @@ private:
             timer_.trigger();
             isSleeping_ = 0;
         }
-        /// @TODO(balazs.racz) Here we might want to decide whether to start a
-        /// retry.
         LOG(VERBOSE, "restarting at datagram finalize");
         reset_flow(STATE(datagram_finalize));
     }
@@ -406,6 +584,19 @@ private:
     NodeHandle dst_;
     /// Addressed datagram send flow from the interface. Externally owned.
     MessageHandler *sendFlow_;
+    /// Per-destination settings. Externally owned, may be nullptr.
+    DatagramPeerTable *peers_;
+    /// Copy of the datagram for resending it, or nullptr.
+    Buffer<GenMessage> *resend_ {nullptr};
+    /// When the datagram was last sent (os_get_time_monotonic).
+    long long sendTime_ {0};
+    /// How many times the datagram was resent.
+    uint8_t attempts_ {0};
+    /// How many datagrams to the same destination were waiting for a
+    /// response when this datagram was sent.
+    uint8_t ahead_ {0};
+    /// How many responses to those earlier datagrams arrived since.
+    uint8_t seen_ {0};
     /// Instance of the listener object.
     ReplyListener listener_;
     /// Helper object for sleep.
@@ -421,11 +612,17 @@ private:
     /// 1 when we have the handlers registered. During this time we have
     /// exclusive lock on the specific src/dst node pair.
     unsigned sendPending_ : 1;
+    /// 1 while the datagram is sent and waiting for a response, see
+    /// enter_response_queue().
+    unsigned inFlight_ : 1;
     /// Priority in the executor.
     unsigned priority_ : 24;
     /// Constant used to clamp the incoming priority value to something that
     /// first in priority_ bit field.
     static constexpr unsigned MAX_PRIORITY = (1 << 24) - 1;
+    /// How long to wait before the first resend of a temporarily rejected
+    /// datagram.
+    static constexpr long long RESEND_DELAY_NSEC = MSEC_TO_NSEC(20);
 }; // class DatagramClientImpl
 
 } // namespace openlcb
@@ -46,7 +46,7 @@ TcpDatagramService::TcpDatagramService(
     auto *dg_send = if_tcp()->addressed_message_write_flow();
     for (int i = 0; i < num_clients; ++i)
     {
-        auto *client_flow = new DatagramClientImpl(if_tcp(), dg_send);
+        auto *client_flow = new DatagramClientImpl(if_tcp(), dg_send, peers());
         if_tcp()->add_owned_flow(client_flow);
         client_allocator()->insert(static_cast<DatagramClient *>(client_flow));
     }
@@ -0,0 +1,269 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file EventFilter.hxx
+ *
+ * Counting Bloom filter over the registered event handlers.
+ *
+ * @author Balazs Racz
+ * @date 16 October 2026
+ */
+
+#ifndef _OPENLCB_EVENTFILTER_HXX_
+#define _OPENLCB_EVENTFILTER_HXX_
+
+#include <stdint.h>
+#include <string.h>
+#include <vector>
+
+#include "openlcb/EventHandler.hxx"
+
+namespace openlcb
+{
+
+/// Counting Bloom filter that answers whether an incoming event ID may have
+/// any registered handler. Used by the event registries to let the
+/// EventService drop event reports that no local handler is interested in
+/// before starting an iteration.
+///
+/// Single events are added by their event ID. Ranges are added by their base
+/// event ID and the width of the range; a lookup then checks the base of the
+/// range that the event would fall into for every range width that has at
+/// least one registration. A registration for all events (width 64) makes
+/// every lookup match.
+///
+/// Counters are 4 bits and saturate: a counter that reached the maximum value
+/// is never decremented, which can only cause false positives. The filter
+/// keeps at least COUNTERS_PER_ENTRY counters per registration; when it gets
+/// fuller, needs_grow() returns true, and the owner has to call resize() and
+/// add all registrations again.
+class EventFilter
+{
+public:
+    /// Number of hash functions.
+    static constexpr unsigned NUM_HASH = 3;
+    /// Minimum number of counters per registration. With 3 hash functions
+    /// this gives about 3% false positive rate.
+    static constexpr unsigned COUNTERS_PER_ENTRY = 8;
+    /// Initial number of counters.
+    static constexpr unsigned MIN_SIZE = 256;
+
+    EventFilter()
+    {
+        resize(0);
+    }
+
+    /// Removes all entries and sets the size of the filter.
+    /// @param num_entries is the number of registrations to prepare for.
+    void resize(size_t num_entries)
+    {
+        size_t size = MIN_SIZE;
+        while (size < num_entries * COUNTERS_PER_ENTRY * 2)
+        {
+            size <<= 1;
+        }
+        counters_.assign(size / 2, 0);
+        sizeMask_ = size - 1;
+        numEntries_ = 0;
+        memset(widthCount_, 0, sizeof(widthCount_));
+        widths_ = 0;
+    }
+
+    /// @return true if the filter is too full for a good false positive rate.
+    bool needs_grow()
+    {
+        return numEntries_ * COUNTERS_PER_ENTRY > sizeMask_ + 1;
+    }
+
+    /// @return the number of registrations in the filter.
+    size_t size()
+    {
+        return numEntries_;
+    }
+
+    /// Adds a registration to the filter.
+    /// @param event is the event ID (or base of the range).
+    /// @param mask is the registration mask (width of the range in bits), as
+    /// passed to EventRegistry::register_handler.
+    void add(EventId event, unsigned mask)
+    {
+        ++numEntries_;
+        if (mask)
+        {
+            if (!widthCount_[mask - 1]++)
+            {
+                widths_ |= 1ULL << (mask - 1);
+            }
+            if (mask >= 64)
+            {
+                return;
+            }
+        }
+        uint64_t h = hash(range_base(event, mask), mask);
+        for (unsigned i = 0; i < NUM_HASH; ++i)
+        {
+            unsigned idx = index(h, i);
+            unsigned c = get(idx);
+            if (c != MAX_COUNT)
+            {
+                set(idx, c + 1);
+            }
+        }
+    }
+
+    /// Removes a registration that was previously added with the same
+    /// arguments.
+    /// @param event is the event ID (or base of the range).
+    /// @param mask is the registration mask.
+    void remove(EventId event, unsigned mask)
+    {
+        HASSERT(numEntries_);
+        --numEntries_;
+        if (mask)
+        {
+            HASSERT(widthCount_[mask - 1]);
+            if (!--widthCount_[mask - 1])
+            {
+                widths_ &= ~(1ULL << (mask - 1));
+            }
+            if (mask >= 64)
+            {
+                return;
+            }
+        }
+        uint64_t h = hash(range_base(event, mask), mask);
+        for (unsigned i = 0; i < NUM_HASH; ++i)
+        {
+            unsigned idx = index(h, i);
+            unsigned c = get(idx);
+            if (c != MAX_COUNT)
+            {
+                HASSERT(c);
+                set(idx, c - 1);
+            }
+        }
+    }
+
+    /// @return false if no registration can match the given event, true if
+    /// there may be one.
+    /// @param event is the event ID from an incoming event report.
+    bool may_match(EventId event)
+    {
+        if (contains(hash(event, 0)))
+        {
+            return true;
+        }
+        uint64_t widths = widths_;
+        while (widths)
+        {
+            unsigned mask = __builtin_ctzll(widths) + 1;
+            widths &= widths - 1;
+            if (mask >= 64)
+            {
+                return true;
+            }
+            if (contains(hash(range_base(event, mask), mask)))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    /// Saturation value of the counters.
+    static constexpr unsigned MAX_COUNT = 15;
+
+    /// @return the base of the range of a given width that contains an
+    /// event. Registrations may pass any event of the range.
+    /// @param event is the event ID.
+    /// @param mask is the range width in bits, less than 64.
+    static EventId range_base(EventId event, unsigned mask)
+    {
+        return event & ~((1ULL << mask) - 1);
+    }
+
+    /// @return the hash value of a registration.
+    /// @param event is the event ID (or base of the range).
+    /// @param mask is the registration mask.
+    static uint64_t hash(EventId event, unsigned mask)
+    {
+        uint64_t h = (event ^ (uint64_t(mask) << 58)) * 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 29);
+    }
+
+    /// @return the counter index for the i-th hash function.
+    /// @param h is the hash value.
+    /// @param i is the index of the hash function.
+    unsigned index(uint64_t h, unsigned i)
+    {
+        return (h >> (21 * i)) & sizeMask_;
+    }
+
+    /// @return the value of a counter. @param idx is the counter index.
+    unsigned get(unsigned idx)
+    {
+        return (counters_[idx >> 1] >> ((idx & 1) * 4)) & 0xf;
+    }
+
+    /// Sets the value of a counter. @param idx is the counter index. @param
+    /// value is the new value (0..MAX_COUNT).
+    void set(unsigned idx, unsigned value)
+    {
+        unsigned shift = (idx & 1) * 4;
+        uint8_t &b = counters_[idx >> 1];
+        b = (b & ~(0xf << shift)) | (value << shift);
+    }
+
+    /// @return true if all counters of a hash value are nonzero.
+    /// @param h is the hash value.
+    bool contains(uint64_t h)
+    {
+        for (unsigned i = 0; i < NUM_HASH; ++i)
+        {
+            if (!get(index(h, i)))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// The counters of the Bloom filter, two per byte.
+    std::vector<uint8_t> counters_;
+    /// Number of counters - 1.
+    unsigned sizeMask_;
+    /// Number of registrations added.
+    size_t numEntries_;
+    /// How many ranges are registered with each width (mask - 1).
+    uint16_t widthCount_[64];
+    /// Bit (mask - 1) is set if there is at least one range with that width.
+    uint64_t widths_;
+};
+
+} // namespace openlcb
+
+#endif // _OPENLCB_EVENTFILTER_HXX_
@@ -287,6 +287,16 @@ public:
     /// Creates a new event iterator. Caller takes ownership of object.
     virtual EventIterator *create_iterator() = 0;
 
+    /// Quick check whether an incoming event report may have any handler.
+    /// @param event is the event ID of the incoming event report.
+    /// @return false if there is certainly no registered handler for this
+    /// event; true if there may be one. Implementations without a filter
+    /// always return true.
+    virtual bool may_match(EventId event)
+    {
+        return true;
+    }
+
     /// Returns a monotonically increasing number that will change every time
     /// the set of registered event handlers change. Whenever this number
     /// changes, the iterators are invalidated and must be cleared.
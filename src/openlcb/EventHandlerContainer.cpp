@@ -46,6 +46,13 @@ void TreeEventHandlers::register_handler(const EventRegistryEntry &entry,
     LOG(VERBOSE, "%p: register %p", this, entry.handler);
     set_dirty();
     handlers_[mask].insert(EventRegistryEntry(entry));
+#if OPENMRN_FEATURE_EVENT_FILTER
+    filter_.add(entry.event, mask);
+    if (filter_.needs_grow())
+    {
+        rebuild_filter(filter_.size() * 2);
+    }
+#endif
 }
 
 void TreeEventHandlers::unregister_handler(
@@ -54,16 +61,25 @@ void TreeEventHandlers::unregister_handler(
     AtomicHolder h(this);
     set_dirty();
     LOG(VERBOSE, "%p: unregister %p", this, handler);
+    auto matches = [handler, user_arg, user_arg_mask](
+                       const EventRegistryEntry &e) {
+        return e.handler == handler &&
+            ((e.user_arg & user_arg_mask) == (user_arg & user_arg_mask));
+    };
     for (auto r = handlers_.begin(); r != handlers_.end(); ++r)
     {
         auto begin_it = r->second.begin();
         auto end_it = r->second.end();
-        auto erase_it = std::remove_if(begin_it, end_it,
-            [handler, user_arg, user_arg_mask](const EventRegistryEntry &e) {
-                return e.handler == handler &&
-                    ((e.user_arg & user_arg_mask) ==
-                        (user_arg & user_arg_mask));
-            });
+#if OPENMRN_FEATURE_EVENT_FILTER
+        for (auto it = begin_it; it != end_it; ++it)
+        {
+            if (matches(*it))
+            {
+                filter_.remove(it->event, r->first);
+            }
+        }
+#endif
+        auto erase_it = std::remove_if(begin_it, end_it, matches);
         if (erase_it != end_it)
         {
             r->second.erase(erase_it, end_it);
@@ -71,10 +87,33 @@ void TreeEventHandlers::unregister_handler(
     }
 }
 
+#if OPENMRN_FEATURE_EVENT_FILTER
+bool TreeEventHandlers::may_match(EventId event)
+{
+    AtomicHolder h(this);
+    return filter_.may_match(event);
+}
+
+void TreeEventHandlers::rebuild_filter(size_t count)
+{
+    filter_.resize(count);
+    for (auto r = handlers_.begin(); r != handlers_.end(); ++r)
+    {
+        for (auto it = r->second.begin(); it != r->second.end(); ++it)
+        {
+            filter_.add(it->event, r->first);
+        }
+    }
+}
+#endif
+
 void TreeEventHandlers::reserve(size_t count)
 {
     AtomicHolder h(this);
     handlers_[0].reserve(handlers_[0].size() + count);
+#if OPENMRN_FEATURE_EVENT_FILTER
+    rebuild_filter(filter_.size() + count);
+#endif
 }
 
 /// Class representing the iteration state on the binary tree-based event
@@ -160,4 +199,298 @@ TreeEventHandlers::TreeEventHandlers()
 {
 }
 
+constexpr uint16_t FlatEventHandlers::EMPTY;
+
+FlatEventHandlers::FlatEventHandlers()
+{
+    rehash(0);
+}
+
+void FlatEventHandlers::register_handler(
+    const EventRegistryEntry &entry, unsigned mask)
+{
+    AtomicHolder h(this);
+    LOG(VERBOSE, "%p: register %p", this, entry.handler);
+    set_dirty();
+    if (mask)
+    {
+        ranges_[mask].insert(EventRegistryEntry(entry));
+    }
+    else
+    {
+        HASSERT(exact_.size() < EMPTY);
+        exact_.push_back(entry);
+        if (exact_.size() * 2 > table_.size())
+        {
+            rehash(exact_.size() * 2);
+        }
+        else
+        {
+            table_insert(exact_.size() - 1);
+        }
+    }
+#if OPENMRN_FEATURE_EVENT_FILTER
+    filter_.add(entry.event, mask);
+    if (filter_.needs_grow())
+    {
+        rebuild_filter(filter_.size() * 2);
+    }
+#endif
+}
+
+void FlatEventHandlers::unregister_handler(
+    EventHandler *handler, uint32_t user_arg, uint32_t user_arg_mask)
+{
+    AtomicHolder h(this);
+    set_dirty();
+    LOG(VERBOSE, "%p: unregister %p", this, handler);
+    auto matches = [handler, user_arg, user_arg_mask](
+                       const EventRegistryEntry &e) {
+        return e.handler == handler &&
+            ((e.user_arg & user_arg_mask) == (user_arg & user_arg_mask));
+    };
+#if OPENMRN_FEATURE_EVENT_FILTER
+    for (const auto &e : exact_)
+    {
+        if (matches(e))
+        {
+            filter_.remove(e.event, 0);
+        }
+    }
+    for (auto r = ranges_.begin(); r != ranges_.end(); ++r)
+    {
+        for (auto it = r->second.begin(); it != r->second.end(); ++it)
+        {
+            if (matches(*it))
+            {
+                filter_.remove(it->event, r->first);
+            }
+        }
+    }
+#endif
+    auto erase_it = std::remove_if(exact_.begin(), exact_.end(), matches);
+    if (erase_it != exact_.end())
+    {
+        exact_.erase(erase_it, exact_.end());
+        rehash(exact_.size());
+    }
+    for (auto r = ranges_.begin(); r != ranges_.end(); ++r)
+    {
+        auto begin_it = r->second.begin();
+        auto end_it = r->second.end();
+        auto range_erase_it = std::remove_if(begin_it, end_it, matches);
+        if (range_erase_it != end_it)
+        {
+            r->second.erase(range_erase_it, end_it);
+        }
+    }
+}
+
+#if OPENMRN_FEATURE_EVENT_FILTER
+bool FlatEventHandlers::may_match(EventId event)
+{
+    AtomicHolder h(this);
+    return filter_.may_match(event);
+}
+
+void FlatEventHandlers::rebuild_filter(size_t count)
+{
+    filter_.resize(count);
+    for (const auto &e : exact_)
+    {
+        filter_.add(e.event, 0);
+    }
+    for (auto r = ranges_.begin(); r != ranges_.end(); ++r)
+    {
+        for (auto it = r->second.begin(); it != r->second.end(); ++it)
+        {
+            filter_.add(it->event, r->first);
+        }
+    }
+}
+#endif
+
+void FlatEventHandlers::reserve(size_t count)
+{
+    AtomicHolder h(this);
+    count += exact_.size();
+    exact_.reserve(count);
+    if (count * 2 > table_.size())
+    {
+        rehash(count);
+    }
+#if OPENMRN_FEATURE_EVENT_FILTER
+    rebuild_filter(count);
+#endif
+}
+
+void FlatEventHandlers::table_insert(unsigned index)
+{
+    unsigned table_mask = table_.size() - 1;
+    unsigned slot = hash_slot(exact_[index].event);
+    while (table_[slot] != EMPTY)
+    {
+        slot = (slot + 1) & table_mask;
+    }
+    table_[slot] = index;
+}
+
+void FlatEventHandlers::rehash(size_t count)
+{
+    tableBits_ = 4;
+    while ((1u << tableBits_) < count * 2)
+    {
+        ++tableBits_;
+    }
+    table_.assign(1u << tableBits_, EMPTY);
+    for (unsigned i = 0; i < exact_.size(); ++i)
+    {
+        table_insert(i);
+    }
+}
+
+/// Class representing the iteration state on the hash-based event handler
+/// registry.
+class FlatEventHandlers::Iterator : public EventIterator
+{
+public:
+    Iterator(FlatEventHandlers *parent)
+        : parent_(parent)
+    {
+        clear_iteration();
+    }
+
+    EventRegistryEntry *next_entry() OVERRIDE
+    {
+        AtomicHolder h(parent_);
+        if (state_ == HASH)
+        {
+            unsigned table_mask = parent_->table_.size() - 1;
+            uint16_t idx;
+            while ((idx = parent_->table_[pos_]) != EMPTY)
+            {
+                pos_ = (pos_ + 1) & table_mask;
+                EventRegistryEntry *e = &parent_->exact_[idx];
+                if (e->event == currentReport_->event)
+                {
+                    return e;
+                }
+            }
+            start_ranges();
+        }
+        else if (state_ == SCAN)
+        {
+            uint64_t last = currentReport_->event + currentReport_->mask;
+            while (pos_ < parent_->exact_.size())
+            {
+                EventRegistryEntry *e = &parent_->exact_[pos_++];
+                if (e->event >= currentReport_->event && e->event <= last)
+                {
+                    return e;
+                }
+            }
+            start_ranges();
+        }
+        if (state_ != RANGES)
+        {
+            return nullptr;
+        }
+        while (maskIterator_ != parent_->ranges_.end())
+        {
+            if (it_ == end_)
+            {
+                maskIterator_++;
+                if (maskIterator_ != parent_->ranges_.end())
+                {
+                    setup_current_mask();
+                }
+                continue;
+            }
+            EventRegistryEntry *e = &*it_;
+            it_++;
+            return e;
+        }
+        state_ = DONE;
+        return nullptr;
+    }
+
+    void clear_iteration() OVERRIDE
+    {
+        state_ = DONE;
+    }
+
+    void init_iteration(EventReport *r) OVERRIDE
+    {
+        AtomicHolder h(parent_);
+        currentReport_ = r;
+        if (r->mask == 0)
+        {
+            state_ = HASH;
+            pos_ = parent_->hash_slot(r->event);
+        }
+        else
+        {
+            state_ = SCAN;
+            pos_ = 0;
+        }
+    }
+
+private:
+    /// Where the iteration is.
+    enum State : uint8_t
+    {
+        /// Probing the hash table for a single event.
+        HASH,
+        /// Scanning all single events for a range report.
+        SCAN,
+        /// Iterating through the range registrations.
+        RANGES,
+        /// Iteration is over.
+        DONE
+    };
+
+    /// Switches the iteration to the range registrations.
+    void start_ranges()
+    {
+        state_ = RANGES;
+        maskIterator_ = parent_->ranges_.begin();
+        if (maskIterator_ != parent_->ranges_.end())
+        {
+            setup_current_mask();
+        }
+    }
+
+    /// Sets it_ and end_ to the matching entries of the current range width.
+    void setup_current_mask()
+    {
+        if (maskIterator_->first == 64)
+        {
+            // 64 bits -> all events go to everyone.
+            it_ = maskIterator_->second.begin();
+            end_ = maskIterator_->second.end();
+            return;
+        }
+        unsigned mask_log = maskIterator_->first;
+        uint64_t current_mask = (1ULL << mask_log) - 1;
+        uint64_t eventid_key = currentReport_->event & (~current_mask);
+        it_ = maskIterator_->second.lower_bound(eventid_key);
+        eventid_key = currentReport_->event + currentReport_->mask;
+        end_ = maskIterator_->second.upper_bound(eventid_key);
+    }
+
+    FlatEventHandlers *parent_;
+    EventReport *currentReport_;
+    /// Offset in the hash table (HASH) or in exact_ (SCAN).
+    size_t pos_;
+    State state_;
+    MaskLookupMap::iterator maskIterator_;
+    OneMaskMap::iterator it_;
+    OneMaskMap::iterator end_;
+};
+
+EventIterator *FlatEventHandlers::create_iterator()
+{
+    return new Iterator(this);
+}
+
 } // namespace openlcb
@@ -47,11 +47,15 @@
 //#define LOGLEVEL VERBOSE
 #endif
 
+#include "openmrn_features.h"
 #include "utils/Atomic.hxx"
 #include "utils/logging.h"
 #include "utils/SortedListMap.hxx"
 #include "openlcb/EventHandler.hxx"
 #include "openlcb/EventHandlerTemplates.hxx"
+#if OPENMRN_FEATURE_EVENT_FILTER
+#include "openlcb/EventFilter.hxx"
+#endif
 
 namespace openlcb
 {
@@ -144,6 +148,24 @@ public:
   HandlersList handlers_;
 };
 
+/// Comparison operator for event registry entries; orders them by the event
+/// ID.
+struct EventRegistryEntryCmp
+{
+    bool operator()(const EventRegistryEntry &d, uint64_t k)
+    {
+        return d.event < k;
+    }
+    bool operator()(uint64_t k, const EventRegistryEntry &d)
+    {
+        return k < d.event;
+    }
+    bool operator()(const EventRegistryEntry &a, const EventRegistryEntry &b)
+    {
+        return a.event < b.event;
+    }
+};
+
 /// EventRegistry implementation that keeps event handlers in a SortedListMap
 /// and filters the event handler calls based on the registered event handler
 /// arguments (id/mask).
@@ -157,34 +179,98 @@ public:
     void unregister_handler(EventHandler *handler, uint32_t user_arg = 0,
         uint32_t user_arg_mask = 0) OVERRIDE;
     void reserve(size_t count) OVERRIDE;
+#if OPENMRN_FEATURE_EVENT_FILTER
+    bool may_match(EventId event) OVERRIDE;
+#endif
 
 private:
     class Iterator;
     friend class Iterator;
 
-    /// Comparison operator for event registry entries.
-    struct cmpop
-    {
-        bool operator()(const EventRegistryEntry &d, uint64_t k)
-        {
-            return d.event < k;
-        }
-        bool operator()(uint64_t k, const EventRegistryEntry &d)
-        {
-            return k < d.event;
-        }
-        bool operator()(const EventRegistryEntry &a, const EventRegistryEntry &b)
-        {
-            return a.event < b.event;
-        }
-    };
-
-    typedef SortedListSet<EventRegistryEntry, cmpop> OneMaskMap;
+    typedef SortedListSet<EventRegistryEntry, EventRegistryEntryCmp> OneMaskMap;
     typedef std::map<uint8_t, OneMaskMap> MaskLookupMap;
     /** The registered handlers. The offset in the first map tell us how many
      * bits wide the registration is (it is the mask value in the register
      * call).*/
     MaskLookupMap handlers_;
+#if OPENMRN_FEATURE_EVENT_FILTER
+    /// Resizes the filter and adds all registrations again. Must be called
+    /// with the lock held. @param count is the number of registrations to
+    /// prepare for.
+    void rebuild_filter(size_t count);
+
+    /// Bloom filter over all registrations.
+    EventFilter filter_;
+#endif
+};
+
+/// EventRegistry implementation optimized for nodes with many single-event
+/// registrations. Single events (mask == 0) are stored in a flat vector with
+/// an open-addressing hash index on the event ID, so an event report or
+/// identify message for a single event is a hash lookup. Range registrations
+/// are kept in sorted lists per range width, like in TreeEventHandlers.
+///
+/// Messages that cover a range of events (range identified, global identify)
+/// scan all single events.
+class FlatEventHandlers : public EventRegistry, private Atomic
+{
+public:
+    FlatEventHandlers();
+
+    EventIterator *create_iterator() OVERRIDE;
+    void register_handler(
+        const EventRegistryEntry &entry, unsigned mask) OVERRIDE;
+    void unregister_handler(EventHandler *handler, uint32_t user_arg = 0,
+        uint32_t user_arg_mask = 0) OVERRIDE;
+    void reserve(size_t count) OVERRIDE;
+#if OPENMRN_FEATURE_EVENT_FILTER
+    bool may_match(EventId event) OVERRIDE;
+#endif
+
+private:
+    class Iterator;
+    friend class Iterator;
+
+    /// Marks an empty slot in the hash table.
+    static constexpr uint16_t EMPTY = 0xFFFF;
+
+    /// @return the first hash table slot to probe for an event. @param event
+    /// is the event ID to look up.
+    unsigned hash_slot(EventId event)
+    {
+        return (event * 0x9E3779B97F4A7C15ULL) >> (64 - tableBits_);
+    }
+
+    /// Adds exact_[index] to the hash table. Requires a free slot in the
+    /// table. @param index is the offset in exact_.
+    void table_insert(unsigned index);
+
+    /// Resizes the hash table to fit a given number of single events and
+    /// re-inserts all entries. @param count how many entries to prepare for.
+    void rehash(size_t count);
+
+    typedef SortedListSet<EventRegistryEntry, EventRegistryEntryCmp> OneMaskMap;
+    typedef std::map<uint8_t, OneMaskMap> MaskLookupMap;
+
+    /// Registrations for single events.
+    std::vector<EventRegistryEntry> exact_;
+    /// Open addressing hash table (linear probing) of offsets into exact_,
+    /// or EMPTY. The size is 1 << tableBits_; at most half full.
+    std::vector<uint16_t> table_;
+    /// log2 of the hash table size.
+    unsigned tableBits_;
+    /// Range registrations, keyed by the mask value (width of the range in
+    /// bits).
+    MaskLookupMap ranges_;
+#if OPENMRN_FEATURE_EVENT_FILTER
+    /// Resizes the filter and adds all registrations again. Must be called
+    /// with the lock held. @param count is the number of registrations to
+    /// prepare for.
+    void rebuild_filter(size_t count);
+
+    /// Bloom filter over all registrations.
+    EventFilter filter_;
+#endif
 };
 
 }; /* namespace openlcb */
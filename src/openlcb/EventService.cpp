@@ -13,6 +13,7 @@
 #include "openlcb/EventHandlerContainer.hxx"
 #include "openlcb/Defs.hxx"
 #include "openlcb/EndianHelper.hxx"
+#include "openmrn_features.h"
 
 namespace openlcb
 {
@@ -58,6 +59,8 @@ EventService::Impl::Impl(EventService *service) : callerFlow_(service)
 {
 #ifdef TARGET_LPC11Cxx
     registry.reset(new VectorEventHandlers());
+#elif OPENMRN_FEATURE_EVENT_FLAT_REGISTRY
+    registry.reset(new FlatEventHandlers());
 #else
     registry.reset(new TreeEventHandlers());
 #endif
@@ -114,6 +117,24 @@ bool EventService::event_processing_pending()
     return false;
 }
 
+#if OPENMRN_FEATURE_EVENT_FILTER
+void EventService::get_filter_stats(FilterStats *stats)
+{
+    *stats = impl()->filterStats_;
+}
+
+float EventService::filter_false_positive_rate()
+{
+    const FilterStats &s = impl()->filterStats_;
+    unsigned unhandled = s.filtered + s.falsePositive;
+    if (!unhandled)
+    {
+        return 0;
+    }
+    return float(s.falsePositive) / unhandled;
+}
+#endif
+
 void DecodeRange(EventReport *r)
 {
     uint64_t e = r->event;
@@ -160,6 +181,16 @@ StateFlowBase::Action EventIteratorFlow::entry()
     switch (nmsg()->mti)
     {
         case Defs::MTI_EVENT_REPORT:
+#if OPENMRN_FEATURE_EVENT_FILTER
+            // Drops reports that no local handler is interested in before
+            // starting an iteration.
+            if (!eventService_->impl()->registry->may_match(rep->event))
+            {
+                ++eventService_->impl()->filterStats_.filtered;
+                return release_and_exit();
+            }
+            ++eventService_->impl()->filterStats_.passed;
+#endif
             fn_ = &EventHandler::handle_event_report;
             break;
         case Defs::MTI_CONSUMER_IDENTIFY:
@@ -231,6 +262,9 @@ StateFlowBase::Action EventIteratorFlow::entry()
     release();
 
     eventRegistryEpoch_ = eventService_->impl()->registry->get_epoch();
+#if OPENMRN_FEATURE_EVENT_FILTER
+    anyHandler_ = false;
+#endif
     iterator_->init_iteration(rep);
     return yield_and_call(STATE(iterate_next));
 }
@@ -249,6 +283,12 @@ StateFlowBase::Action EventIteratorFlow::iterate_next()
     EventRegistryEntry *entry = iterator_->next_entry();
     if (!entry)
     {
+#if OPENMRN_FEATURE_EVENT_FILTER
+        if (!anyHandler_ && fn_ == &EventHandler::handle_event_report)
+        {
+            ++eventService_->impl()->filterStats_.falsePositive;
+        }
+#endif
         if (incomingDone_)
         {
             incomingDone_->notify();
@@ -272,6 +312,9 @@ StateFlowBase::Action EventIteratorFlow::iterate_next()
 
         return exit();
     }
+#if OPENMRN_FEATURE_EVENT_FILTER
+    anyHandler_ = true;
+#endif
     return dispatch_event(entry);
 }
 
@@ -50,6 +50,7 @@
 
 #include "utils/macros.h"
 #include "executor/Service.hxx"
+#include "openmrn_features.h"
 #include "openlcb/Defs.hxx"
 #include "openlcb/If.hxx"
 
@@ -88,6 +89,26 @@ public:
      * handled. */
     bool event_processing_pending();
 
+#if OPENMRN_FEATURE_EVENT_FILTER
+    /// Counters of the event report prefilter.
+    struct FilterStats
+    {
+        /// Event reports dropped by the filter.
+        unsigned filtered;
+        /// Event reports that passed the filter.
+        unsigned passed;
+        /// Event reports that passed the filter but had no handler.
+        unsigned falsePositive;
+    };
+
+    /// @param stats will be filled with the current filter counters.
+    void get_filter_stats(FilterStats *stats);
+
+    /// @return the fraction of the event reports without a local handler
+    /// that the filter did not drop (0 if there were no such reports).
+    float filter_false_positive_rate();
+#endif
+
     static EventService *instance;
 
 private:
@@ -107,6 +107,11 @@ public:
     /// calls need to be sent to this flow.
     EventCallerFlow callerFlow_;
 
+#if OPENMRN_FEATURE_EVENT_FILTER
+    /// Counters of the event report prefilter.
+    EventService::FilterStats filterStats_ {0, 0, 0};
+#endif
+
     enum
     {
         // These address/mask should match all the messages carrying an event
@@ -158,6 +163,11 @@ protected:
     BarrierNotifiable n_;
     EventHandlerFunction fn_;
 
+#if OPENMRN_FEATURE_EVENT_FILTER
+    /// true if the current iteration found at least one handler.
+    bool anyHandler_ {false};
+#endif
+
 #ifdef DEBUG_EVENT_PERFORMANCE
     static const int REPORT_COUNT = 100;
     /// How many events' cost are accumulated so far.
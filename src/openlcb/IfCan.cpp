@@ -676,7 +676,8 @@ IfCan::IfCan(ExecutorBase *executor, CanHubFlow *device,
     : If(executor, local_nodes_count)
     , CanIf(this, device)
     , localAliases_(0, local_alias_cache_size)
-    , remoteAliases_(0, remote_alias_cache_size)
+    , remoteAliases_(0, remote_alias_cache_size, nullptr, nullptr,
+          config_remote_alias_cache_hashed() == CONSTANT_TRUE)
 {
     auto *gflow = new GlobalCanMessageWriteFlow(this);
     globalWriteFlow_ = gflow;
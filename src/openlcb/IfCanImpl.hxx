@@ -64,6 +64,7 @@ protected:
     NodeAlias dstAlias_;  ///< Destination node alias.
     uint8_t dataOffset_; /**< for continuation frames: which offset in
                           * the Buffer should we start the payload at. */
+    long long aliasWaitStart_; ///< When we started to look for a new alias.
 
     Action send_to_hardware() override
     {
@@ -88,6 +89,7 @@ protected:
         srcAlias_ = if_can()->local_aliases()->lookup(nmsg()->src.id);
         if (!srcAlias_)
         {
+            aliasWaitStart_ = os_get_time_monotonic();
             return call_immediately(STATE(allocate_new_alias));
         }
         return src_alias_lookup_done();
@@ -113,6 +115,8 @@ private:
         }
         LOG(INFO, "Allocating new alias %03X for node %012" PRIx64, alias,
             nmsg()->src.id);
+        if_can()->alias_allocator()->record_alias_latency(
+            os_get_time_monotonic() - aliasWaitStart_);
 
         srcAlias_ = alias;
         // Take a CAN frame to send off the AMD frame.
@@ -36,9 +36,11 @@
 #ifndef _OPENLCB_ROUTNGLOGIC_HXX_
 #define _OPENLCB_ROUTNGLOGIC_HXX_
 
+#include <atomic>
 #include <set>
 #include <map>
 #include <unordered_map>
+#include <vector>
 
 #include "os/OS.hxx"
 #include "openlcb/EventHandler.hxx"
@@ -61,15 +63,103 @@ uint8_t event_range_to_bit_count(EventId *event);
  *
  * The routing table contains which direction to send addressed packets as well
  * as filters for the event IDs that have listeners in a given port.
+ *
+ * The event filters of the first MAX_INDEXED_PORTS ports are kept in an event
+ * index that maps each event (or event range) to a bitmask of the ports that
+ * are interested in it. lookup_event_ports() returns the set of ports for an
+ * event with one hash lookup per registered range width, without taking the
+ * lock: registrations update a private copy of the index, and readers see
+ * immutable snapshots that are published (RCU-style) on the first lookup after
+ * a change. Ports beyond the first MAX_INDEXED_PORTS fall back to per-port
+ * event sets.
+ *
+ * The address table is an open-addressing hash table. Lookups and refreshes
+ * of known addresses do not take the lock. Entries of removed ports are
+ * nulled out and dropped when the table is compacted, which happens when the
+ * table fills up or the removed entries outnumber the live ones. Old tables
+ * and old event index snapshots are freed once no lock-free reader is in
+ * flight.
  */
 template <class Port, typename Address> class RoutingLogic
 {
 public:
+    /// Bitmask of ports, bit i referring to the port with port_bit() == i.
+    typedef uint64_t PortMask;
+
+    /// How many ports can be in the event index.
+    static constexpr unsigned MAX_INDEXED_PORTS = 64;
+
+    /// Statistics of the address table.
+    struct AddressStats
+    {
+        /// Number of addresses with a live port.
+        unsigned size;
+        /// Number of slots in the table.
+        unsigned capacity;
+        /// Number of addresses whose port was removed.
+        unsigned stale;
+        /// Number of compactions done so far.
+        unsigned compactions;
+        /// Number of lookup_port_for_address() calls.
+        unsigned lookups;
+        /// Number of lookups that returned a port.
+        unsigned hits;
+    };
+
     RoutingLogic()
+        : published_(new EventIndex)
+        , addressTable_(new AddressTable(MIN_ADDRESS_CAPACITY))
+        , readers_(0)
+        , dirty_(false)
+        , lookups_(0)
+        , hits_(0)
     {
     }
     ~RoutingLogic()
     {
+        delete published_.load();
+        delete addressTable_.load();
+        for (EventIndex *e : retired_)
+        {
+            delete e;
+        }
+        for (AddressTable *t : retiredTables_)
+        {
+            delete t;
+        }
+    }
+
+    /** Assigns a bit in the event index to a port. Calling this is optional;
+     * ports are added automatically when the first event is registered for
+     * them.
+     *
+     * @param port is the port to add.
+     * @return the bit of the port in the masks returned by
+     * lookup_event_ports(), or -1 if the index is full and the port uses
+     * check_pcer() only. */
+    int add_port(Port *port)
+    {
+        OSMutexLock l(&lock_);
+        return get_port_bit(port);
+    }
+
+    /** Looks up all ports that have a consumer or producer for a given event.
+     * Does not take the lock in the steady state.
+     *
+     * @param event is the event ID from the PCER message.
+     * @return bitmask of the ports (by their bit returned from add_port())
+     * that need to receive the event. */
+    PortMask lookup_event_ports(EventId event)
+    {
+        if (dirty_.load(std::memory_order_acquire))
+        {
+            OSMutexLock l(&lock_);
+            publish();
+        }
+        readers_.fetch_add(1);
+        PortMask ret = published_.load()->lookup(event);
+        readers_.fetch_sub(1);
+        return ret;
     }
 
     /** Clears all entries in the routing table related to a given port, as the
@@ -81,18 +171,36 @@ public:
     {
         OSMutexLock l(&lock_);
         eventRoutingTable_.erase(port);
-        // Removing entries from a hashmap invalidates an iterator, thus it is
-        // safer to null them out than actually remove. Having a null value
-        // will cause address lookup to return null for a node that has not
-        // been seen since then elsewhere, which is exactly the behavior we
-        // want.
-        for (auto &it : addressRoutingTable_)
+        auto ib = portBits_.find(port);
+        if (ib != portBits_.end())
         {
-            if (it.second == port)
+            index_.remove_bit(ib->second);
+            usedBits_ &= ~(PortMask(1) << ib->second);
+            portBits_.erase(ib);
+            dirty_.store(true, std::memory_order_release);
+        }
+        // Lock-free readers may be walking the table, so we null out the
+        // entries instead of removing them. Having a null value will cause
+        // address lookup to return null for a node that has not been seen
+        // since then elsewhere, which is exactly the behavior we want. The
+        // entries are dropped at the next compaction.
+        AddressTable *t = addressTable_.load();
+        for (unsigned i = 0; i <= t->mask_; ++i)
+        {
+            AddressSlot *s = t->slots_ + i;
+            if (s->key_.load(std::memory_order_relaxed) &&
+                s->port_.load(std::memory_order_relaxed) == port)
             {
-                it.second = nullptr;
+                s->port_.store(nullptr, std::memory_order_release);
+                --liveAddresses_;
+                ++staleAddresses_;
             }
         }
+        if (staleAddresses_ > liveAddresses_ &&
+            staleAddresses_ > MIN_ADDRESS_CAPACITY / 4)
+        {
+            compact_addresses();
+        }
     }
 
     /** Declares that a given node ID is reachable via a specific port. Used
@@ -104,8 +212,41 @@ public:
      */
     void add_node_id_to_route(Port *port, Address source)
     {
+        if (!source)
+        {
+            // Zero is not a valid node address; it marks empty slots.
+            return;
+        }
+        readers_.fetch_add(1);
+        AddressSlot *s = addressTable_.load()->find(source);
+        bool known = s && s->port_.load(std::memory_order_acquire) == port;
+        readers_.fetch_sub(1);
+        if (known)
+        {
+            // Common case: the source is already routed to this port.
+            return;
+        }
         OSMutexLock l(&lock_);
-        addressRoutingTable_[source] = port;
+        s = addressTable_.load()->find(source);
+        if (s)
+        {
+            Port *old = s->port_.load(std::memory_order_relaxed);
+            if (!old)
+            {
+                ++liveAddresses_;
+                --staleAddresses_;
+            }
+            s->port_.store(port, std::memory_order_release);
+            return;
+        }
+        AddressTable *t = addressTable_.load();
+        if ((liveAddresses_ + staleAddresses_ + 1) * 2 > t->mask_ + 1)
+        {
+            compact_addresses();
+            t = addressTable_.load();
+        }
+        t->insert(source, port);
+        ++liveAddresses_;
     }
 
     /** Looks up which port an addressed packet should be sent to.
@@ -116,12 +257,35 @@ public:
      * nullptr.
      */
     Port *lookup_port_for_address(Address dest)
+    {
+        readers_.fetch_add(1);
+        AddressSlot *s = addressTable_.load()->find(dest);
+        Port *ret = s ? s->port_.load(std::memory_order_acquire) : nullptr;
+        readers_.fetch_sub(1);
+        // The statistics do not need to be exact under concurrent lookups,
+        // so we avoid the cost of atomic read-modify-write operations.
+        lookups_.store(lookups_.load(std::memory_order_relaxed) + 1,
+            std::memory_order_relaxed);
+        if (ret)
+        {
+            hits_.store(hits_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+        }
+        return ret;
+    }
+
+    /// @return statistics of the address table.
+    AddressStats address_stats()
     {
         OSMutexLock l(&lock_);
-        auto it = addressRoutingTable_.find(dest);
-        if (it == addressRoutingTable_.end())
-            return nullptr;
-        return it->second;
+        AddressStats ret;
+        ret.size = liveAddresses_;
+        ret.capacity = addressTable_.load()->mask_ + 1;
+        ret.stale = staleAddresses_;
+        ret.compactions = compactions_;
+        ret.lookups = lookups_.load(std::memory_order_relaxed);
+        ret.hits = hits_.load(std::memory_order_relaxed);
+        return ret;
     }
 
     /** Declares that there is a consumer for the given event ID on the given
@@ -133,7 +297,7 @@ public:
     void register_consumer(Port *port, EventId event)
     {
         OSMutexLock l(&lock_);
-        eventRoutingTable_[port].registeredConsumers_[0].insert(event);
+        add_event(port, 0, event);
     }
 
     /** Declares that there is a consumer for the given event ID range on the
@@ -146,8 +310,7 @@ public:
     {
         OSMutexLock l(&lock_);
         uint8_t bit_count = event_range_to_bit_count(&encoded_range);
-        eventRoutingTable_[port].registeredConsumers_[bit_count].insert(
-            encoded_range);
+        add_event(port, bit_count, encoded_range);
     }
 
     /** Declares that there is a producer for the given event ID on the given
@@ -185,6 +348,11 @@ public:
     bool check_pcer(Port *port, EventId event)
     {
         OSMutexLock l(&lock_);
+        auto ib = portBits_.find(port);
+        if (ib != portBits_.end())
+        {
+            return index_.lookup(event) & (PortMask(1) << ib->second);
+        }
         auto ip = eventRoutingTable_.find(port);
         if (ip == eventRoutingTable_.end())
         {
@@ -215,13 +383,342 @@ public:
     }
 
 private:
+    /// Maps events and event ranges to the set of ports interested in them.
+    struct EventIndex
+    {
+        /// @return the ports interested in an event. @param event is the
+        /// event ID.
+        PortMask lookup(EventId event) const
+        {
+            PortMask ret = allEvents_;
+            auto it = exact_.find(event);
+            if (it != exact_.end())
+            {
+                ret |= it->second;
+            }
+            for (const auto &r : ranges_)
+            {
+                EventId masked = event & ~((UINT64_C(1) << r.first) - 1);
+                auto ir = r.second.find(masked);
+                if (ir != r.second.end())
+                {
+                    ret |= ir->second;
+                }
+            }
+            return ret;
+        }
+
+        /// Adds a port to an event or range. @param bit is the bit of the
+        /// port, @param bit_count is the range width (0 for single events),
+        /// @param event is the event or the base of the range. @return true
+        /// if the index changed.
+        bool add(unsigned bit, uint8_t bit_count, EventId event)
+        {
+            PortMask m = PortMask(1) << bit;
+            PortMask *entry;
+            if (bit_count == 0)
+            {
+                entry = &exact_[event];
+            }
+            else if (bit_count >= 64)
+            {
+                entry = &allEvents_;
+            }
+            else
+            {
+                entry = &ranges_[bit_count][event];
+            }
+            if (*entry & m)
+            {
+                return false;
+            }
+            *entry |= m;
+            return true;
+        }
+
+        /// Removes a port from all entries. @param bit is the bit of the
+        /// port.
+        void remove_bit(unsigned bit)
+        {
+            PortMask m = ~(PortMask(1) << bit);
+            allEvents_ &= m;
+            remove_bit(&exact_, m);
+            for (auto ir = ranges_.begin(); ir != ranges_.end();)
+            {
+                remove_bit(&ir->second, m);
+                if (ir->second.empty())
+                {
+                    ir = ranges_.erase(ir);
+                }
+                else
+                {
+                    ++ir;
+                }
+            }
+        }
+
+        /// Applies a mask to all entries of a map, dropping the entries that
+        /// become empty. @param entries is the map, @param m is the mask.
+        static void remove_bit(
+            std::unordered_map<EventId, PortMask> *entries, PortMask m)
+        {
+            for (auto it = entries->begin(); it != entries->end();)
+            {
+                it->second &= m;
+                if (!it->second)
+                {
+                    it = entries->erase(it);
+                }
+                else
+                {
+                    ++it;
+                }
+            }
+        }
+
+        /// Ports registered for single events.
+        std::unordered_map<EventId, PortMask> exact_;
+        /// Ports registered for ranges. Key: number of mask bits (1..63);
+        /// value: masked range base to ports.
+        std::map<uint8_t, std::unordered_map<EventId, PortMask>> ranges_;
+        /// Ports that registered the range covering every event.
+        PortMask allEvents_{0};
+    };
+
+    /// Finds or assigns the bit of a port in the event index. Must be called
+    /// with lock_ held. @param port is the port. @return the bit or -1 if
+    /// all bits are taken.
+    int get_port_bit(Port *port)
+    {
+        auto it = portBits_.find(port);
+        if (it != portBits_.end())
+        {
+            return it->second;
+        }
+        if (usedBits_ == ~PortMask(0))
+        {
+            return -1;
+        }
+        unsigned bit = __builtin_ctzll(~usedBits_);
+        usedBits_ |= PortMask(1) << bit;
+        portBits_[port] = bit;
+        return bit;
+    }
+
+    /// Registers an event or range for a port. Must be called with lock_
+    /// held. @param port is the port, @param bit_count is the range width (0
+    /// for single events), @param event is the event or the base of the
+    /// range.
+    void add_event(Port *port, uint8_t bit_count, EventId event)
+    {
+        int bit = get_port_bit(port);
+        if (bit < 0)
+        {
+            eventRoutingTable_[port].registeredConsumers_[bit_count].insert(
+                event);
+            return;
+        }
+        if (index_.add(bit, bit_count, event))
+        {
+            dirty_.store(true, std::memory_order_release);
+        }
+    }
+
+    /// Makes the current state of index_ visible to lookup_event_ports().
+    /// Must be called with lock_ held.
+    void publish()
+    {
+        if (!dirty_.load())
+        {
+            // Another thread published already.
+            return;
+        }
+        dirty_.store(false);
+        retired_.push_back(published_.exchange(new EventIndex(index_)));
+        reclaim();
+    }
+
+    /// Table slot for one address. An empty slot has key_ == 0; once a key
+    /// is set it stays in that slot for the lifetime of the table.
+    struct AddressSlot
+    {
+        /// Address of the node, 0 if the slot is empty.
+        std::atomic<Address> key_;
+        /// Port the node is reachable through, nullptr if removed.
+        std::atomic<Port *> port_;
+    };
+
+    /// Open-addressing (linear probing) hash table of addresses. Written
+    /// only under lock_, read without locking.
+    struct AddressTable
+    {
+        /// Constructor. @param capacity is the number of slots, must be a
+        /// power of two.
+        AddressTable(unsigned capacity)
+            : mask_(capacity - 1)
+            , slots_(new AddressSlot[capacity])
+        {
+            HASSERT((capacity & mask_) == 0);
+            for (unsigned i = 0; i < capacity; ++i)
+            {
+                slots_[i].key_.store(0, std::memory_order_relaxed);
+                slots_[i].port_.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        ~AddressTable()
+        {
+            delete[] slots_;
+        }
+
+        /// @return the first slot to probe for an address. @param a is the
+        /// address.
+        unsigned hash(Address a) const
+        {
+            uint64_t h = (uint64_t)a * UINT64_C(0x9E3779B97F4A7C15);
+            return (h >> 32) & mask_;
+        }
+
+        /// @return the slot of an address, or nullptr if it is not in the
+        /// table. @param a is the address.
+        AddressSlot *find(Address a) const
+        {
+            for (unsigned i = hash(a);; i = (i + 1) & mask_)
+            {
+                Address k = slots_[i].key_.load(std::memory_order_acquire);
+                if (k == a)
+                {
+                    return slots_ + i;
+                }
+                if (k == 0)
+                {
+                    return nullptr;
+                }
+            }
+        }
+
+        /// Adds an address that is not in the table yet. The table must have
+        /// an empty slot. @param a is the address, @param p is the port.
+        void insert(Address a, Port *p)
+        {
+            unsigned i = hash(a);
+            while (slots_[i].key_.load(std::memory_order_relaxed) != 0)
+            {
+                i = (i + 1) & mask_;
+            }
+            // The port must be visible before the key is.
+            slots_[i].port_.store(p, std::memory_order_relaxed);
+            slots_[i].key_.store(a, std::memory_order_release);
+        }
+
+        /// Index mask (number of slots - 1).
+        unsigned mask_;
+        /// The slots.
+        AddressSlot *slots_;
+    };
+
+    /// Replaces the address table with a new one holding only the live
+    /// entries, sized to be at most one quarter full. Must be called with
+    /// lock_ held.
+    void compact_addresses()
+    {
+        unsigned capacity = MIN_ADDRESS_CAPACITY;
+        while (capacity < (liveAddresses_ + 1) * 4)
+        {
+            capacity *= 2;
+        }
+        AddressTable *old = addressTable_.load();
+        AddressTable *t = new AddressTable(capacity);
+        for (unsigned i = 0; i <= old->mask_; ++i)
+        {
+            Address k = old->slots_[i].key_.load(std::memory_order_relaxed);
+            Port *p = old->slots_[i].port_.load(std::memory_order_relaxed);
+            if (k && p)
+            {
+                t->insert(k, p);
+            }
+        }
+        staleAddresses_ = 0;
+        ++compactions_;
+        addressTable_.store(t);
+        retiredTables_.push_back(old);
+        reclaim();
+    }
+
+    /// Frees the retired event index snapshots and address tables if no
+    /// reader is in flight. When more than MAX_RETIRED objects are waiting,
+    /// waits for the readers to drain. Must be called with lock_ held, after
+    /// the replacements are published.
+    void reclaim()
+    {
+        // A reader that arrives after this point will see the new
+        // objects. If there is no reader in flight, none of the retired
+        // ones can be in use.
+        if (retired_.size() + retiredTables_.size() > MAX_RETIRED)
+        {
+            // The lock-free lookups are short and never wait for lock_, so
+            // they drain quickly.
+            while (readers_.load() != 0)
+            {
+                usleep(10);
+            }
+        }
+        else if (readers_.load() != 0)
+        {
+            return;
+        }
+        for (EventIndex *e : retired_)
+        {
+            delete e;
+        }
+        retired_.clear();
+        for (AddressTable *t : retiredTables_)
+        {
+            delete t;
+        }
+        retiredTables_.clear();
+    }
+
+    /// Initial (and minimum) number of slots in the address table.
+    static constexpr unsigned MIN_ADDRESS_CAPACITY = 64;
+    /// How many retired snapshots and tables may wait for the readers before
+    /// reclaim() blocks on them.
+    static constexpr unsigned MAX_RETIRED = 8;
+
     /// Protects all internal data structures.
     OSMutex lock_;
 
+    /// Bit of each port in the event index.
+    std::map<Port *, unsigned> portBits_;
+    /// Bits of portBits_ that are in use.
+    PortMask usedBits_{0};
+    /// Current event index, modified under lock_.
+    EventIndex index_;
+    /// Snapshot of index_ that lookups use.
+    std::atomic<EventIndex *> published_;
     /// Stores all known addresses and which port they route to.
-    std::unordered_map<Address, Port *> addressRoutingTable_;
+    std::atomic<AddressTable *> addressTable_;
+    /// Number of lock-free lookups currently reading published_ or
+    /// addressTable_.
+    std::atomic<unsigned> readers_;
+    /// true if index_ changed since it was last published.
+    std::atomic<bool> dirty_;
+    /// Old snapshots that may still be in use by readers.
+    std::vector<EventIndex *> retired_;
+    /// Old address tables that may still be in use by readers.
+    std::vector<AddressTable *> retiredTables_;
+    /// Number of addresses in addressTable_ with a live port.
+    unsigned liveAddresses_{0};
+    /// Number of addresses in addressTable_ whose port was removed.
+    unsigned staleAddresses_{0};
+    /// Number of address table compactions.
+    unsigned compactions_{0};
+    /// Number of address lookups.
+    std::atomic<unsigned> lookups_;
+    /// Number of address lookups that found a port.
+    std::atomic<unsigned> hits_;
 
-    /// The per-port event information.
+    /// The per-port event information for the ports not in the event index.
     struct EventSet
     {
         /// key: number of bits set in the mask part. Valid values:
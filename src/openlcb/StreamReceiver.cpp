@@ -52,6 +52,9 @@ void StreamReceiverCan::announced_stream()
     pendingInit_ = 0;
     pendingCancel_ = 0;
     isWaiting_ = 0;
+    pendingWakeup_ = 0;
+    windowEnded_ = 0;
+    release_window_buffers();
 
     if (!request()->streamWindowSize_)
     {
@@ -136,6 +139,9 @@ void StreamReceiverCan::handle_stream_initiate(Buffer<GenMessage> *message)
 
     streamWindowRemaining_ = request()->streamWindowSize_;
     totalByteCount_ = 0;
+    proceedThreshold_ = 0;
+    windowStartTime_ = os_get_time_monotonic();
+    windowDuration_ = 0;
 
     node()->iface()->dispatcher()->register_handler(
         &streamCompleteHandler_, Defs::MTI_STREAM_COMPLETE, Defs::MTI_EXACT);
@@ -144,20 +150,56 @@ void StreamReceiverCan::handle_stream_initiate(Buffer<GenMessage> *message)
         Defs::MTI_STREAM_INITIATE_REQUEST, Defs::MTI_EXACT);
 
     pendingInit_ = 1;
-    notify();
+    wakeup_flow();
+}
+
+void StreamReceiverCan::window_gap(long long gap)
+{
+    uint16_t window = request()->streamWindowSize_;
+    uint32_t max_threshold = window * maxWindowsAhead_;
+    if (!windowDuration_ || proceedThreshold_ >= max_threshold)
+    {
+        return;
+    }
+    // How many bytes the sender could have sent while it was waiting.
+    long long missed = gap * window / windowDuration_;
+    if (missed <= 2 * MAX_BYTES_PER_CAN_FRAME)
+    {
+        // Usual spacing between frames; the sender was not waiting.
+        return;
+    }
+    missed += proceedThreshold_;
+    proceedThreshold_ = missed < max_threshold ? missed : max_threshold;
+    LOG(VERBOSE, "stream receiver: proceed threshold %u",
+        (unsigned)proceedThreshold_);
 }
 
 void StreamReceiverCan::handle_bytes_received(const uint8_t *data, size_t len)
 {
+    if (windowEnded_)
+    {
+        windowEnded_ = 0;
+        long long now = os_get_time_monotonic();
+        window_gap(now - windowEndTime_);
+        windowStartTime_ = now;
+    }
     while (len > 0)
     {
+        if (!streamWindowRemaining_ && !nextLastBuffers_.empty() &&
+            !streamClosed_)
+        {
+            // Starts the window that we granted early.
+            streamWindowRemaining_ = request()->streamWindowSize_;
+            lastBuffer_ = std::move(nextLastBuffers_.front());
+            nextLastBuffers_.erase(nextLastBuffers_.begin());
+        }
         if (!currentBuffer_)
         {
             // Need to allocate a new chunk first.
             mainBufferPool->alloc(&currentBuffer_);
             // Add an empty raw buffer to it.
             RawBufferPtr rb;
-            if (streamWindowRemaining_ <= RawData::MAX_SIZE)
+            if (streamWindowRemaining_ <= RawData::MAX_SIZE && lastBuffer_)
             {
                 // We need to use the last raw buffer.
                 rb = std::move(lastBuffer_);
@@ -169,7 +211,13 @@ void StreamReceiverCan::handle_bytes_received(const uint8_t *data, size_t len)
             }
             currentBuffer_->data()->set_from(std::move(rb), 0);
         }
-        size_t copied = currentBuffer_->data()->append(data, len);
+        size_t copy_len = len;
+        if (streamWindowRemaining_ && copy_len > streamWindowRemaining_)
+        {
+            // The rest belongs to the next window.
+            copy_len = streamWindowRemaining_;
+        }
+        size_t copied = currentBuffer_->data()->append(data, copy_len);
         data += copied;
         len -= copied;
         totalByteCount_ += copied;
@@ -187,11 +235,17 @@ void StreamReceiverCan::handle_bytes_received(const uint8_t *data, size_t len)
             // Sends off the buffer and clears currentBuffer_.
             request()->target_->send(currentBuffer_.release());
         }
+        if (!streamWindowRemaining_ && !streamClosed_)
+        {
+            windowEnded_ = 1;
+            windowEndTime_ = os_get_time_monotonic();
+            windowDuration_ = windowEndTime_ - windowStartTime_;
+        }
     } // while len > 0
-    if (!streamWindowRemaining_)
+    if ((!streamWindowRemaining_ && streamClosed_) || need_proceed())
     {
-        // wake up state flow to send ack to the stream
-        notify();
+        // wake up state flow to send ack to the stream or to finish.
+        wakeup_flow();
     }
 }
 
@@ -244,7 +298,7 @@ void StreamReceiverCan::handle_stream_complete(Buffer<GenMessage> *message)
     if (!streamWindowRemaining_)
     {
         // wake up the flow.
-        notify();
+        wakeup_flow();
     }
 
     node()->iface()->dispatcher()->unregister_handler(
@@ -301,13 +355,20 @@ private:
 
 StreamReceiverCan::StreamReceiverCan(IfCan *interface, uint8_t local_stream_id)
     : StreamReceiverInterface(interface)
+    , lastBufferPool_(sizeof(RawBuffer),
+          config_stream_receiver_window_count(), rawBufferPool)
     , dataHandler_(new StreamDataHandler(this))
+    , maxWindowsAhead_(config_stream_receiver_window_count() - 1)
     , assignedStreamId_(local_stream_id)
     , streamClosed_(0)
     , pendingInit_(0)
     , pendingCancel_(0)
     , isWaiting_(0)
-{ }
+    , pendingWakeup_(0)
+    , windowEnded_(0)
+{
+    nextLastBuffers_.reserve(maxWindowsAhead_);
+}
 
 StreamReceiverCan::~StreamReceiverCan()
 { }
@@ -343,6 +404,7 @@ StateFlowBase::Action StreamReceiverCan::wakeup()
             // Sends off the buffer and clears currentBuffer_.
             request()->target_->send(currentBuffer_.release());
         }
+        release_window_buffers();
         return return_with_error(StreamReceiveRequest::ERROR_CANCELED);
     }
     if (pendingInit_)
@@ -350,23 +412,26 @@ StateFlowBase::Action StreamReceiverCan::wakeup()
         pendingInit_ = 0;
         return call_immediately(STATE(init_reply));
     }
-    if (!streamWindowRemaining_)
+    if (!streamWindowRemaining_ && streamClosed_)
     {
-        if (streamClosed_)
+        streamClosed_ = 0;
+        dataHandler_->stop();
+        if (currentBuffer_)
         {
-            streamClosed_ = 0;
-            dataHandler_->stop();
-            if (currentBuffer_)
-            {
-                // Sends off the buffer and clears currentBuffer_.
-                request()->target_->send(currentBuffer_.release());
-            }
-            return return_ok();
+            // Sends off the buffer and clears currentBuffer_.
+            request()->target_->send(currentBuffer_.release());
         }
-        // Need to send an ack.
+        release_window_buffers();
+        return return_ok();
+    }
+    if (need_proceed())
+    {
+        // Need to send an ack. When the window is not used up yet, this
+        // grants the next window early, so that the sender does not have to
+        // stop and wait for the stream proceed message.
         return call_immediately(STATE(window_reached));
     }
-    return wait();
+    return wait_for_wakeup();
 }
 
 StateFlowBase::Action StreamReceiverCan::init_reply()
@@ -400,12 +465,26 @@ StateFlowBase::Action StreamReceiverCan::window_reached()
 
 StateFlowBase::Action StreamReceiverCan::have_raw_buffer()
 {
-    lastBuffer_.reset(get_allocation_result<RawData>(nullptr));
-    streamWindowRemaining_ = request()->streamWindowSize_;
+    RawBufferPtr rb(get_allocation_result<RawData>(nullptr));
+    if (streamClosed_)
+    {
+        // No more windows needed.
+        return wait_for_wakeup();
+    }
+    if (streamWindowRemaining_ || !nextLastBuffers_.empty())
+    {
+        nextLastBuffers_.push_back(std::move(rb));
+    }
+    else
+    {
+        lastBuffer_ = std::move(rb);
+        streamWindowRemaining_ = request()->streamWindowSize_;
+    }
     send_message(node(), Defs::MTI_STREAM_PROCEED, request()->src_,
         StreamDefs::create_data_proceed(
             request()->srcStreamId_, request()->localStreamId_));
-    return wait_for_wakeup();
+    // Maybe more windows need to be granted.
+    return call_immediately(STATE(wakeup));
 }
 
 } // namespace openlcb
@@ -43,6 +43,8 @@
 #include "utils/ByteBuffer.hxx"
 #include "utils/LimitedPool.hxx"
 
+#include <vector>
+
 namespace openlcb
 {
 
@@ -80,14 +82,31 @@ private:
 
     Action wait_for_wakeup()
     {
-        if (pendingCancel_)
+        if (pendingCancel_ || pendingWakeup_)
         {
+            pendingWakeup_ = 0;
             return call_immediately(STATE(wakeup));
         }
         isWaiting_ = 1;
         return wait_and_call(STATE(wakeup));
     }
 
+    /// Wakes up the state flow from the handlers. If the flow is busy (e.g.
+    /// waiting for a buffer allocation), it will look at the state again when
+    /// it is done.
+    void wakeup_flow()
+    {
+        if (isWaiting_)
+        {
+            isWaiting_ = 0;
+            notify();
+        }
+        else
+        {
+            pendingWakeup_ = 1;
+        }
+    }
+
     /// Root of the flow when something happens in the handlers.
     Action wakeup();
 
@@ -96,13 +115,47 @@ private:
     Action init_reply();
     Action init_buffer_ready();
 
-    /// Invoked when the stream window runs out. Maybe waits for the data to be
-    /// consumed below the low-watermark.
+    /// Invoked when the stream window runs out, or gets close enough to the
+    /// end to grant the next window. Maybe waits for the data to be consumed
+    /// below the low-watermark.
     Action window_reached();
     /// Called when the allocation of the raw buffer is successful. Sends off
     /// the stream proceed message.
     Action have_raw_buffer();
 
+    /// Called when the first bytes arrive after the end of a window. Grows
+    /// proceedThreshold_ if the sender had to wait for the stream proceed.
+    /// @param gap how long no data arrived, in nanoseconds.
+    void window_gap(long long gap);
+
+    /// Releases the buffers that throttle the stream windows.
+    void release_window_buffers()
+    {
+        lastBuffer_.reset();
+        nextLastBuffers_.clear();
+    }
+
+    /// @return true if the next stream window should be granted now.
+    bool need_proceed()
+    {
+        if (streamClosed_)
+        {
+            return false;
+        }
+        if (!streamWindowRemaining_ && nextLastBuffers_.empty())
+        {
+            // Window is used up.
+            return true;
+        }
+        if (nextLastBuffers_.size() >= maxWindowsAhead_)
+        {
+            return false;
+        }
+        uint32_t granted = streamWindowRemaining_ +
+            nextLastBuffers_.size() * request()->streamWindowSize_;
+        return granted <= proceedThreshold_;
+    }
+
     /// Invoked by the GenericHandler when a stream initiate message arrives.
     ///
     /// @param message buffer with stream initiate message.
@@ -133,6 +186,9 @@ private:
         return request()->dst_;
     }
 
+    /// How many bytes of stream payload fit into a single CAN frame.
+    static constexpr unsigned MAX_BYTES_PER_CAN_FRAME = 7;
+
     /// Helper class for incoming message for stream initiate.
     MessageHandler::GenericHandler streamInitiateHandler_ {
         this, &StreamReceiverCan::handle_stream_initiate};
@@ -146,9 +202,10 @@ private:
 
     /// This pool is used to allocate one raw buffer per stream window
     /// size. This pool therefore functions as a throttling for the data
-    /// producer. We have a fixed size of 2, meaning that we are allowing
-    /// ourselves to load 2x the stream window size into our RAM.
-    LimitedPool lastBufferPool_ {sizeof(RawBuffer), 2, rawBufferPool};
+    /// producer. The size is config_stream_receiver_window_count() (by
+    /// default 2), meaning that we are allowing ourselves to load that many
+    /// times the stream window size into our RAM.
+    LimitedPool lastBufferPool_;
 
     /// The buffer that we are currently filling with incoming data.
     ByteBufferPtr currentBuffer_;
@@ -157,14 +214,36 @@ private:
     /// comes from the lastBufferPool_ to function as throttling signal.
     RawBufferPtr lastBuffer_;
 
+    /// The last buffers of the next stream windows that were already granted
+    /// by early stream proceed messages, in order.
+    std::vector<RawBufferPtr> nextLastBuffers_;
+
     /// Helper object that receives the actual stream CAN frames.
     std::unique_ptr<StreamDataHandler> dataHandler_;
 
     /// How many bytes we have transmitted in this stream so far.
     size_t totalByteCount_;
 
-    /// Remaining stream window size.
-    uint16_t streamWindowRemaining_;
+    /// Remaining stream window size. After the stream complete message, the
+    /// number of bytes still to arrive.
+    uint32_t streamWindowRemaining_;
+
+    /// We grant the next window when the sender may send at most this many
+    /// more bytes (0: only when the window is used up). Grows when the
+    /// sender is seen waiting for the stream proceed message.
+    uint32_t proceedThreshold_;
+
+    /// How many windows may be granted ahead of the current one.
+    const uint8_t maxWindowsAhead_;
+
+    /// When the first bytes of the current window arrived.
+    long long windowStartTime_;
+
+    /// When the last window ran out.
+    long long windowEndTime_;
+
+    /// How long it took to receive the last full window, 0 if unknown.
+    long long windowDuration_;
 
     /// Unique stream ID at the destination (local) node, assigned at
     /// construction time.
@@ -178,6 +257,10 @@ private:
     uint8_t pendingCancel_ : 1;
     /// 1 if we are currently waiting for a notification
     uint8_t isWaiting_ : 1;
+    /// 1 if the handlers wanted to wake up the flow while it was busy.
+    uint8_t pendingWakeup_ : 1;
+    /// 1 if the window ran out and no data arrived since.
+    uint8_t windowEnded_ : 1;
 }; // class StreamReceiver
 
 } // namespace openlcb
@@ -308,7 +308,7 @@ private:
         dstStreamId_ = payload[5];
         streamFlags_ = payload[2];
         streamAdditionalFlags_ = payload[3];
-        streamWindowSize_ = (payload[0] << 8) | payload[1];
+        streamWindowSize_ = data_to_error(&payload[0]);
         // Grabs alias / node ID from the cache.
         node_->iface()->canonicalize_handle(&dst_);
 
@@ -585,8 +585,10 @@ private:
     uint8_t streamAdditionalFlags_ {0};
     /// Total stream window size. @todo fill in
     uint16_t streamWindowSize_ {StreamDefs::MAX_PAYLOAD};
-    /// Remaining stream window size. @todo fill in
-    uint16_t streamWindowRemaining_ {0};
+    /// Remaining stream window size. The receiver may send the stream proceed
+    /// message before the window is used up, so this can be more than one
+    /// window.
+    uint32_t streamWindowRemaining_ {0};
     /// When the stream process fails, this variable contains an error code.
     uint32_t errorCode_ {0};
     /// Source of buffers for outgoing CAN frames. Limtedpool is allocating and
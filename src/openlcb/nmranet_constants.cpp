@@ -36,12 +36,18 @@
 /** Number of entries in the remote alias cache */
 DEFAULT_CONST(remote_alias_cache_size, 10);
 
+/** Index the remote alias cache with sorted vectors. */
+DEFAULT_CONST_FALSE(remote_alias_cache_hashed);
+
 /** Number of entries in the local alias cache */
 DEFAULT_CONST(local_alias_cache_size, 3);
 
 /** Keep this many allocated but unused aliases around. */
 DEFAULT_CONST(reserve_unused_alias_count, 0);
 
+/** Refill the unused aliases when all of them are used up. */
+DEFAULT_CONST(reserve_unused_alias_low_watermark, 0);
+
 /** Maximum number of local nodes */
 DEFAULT_CONST(local_nodes_count, 2);
 
@@ -78,3 +84,6 @@ DEFAULT_CONST(bulk_alias_num_can_frames, 20);
 /** Default number of bytes in maximum stream window size for { @ref
  * StreamReceiver }. */
 DEFAULT_CONST(stream_receiver_default_window_size, 2 * 1024);
+
+/** How many stream windows { @ref StreamReceiver } may keep in RAM. */
+DEFAULT_CONST(stream_receiver_window_count, 2);
@@ -119,6 +119,11 @@
 #else
 /// Use pthread for os_thread_create.
 #define OPENMRN_FEATURE_THREAD_PTHREAD 1
+/// Executors take new executables through lock-free MPSC queues
+/// (utils/MpscQueue.hxx). Not used on RTOS targets: there the executor could
+/// spin on a producer that was preempted in the middle of an insert, so the
+/// run queue stays protected by a critical section.
+#define OPENMRN_FEATURE_EXECUTOR_MPSC_QUEUE 1
 #if !defined (__MINGW32__) && !defined (__MACH__)
 /// Use pthread_setname for setting the newly created thread's name.
 #define OPENMRN_HAVE_PTHREAD_SETNAME 1
@@ -164,6 +169,73 @@
 
 #endif
 
+#if defined(__linux__) || defined(__MACH__)
+/// Uses ::writev for coalescing multiple buffers into one write syscall
+/// (HubDeviceSelect batched writes).
+#define OPENMRN_HAVE_WRITEV 1
+#endif
+
+#if defined(__linux__)
+/// Uses ::recvmmsg and ::sendmmsg for transferring multiple datagrams (such
+/// as SocketCAN frames) in one syscall.
+#define OPENMRN_HAVE_MMSG 1
+#endif
+
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+/// The kernel headers provide io_uring (HubDeviceUring). Whether the
+/// running kernel supports it is checked at runtime.
+#define OPENMRN_HAVE_IO_URING 1
+#endif
+#endif
+
+#ifndef OPENMRN_FEATURE_EXECUTOR_STATS
+/// Set to 1 (-DOPENMRN_FEATURE_EXECUTOR_STATS=1) to collect per-Executable
+/// queue wait and run time statistics in the executors. See
+/// executor/ExecutorStats.hxx and utils/ExecutorStatsLogger.hxx.
+#define OPENMRN_FEATURE_EXECUTOR_STATS 0
+#endif
+
+#ifndef OPENMRN_FEATURE_TIMER_WHEEL
+/// Set to 1 (-DOPENMRN_FEATURE_TIMER_WHEEL=1) to keep the active timers of
+/// the executors in a hierarchical timing wheel instead of a sorted list.
+/// Scheduling, updating and removing a timer becomes O(1) instead of O(n),
+/// at the cost of about 256 pointers of RAM per executor.
+#define OPENMRN_FEATURE_TIMER_WHEEL 0
+#endif
+
+#ifndef OPENMRN_FEATURE_EVENT_FLAT_REGISTRY
+/// Set to 1 (-DOPENMRN_FEATURE_EVENT_FLAT_REGISTRY=1) to use
+/// FlatEventHandlers (hash index for single events) instead of
+/// TreeEventHandlers as the event registry of the EventService. Useful for
+/// nodes that register thousands of events.
+#define OPENMRN_FEATURE_EVENT_FLAT_REGISTRY 0
+#endif
+
+#ifndef OPENMRN_FEATURE_EVENT_FILTER
+/// Set to 1 (-DOPENMRN_FEATURE_EVENT_FILTER=1) to keep a counting Bloom
+/// filter (openlcb/EventFilter.hxx) in the event registries. The
+/// EventService uses it to drop event reports that have no local handler
+/// before iterating the registry. Costs about 1.2 kbytes of RAM.
+#define OPENMRN_FEATURE_EVENT_FILTER 0
+#endif
+
+#ifndef OPENMRN_FEATURE_BUFFER_SLAB
+/// Set to 1 (-DOPENMRN_FEATURE_BUFFER_SLAB=1) to back the mainBufferPool with
+/// a SlabPool (utils/SlabPool.hxx): power-of-two size classes with a
+/// per-thread cache of free buffers, so that allocating and freeing buffers
+/// does not take a global lock in the common case.
+#define OPENMRN_FEATURE_BUFFER_SLAB 0
+#endif
+
+#ifndef OPENMRN_FEATURE_EXECUTOR_EPOLL
+/// Set to 1 (-DOPENMRN_FEATURE_EXECUTOR_EPOLL=1) on Linux to have the
+/// executors wait for Selectables using epoll instead of pselect. This removes
+/// the FD_SETSIZE limit and makes a wakeup cost proportional to the number of
+/// ready fds instead of the largest fd number.
+#define OPENMRN_FEATURE_EXECUTOR_EPOLL 0
+#endif
+
 #if !defined(__MACH__)
 /// Compiles support for calling reboot() in ConfigUpdateFlow.hxx and
 /// MemoryConfig.cxx.
@@ -33,6 +33,7 @@
 
 #include "os/OSSelectWakeup.hxx"
 #include "utils/logging.h"
+#include <limits.h>
 #if defined(__MACH__)
 #define _DARWIN_C_SOURCE // pselect
 #endif
@@ -107,6 +108,39 @@ int OSSelectWakeup::select(int nfds, fd_set *readfds,
     return ret;
 }
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+int OSSelectWakeup::epoll_wait(int epfd, struct epoll_event *events,
+                               int max_events, long long deadline_nsec)
+{
+    {
+        AtomicHolder l(this);
+        inSelect_ = true;
+        if (pendingWakeup_)
+        {
+            deadline_nsec = 0;
+        }
+    }
+    int timeout_msec;
+    if (deadline_nsec < 0)
+    {
+        timeout_msec = -1;
+    }
+    else
+    {
+        // Rounds up so that we do not return before the deadline.
+        long long msec = (deadline_nsec + 999999) / 1000000;
+        timeout_msec = msec > INT_MAX ? INT_MAX : (int)msec;
+    }
+    int ret = ::epoll_pwait(epfd, events, max_events, timeout_msec, &origMask_);
+    {
+        AtomicHolder l(this);
+        pendingWakeup_ = false;
+        inSelect_ = false;
+    }
+    return ret;
+}
+#endif // OPENMRN_FEATURE_EXECUTOR_EPOLL
+
 #ifdef ESP32
 #include "freertos_includes.h"
 
@@ -48,6 +48,10 @@
 #include <signal.h>
 #endif
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef __WINNT__
 #include <winsock2.h>
 #elif OPENMRN_HAVE_SELECT
@@ -205,6 +209,25 @@ public:
     int select(int nfds, fd_set *readfds, fd_set *writefds, fd_set *exceptfds,
                long long deadline_nsec);
 
+#if OPENMRN_FEATURE_EXECUTOR_EPOLL
+    /** Portable call to epoll_wait that can be woken up asynchronously from a
+     * different thread.
+     *
+     * @param epfd is the epoll instance to wait on.
+     * @param events is where the ready events will be stored.
+     * @param max_events is the size of the events array.
+     * @param deadline_nsec is the maximum time to sleep if no fd activity and
+     * no wakeup happens. -1 to sleep indefinitely, 0 to return immediately.
+     * Rounded up to milliseconds.
+     *
+     * @return what epoll_wait would return (number of ready events, 0 in case
+     * of timeout), or -1 and errno==EINTR if the wait was woken up
+     * asynchronously
+     */
+    int epoll_wait(int epfd, struct epoll_event *events, int max_events,
+                   long long deadline_nsec);
+#endif
+
 private:
 #ifdef ESP32
     void esp_allocate_vfs_fd();
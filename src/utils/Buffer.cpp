@@ -33,6 +33,8 @@
 
 #include "utils/Buffer.hxx"
 #include "utils/ByteBuffer.hxx"
+#include "utils/SlabPool.hxx"
+#include "openmrn_features.h"
 
 DynamicPool *mainBufferPool = nullptr;
 Pool *rawBufferPool = nullptr;
@@ -45,8 +47,12 @@ Pool* init_main_buffer_pool()
     }
     if (!mainBufferPool)
     {
+#if OPENMRN_FEATURE_BUFFER_SLAB
+        mainBufferPool = new SlabPool();
+#else
         mainBufferPool =
             new DynamicPool(Bucket::init(32, 48, LARGEST_BUFFERPOOL_BUCKET, 0));
+#endif
     }
     return mainBufferPool;
 }
@@ -177,6 +177,9 @@ protected:
     /** Allow DynamicPool access to our constructor */
     friend class DynamicPool;
 
+    /** Allow SlabPool access to our constructor */
+    friend class SlabPool;
+
     /** Allow FixedPool access to our constructor */
     friend class FixedPool;
 
@@ -42,6 +42,15 @@
 /// bytes for a specified delay timer before sending the data off. This helps
 /// accumulate more data per TCP packet and increase transmission efficiency.
 ///
+/// In adaptive mode (see set_adaptive()) the delay follows the measured
+/// arrival rate of the messages: the buffer is held open while messages keep
+/// arriving at about the average rate, and is flushed when no message came for
+/// twice the average inter-arrival time, or when the latency bound is
+/// reached. When the traffic is so sparse that no other message is expected
+/// within the latency bound, the message is sent on without buffering. The
+/// decisions use the inter-arrival time only; the message sizes are not
+/// measured, since a full buffer is flushed anyway.
+///
 // Added by default on GridConnect bridges.
 class BufferPort : public HubPort
 {
@@ -63,6 +72,8 @@ public:
         , bufSize_(buffer_bytes)
         , bufEnd_(0)
         , timerPending_(0)
+        , adaptive_(0)
+        , measured_(0)
     {
         HASSERT(sendBuf_);
     }
@@ -72,6 +83,36 @@ public:
         delete [] sendBuf_;
     }
 
+    /// Turns on adaptive mode. Must be called on the executor of the service
+    /// or before any data is sent.
+    ///
+    /// @param max_latency_nsec the longest time any data may be held back in
+    /// the buffer. Replaces the delay_nsec given in the constructor.
+    void set_adaptive(long long max_latency_nsec)
+    {
+        delayNsec_ = max_latency_nsec;
+        avgGapNsec_ = max_latency_nsec;
+        adaptive_ = 1;
+    }
+
+    /// @return how many buffers were sent downstream so far.
+    uint32_t num_flushes()
+    {
+        return numFlushes_;
+    }
+
+    /// @return how many incoming messages were sent downstream so far.
+    uint32_t num_messages()
+    {
+        return numMessages_;
+    }
+
+    /// @return the average number of bytes per buffer sent downstream.
+    unsigned avg_batch_bytes()
+    {
+        return numFlushes_ ? numBytes_ / numFlushes_ : 0;
+    }
+
     bool shutdown() {
         flush_buffer();
         if (timerPending_) {
@@ -86,6 +127,11 @@ public:
 private:
     Action entry() override
     {
+        if (adaptive_ && !measured_)
+        {
+            measured_ = 1;
+            measure_arrival();
+        }
         if (!tgtBuf_)
         {
             return allocate_and_call(downstream_, STATE(buf_alloc_done),
@@ -112,9 +158,12 @@ private:
                 opt_flush = true;
             }
         }
-        if (opt_flush && !bufEnd_)
+        if ((opt_flush || (adaptive_ && avgGapNsec_ >= delayNsec_)) &&
+            !bufEnd_)
         {
             // nothing accumulated, send off directly.
+            count_flush(1, msg().size());
+            measured_ = 0;
             downstream_->send(transfer_message(), priority());
             return exit();
         }
@@ -123,6 +172,7 @@ private:
             // Fits into the buffer.
             memcpy(sendBuf_ + bufEnd_, msg().data(), msg().size());
             bufEnd_ += msg().size();
+            ++bufMessages_;
             if (opt_flush)
             {
                 flush_buffer();
@@ -130,8 +180,17 @@ private:
             else if (!timerPending_)
             {
                 timerPending_ = 1;
-                bufferTimer_.start(delayNsec_);
+                if (adaptive_)
+                {
+                    flushDeadline_ = lastArrival_ + delayNsec_;
+                    bufferTimer_.start(idle_window());
+                }
+                else
+                {
+                    bufferTimer_.start(delayNsec_);
+                }
             }
+            measured_ = 0;
             return release_and_exit();
         }
         else
@@ -142,6 +201,8 @@ private:
         if (msg().size() >= bufSize_)
         {
             // Cannot buffer: send off directly.
+            count_flush(1, msg().size());
+            measured_ = 0;
             downstream_->send(transfer_message(), priority());
             return exit();
         }
@@ -160,6 +221,40 @@ private:
         return call_immediately(STATE(entry));
     }
 
+    /// Updates the moving average of the message inter-arrival time with the
+    /// current message.
+    void measure_arrival()
+    {
+        long long now = os_get_time_monotonic();
+        long long gap = now - lastArrival_;
+        lastArrival_ = now;
+        // Caps the effect of idle periods so that the estimate recovers
+        // quickly when traffic resumes.
+        if (gap > 2 * delayNsec_)
+        {
+            gap = 2 * delayNsec_;
+        }
+        avgGapNsec_ += (gap - avgGapNsec_) / 8;
+    }
+
+    /// @return how long to wait for the next message in adaptive mode
+    /// before flushing the buffer.
+    long long idle_window()
+    {
+        long long w = 2 * avgGapNsec_;
+        return w < delayNsec_ ? w : delayNsec_;
+    }
+
+    /// Updates the batching statistics. @param messages is the number of
+    /// incoming messages and @param bytes the number of bytes sent
+    /// downstream in one buffer.
+    void count_flush(unsigned messages, unsigned bytes)
+    {
+        ++numFlushes_;
+        numMessages_ += messages;
+        numBytes_ += bytes;
+    }
+
     /// Sends off any data we may have accumulated in the buffer to the
     /// downstream consumer.
     void flush_buffer()
@@ -168,7 +263,9 @@ private:
         auto *b = tgtBuf_;
         tgtBuf_ = nullptr;
         b->data()->assign(sendBuf_, bufEnd_);
+        count_flush(bufMessages_, bufEnd_);
         bufEnd_ = 0;
+        bufMessages_ = 0;
         if (message())
         {
             b->set_done(message()->new_child());
@@ -176,11 +273,26 @@ private:
         downstream_->send(b);
     }
 
-    /// Callback from the timer.
-    void timeout()
+    /// Callback from the timer. @return 0 if the buffer was flushed, or
+    /// the delay until the timer should be called again.
+    long long timeout()
     {
+        if (adaptive_ && bufEnd_)
+        {
+            long long now = os_get_time_monotonic();
+            long long w = idle_window();
+            if (now - lastArrival_ < w && now < flushDeadline_)
+            {
+                // Messages are still coming in; keeps collecting them.
+                long long left = flushDeadline_ - now;
+                w = w < left ? w : left;
+                // Values below 2 have a special meaning for the timer.
+                return w > 1000 ? w : 1000;
+            }
+        }
         timerPending_ = 0;
         flush_buffer();
+        return 0;
     }
 
     /// @return the current message that we are processing.
@@ -203,8 +315,8 @@ private:
 
         long long timeout() override
         {
-            parent_->timeout();
-            return NONE;
+            long long next = parent_->timeout();
+            return next ? next : (long long)NONE;
         }
 
     private:
@@ -230,6 +342,24 @@ private:
     /// 1 if the timer is running and there will be a timer callback coming in
     /// the future.
     unsigned timerPending_ : 1;
+    /// 1 if the delay is computed from the arrival rate.
+    unsigned adaptive_ : 1;
+    /// 1 if measure_arrival() was already called for the current message.
+    unsigned measured_ : 1;
+    /// Number of messages in the send buffer.
+    unsigned bufMessages_{0};
+    /// Moving average of the time between incoming messages (adaptive mode).
+    long long avgGapNsec_{0};
+    /// Time when the last message arrived (adaptive mode).
+    long long lastArrival_{0};
+    /// Time by which the buffered data must be sent (adaptive mode).
+    long long flushDeadline_{0};
+    /// Number of buffers sent downstream.
+    uint32_t numFlushes_{0};
+    /// Number of incoming messages sent downstream.
+    uint32_t numMessages_{0};
+    /// Number of bytes sent downstream.
+    uint32_t numBytes_{0};
 };
 
 #endif // _UTILS_BUFFERPORT_HXX_
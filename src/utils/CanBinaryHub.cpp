@@ -0,0 +1,726 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file CanBinaryHub.cpp
+ *
+ * Binary CAN-over-TCP record encoder/parser, bridge and auto-negotiating
+ * port.
+ *
+ * @author Balazs Racz
+ * @date 16 October 2026
+ */
+
+//#define LOGLEVEL VERBOSE
+
+#include "openmrn_features.h"
+
+#include "utils/CanBinaryHub.hxx"
+
+#include <string.h>
+
+#include "can_frame.h"
+#include "executor/StateFlow.hxx"
+#include "executor/Timer.hxx"
+#include "nmranet_config.h"
+#include "utils/Buffer.hxx"
+#include "utils/BufferPort.hxx"
+#include "utils/GridConnectHub.hxx"
+#include "utils/HubDevice.hxx"
+#if OPENMRN_FEATURE_EXECUTOR_SELECT
+#include "utils/HubDeviceSelect.hxx"
+#endif
+
+/// Bit of the info byte set for extended frames.
+static constexpr uint8_t INFO_EFF = 0x80;
+/// Bit of the info byte set for remote frames.
+static constexpr uint8_t INFO_RTR = 0x40;
+/// Bits of the info byte that have to be zero.
+static constexpr uint8_t INFO_RESERVED = 0x30;
+/// Bits of the info byte holding the data length code.
+static constexpr uint8_t INFO_DLC = 0x0F;
+/// Length of the record header (info byte and identifier).
+static constexpr unsigned HEADER_LENGTH = 5;
+
+size_t can_binary_encode(
+    const struct can_frame *frame, CanBinaryFormat fmt, uint8_t *out)
+{
+    if (IS_CAN_FRAME_ERR(*frame))
+    {
+        return 0;
+    }
+    uint8_t dlc = frame->can_dlc > 8 ? 8 : frame->can_dlc;
+    uint8_t info = dlc;
+    uint32_t id;
+    if (IS_CAN_FRAME_EFF(*frame))
+    {
+        info |= INFO_EFF;
+        id = GET_CAN_FRAME_ID_EFF(*frame);
+    }
+    else
+    {
+        id = GET_CAN_FRAME_ID(*frame);
+    }
+    if (IS_CAN_FRAME_RTR(*frame))
+    {
+        info |= INFO_RTR;
+    }
+    out[0] = info;
+    out[1] = id >> 24;
+    out[2] = id >> 16;
+    out[3] = id >> 8;
+    out[4] = id;
+    memcpy(out + HEADER_LENGTH, frame->data, dlc);
+    if (fmt == CanBinaryFormat::FIXED)
+    {
+        memset(out + HEADER_LENGTH + dlc, 0, 8 - dlc);
+        return CAN_BINARY_MAX_RECORD;
+    }
+    return HEADER_LENGTH + dlc;
+}
+
+void can_binary_hello(CanBinaryFormat fmt, uint8_t *out)
+{
+    out[0] = CAN_BINARY_HELLO_START;
+    out[1] = 'C';
+    out[2] = 'B';
+    out[3] = static_cast<uint8_t>(fmt);
+}
+
+bool can_binary_parse_hello(const uint8_t *data, CanBinaryFormat *fmt)
+{
+    if (data[0] != CAN_BINARY_HELLO_START || data[1] != 'C' ||
+        data[2] != 'B')
+    {
+        return false;
+    }
+    switch (data[3])
+    {
+        case static_cast<uint8_t>(CanBinaryFormat::FIXED):
+        case static_cast<uint8_t>(CanBinaryFormat::COMPACT):
+            *fmt = static_cast<CanBinaryFormat>(data[3]);
+            return true;
+        default:
+            return false;
+    }
+}
+
+unsigned CanBinaryParser::record_length()
+{
+    if (fmt_ == CanBinaryFormat::FIXED)
+    {
+        return CAN_BINARY_MAX_RECORD;
+    }
+    return HEADER_LENGTH + (rbuf_[0] & INFO_DLC);
+}
+
+size_t CanBinaryParser::consume_bytes(
+    const uint8_t *data, size_t len, bool *complete)
+{
+    const uint8_t *p = data;
+    const uint8_t *end = data + len;
+    *complete = false;
+    if (offset_ && offset_ == record_length())
+    {
+        // The previous call returned a complete record.
+        offset_ = 0;
+    }
+    while (p < end)
+    {
+        if (offset_ == 0)
+        {
+            if ((*p & INFO_RESERVED) || (*p & INFO_DLC) > 8)
+            {
+                // Not a valid record start; drops the byte to get back in
+                // sync with the record boundaries.
+                ++p;
+                continue;
+            }
+            rbuf_[offset_++] = *p++;
+            continue;
+        }
+        size_t need = record_length() - offset_;
+        size_t have = end - p;
+        if (have < need)
+        {
+            memcpy(rbuf_ + offset_, p, have);
+            offset_ += have;
+            return len;
+        }
+        memcpy(rbuf_ + offset_, p, need);
+        offset_ += need;
+        p += need;
+        *complete = true;
+        break;
+    }
+    return p - data;
+}
+
+void CanBinaryParser::parse_frame_to_output(struct can_frame *output_frame)
+{
+    uint8_t info = rbuf_[0];
+    uint32_t id = (uint32_t(rbuf_[1]) << 24) | (uint32_t(rbuf_[2]) << 16) |
+        (uint32_t(rbuf_[3]) << 8) | rbuf_[4];
+    CLR_CAN_FRAME_ERR(*output_frame);
+    if (info & INFO_EFF)
+    {
+        SET_CAN_FRAME_EFF(*output_frame);
+        SET_CAN_FRAME_ID_EFF(*output_frame, id);
+    }
+    else
+    {
+        CLR_CAN_FRAME_EFF(*output_frame);
+        SET_CAN_FRAME_ID(*output_frame, id);
+    }
+    if (info & INFO_RTR)
+    {
+        SET_CAN_FRAME_RTR(*output_frame);
+    }
+    else
+    {
+        CLR_CAN_FRAME_RTR(*output_frame);
+    }
+    output_frame->can_dlc = info & INFO_DLC;
+    memcpy(output_frame->data, rbuf_ + HEADER_LENGTH, output_frame->can_dlc);
+}
+
+/// Bridge between a string-typed Hub carrying the binary CAN protocol and a
+/// CAN-frame-typed Hub.
+class CanBinaryAdapter : public GCAdapterBase
+{
+public:
+    /// Constructor.
+    ///
+    /// @param read_side A hub of type string to read records from. The read
+    /// records will be parsed and sent to can_side.
+    /// @param write_side A hub of type string to write the rendered records
+    /// to.
+    /// @param can_side A hub of type struct can_frame.
+    /// @param fmt record format of the binary side.
+    /// @param write_skip if not null, the rendered records will not be
+    /// delivered to this member of write_side.
+    CanBinaryAdapter(HubFlow *read_side, HubFlow *write_side,
+        CanHubFlow *can_side, CanBinaryFormat fmt, HubPort *write_skip)
+        : parser_(can_side->service(), can_side, &formatter_, fmt)
+        , formatter_(can_side->service(), write_side,
+              write_skip ? write_skip : &parser_, fmt)
+        , readSide_(read_side)
+    {
+        read_side->register_port(&parser_);
+        can_side->register_shared_port(&formatter_);
+        isRegistered_ = 1;
+    }
+
+    ~CanBinaryAdapter()
+    {
+        unregister();
+    }
+
+    /// Removes the members from the hubs.
+    void unregister()
+    {
+        if (isRegistered_)
+        {
+            parser_.destination()->unregister_port(&formatter_);
+            readSide_->unregister_port(&parser_);
+            isRegistered_ = 0;
+        }
+    }
+
+    bool shutdown() override
+    {
+        unregister();
+        return formatter_.shutdown() && parser_.is_waiting() &&
+            formatter_.is_waiting();
+    }
+
+    /// HubPort (on a CAN-typed hub) that renders CAN frames into binary
+    /// records, and sends them off to the HubFlow (of type string).
+    class FrameToRecordMember : public CanHubPort
+    {
+    public:
+        /// Constructor.
+        ///
+        /// @param service which executor to run on
+        /// @param destination string hub where to write the records to.
+        /// @param skip_member what to set the skipMember_ field of the
+        /// outgoing packets to.
+        /// @param fmt record format to render.
+        FrameToRecordMember(Service *service, HubFlow *destination,
+            HubPort *skip_member, CanBinaryFormat fmt)
+            : CanHubPort(service)
+            , delayPort_(service, destination, config_gridconnect_buffer_size(),
+                  USEC_TO_NSEC(config_gridconnect_buffer_delay_usec()))
+            , skipMember_(skip_member)
+            , fmt_(fmt)
+        {
+            if (config_gridconnect_buffer_adaptive() == CONSTANT_TRUE)
+            {
+                delayPort_.set_adaptive(
+                    USEC_TO_NSEC(config_gridconnect_buffer_delay_usec()));
+            }
+        }
+
+        /// @return true if all pending data has been flushed.
+        bool shutdown()
+        {
+            return delayPort_.shutdown();
+        }
+
+        Action entry() override
+        {
+            size_t size =
+                can_binary_encode(&message()->data()->payload(), fmt_, dbuf_);
+            if (!size)
+            {
+                return release_and_exit();
+            }
+            Buffer<HubData> *target_buffer = nullptr;
+            mainBufferPool->alloc(&target_buffer);
+            target_buffer->data()->skipMember_ = skipMember_;
+            target_buffer->data()->assign((const char *)dbuf_, size);
+            target_buffer->set_done(bn_.reset(this));
+            delayPort_.send(target_buffer, 0);
+            release();
+            return wait_and_call(STATE(buffer_accepted));
+        }
+
+        /// Called when the delay port took the record. @return next state.
+        Action buffer_accepted()
+        {
+            return exit();
+        }
+
+    private:
+        /// Assembles larger outgoing packets from the individual records by
+        /// delaying data a little bit.
+        BufferPort delayPort_;
+        /// Rendered record.
+        uint8_t dbuf_[CAN_BINARY_MAX_RECORD];
+        /// The pipe member that should be sent as "source".
+        HubPort *skipMember_;
+        /// Record format to render.
+        CanBinaryFormat fmt_;
+        /// Helper object
+        BarrierNotifiable bn_;
+    };
+
+    /// HubPort (on a string hub) that parses binary records into CAN frames,
+    /// and sends them off to the HubFlow (of CAN frame).
+    class RecordToFrameMember : public HubPort
+    {
+    public:
+        /// Constructor.
+        ///
+        /// @param service defines the executor to run on.
+        /// @param destination Where to write the parsed frames.
+        /// @param skip_member what to set skipMember_ of the outgoing packets
+        /// to.
+        /// @param fmt record format to parse.
+        RecordToFrameMember(Service *service, CanHubFlow *destination,
+            CanHubPort *skip_member, CanBinaryFormat fmt)
+            : HubPort(service)
+            , parser_(fmt)
+            , destination_(destination)
+            , skipMember_(skip_member)
+        {
+            int max_frames_to_parse =
+                config_gridconnect_bridge_max_incoming_packets();
+            if (max_frames_to_parse > 1)
+            {
+                frameAllocator_.reset(new FixedPool(
+                    sizeof(CanHubFlow::buffer_type), max_frames_to_parse));
+            }
+        }
+
+        /// @return the destination to write data to.
+        CanHubFlow *destination()
+        {
+            return destination_;
+        }
+
+        /// Takes the bytes from the incoming buffer. @return next state.
+        Action entry() override
+        {
+            inBuf_ = (const uint8_t *)message()->data()->data();
+            inBufSize_ = message()->data()->size();
+            return call_immediately(STATE(parse_more_data));
+        }
+
+        /// Finds the record boundaries in the incoming bytes. @return next
+        /// state.
+        Action parse_more_data()
+        {
+            while (inBufSize_)
+            {
+                bool complete;
+                size_t len =
+                    parser_.consume_bytes(inBuf_, inBufSize_, &complete);
+                inBuf_ += len;
+                inBufSize_ -= len;
+                if (complete)
+                {
+                    return allocate_and_call(destination_,
+                        STATE(parse_to_output_frame), frameAllocator_.get());
+                }
+            }
+            return release_and_exit();
+        }
+
+        /// Parses the completed record into the allocation result and sends
+        /// off the frame. @return next state.
+        Action parse_to_output_frame()
+        {
+            auto *b = get_allocation_result(destination_);
+            parser_.parse_frame_to_output(b->data());
+            b->data()->skipMember_ = skipMember_;
+            destination_->send(b);
+            return call_immediately(STATE(parse_more_data));
+        }
+
+    private:
+        /// Holds the partial record and finds the boundaries.
+        CanBinaryParser parser_;
+        /// The incoming bytes.
+        const uint8_t *inBuf_;
+        /// The remaining number of bytes in inBuf_.
+        size_t inBufSize_;
+        /// Allocator to get the frames from. If NULL, the target's default
+        /// buffer pool will be used.
+        std::unique_ptr<FixedPool> frameAllocator_;
+        /// Pipe to send data to.
+        CanHubFlow *destination_;
+        /// The pipe member that should be sent as "source".
+        CanHubPortInterface *skipMember_;
+    };
+
+private:
+    /// PipeMember doing the parsing.
+    RecordToFrameMember parser_;
+    /// PipeMember doing the rendering.
+    FrameToRecordMember formatter_;
+    /// Hub where parser_ is registered.
+    HubFlow *readSide_;
+    /// 1 if the flows are registered.
+    unsigned isRegistered_ : 1;
+};
+
+GCAdapterBase *create_can_binary_adapter(HubFlow *read_side,
+    HubFlow *write_side, CanHubFlow *can_side, CanBinaryFormat fmt,
+    HubPort *write_skip)
+{
+    return new CanBinaryAdapter(read_side, write_side, can_side, fmt,
+        write_skip);
+}
+
+/// Port on a CAN hub that decides between the GridConnect and the binary
+/// protocol based on the first bytes exchanged on the connection.
+///
+/// The fd is attached to rawHub_. Everything read from the fd goes to the
+/// detector, which consumes the hello (if any), then creates the bridge for
+/// the chosen protocol and forwards all further data to readHub_, where the
+/// bridge is listening. The bridge writes directly into rawHub_.
+///
+/// Sends a notification to the application level when there is an error on
+/// the device and the connection is closed.
+struct NegotiatingHubPort : public Executable
+{
+    /// How long we wait for the first bytes from the remote end before
+    /// deciding for GridConnect.
+    static constexpr long long DETECT_TIMEOUT_NSEC = MSEC_TO_NSEC(250);
+
+    /// Constructor.
+    ///
+    /// @param can_hub Parent (binary) hub flow.
+    /// @param fd device descriptor of open channel (device or socket)
+    /// @param on_exit Notifiable that will be called when the descriptor
+    /// experiences an error (typically upon device closed or connection lost).
+    /// @param use_select true if fd can be used with select, false if threads
+    /// are needed.
+    /// @param client true if we should send the hello, false if we should
+    /// answer it.
+    /// @param fmt record format to request when client is true.
+    NegotiatingHubPort(CanHubFlow *can_hub, int fd, Notifiable *on_exit,
+        bool use_select, bool client, CanBinaryFormat fmt)
+        : canHub_(can_hub)
+        , rawHub_(can_hub->service())
+        , readHub_(can_hub->service())
+        , detector_(this)
+        , timer_(this)
+        , onExit_(on_exit)
+        , fd_(fd)
+        , fmt_(fmt)
+        , client_(client)
+    {
+        LOG(VERBOSE, "negotiating port %p", (Executable *)this);
+        rawHub_.register_port(&detector_);
+        timer_.start(DETECT_TIMEOUT_NSEC);
+        if (use_select)
+        {
+#ifndef OPENMRN_FEATURE_EXECUTOR_SELECT
+            DIE("select is not supported");
+#else
+            device_.reset(new HubDeviceSelect<HubFlow>(&rawHub_, fd, this));
+#endif
+        }
+        else
+        {
+            device_.reset(new FdHubPort<HubFlow>(&rawHub_, fd, this));
+        }
+        if (config_gridconnect_port_write_queue_limit() > 0)
+        {
+            device_->set_queue_limit(
+                config_gridconnect_port_write_queue_limit(),
+                (HubQueuePolicy)config_gridconnect_port_write_queue_policy());
+        }
+        if (client_)
+        {
+            send_hello(fmt_);
+        }
+    }
+
+    /// Receives the data read from the fd.
+    class Detector : public HubPort
+    {
+    public:
+        /// Constructor. @param parent owning port.
+        Detector(NegotiatingHubPort *parent)
+            : HubPort(parent->rawHub_.service())
+            , parent_(parent)
+        {
+        }
+
+        Action entry() override
+        {
+            auto *d = message()->data();
+            if (parent_->bridgeStarted_)
+            {
+                return forward();
+            }
+            if (d->empty())
+            {
+                return release_and_exit();
+            }
+            if (helloLen_ == 0 &&
+                (uint8_t)(*d)[0] != CAN_BINARY_HELLO_START)
+            {
+                parent_->start_bridge(false, CanBinaryFormat::FIXED);
+                return forward();
+            }
+            size_t ofs = 0;
+            while (helloLen_ < CAN_BINARY_HELLO_LENGTH && ofs < d->size())
+            {
+                hello_[helloLen_++] = (*d)[ofs++];
+            }
+            if (helloLen_ < CAN_BINARY_HELLO_LENGTH)
+            {
+                return release_and_exit();
+            }
+            CanBinaryFormat fmt;
+            bool binary = can_binary_parse_hello(hello_, &fmt) &&
+                (!parent_->client_ || fmt == parent_->fmt_);
+            if (binary && !parent_->client_)
+            {
+                parent_->send_hello(fmt);
+            }
+            if (!binary)
+            {
+                LOG(WARNING, "CAN port: invalid binary hello, using "
+                             "gridconnect.");
+            }
+            parent_->start_bridge(binary, fmt);
+            d->erase(0, ofs);
+            if (d->empty())
+            {
+                return release_and_exit();
+            }
+            return forward();
+        }
+
+    private:
+        /// Sends the current message to the bridge. @return next state.
+        Action forward()
+        {
+            parent_->readHub_.send(transfer_message());
+            return exit();
+        }
+
+        /// Owning port.
+        NegotiatingHubPort *parent_;
+        /// Bytes of the hello received so far.
+        uint8_t hello_[CAN_BINARY_HELLO_LENGTH];
+        /// Number of bytes in hello_.
+        uint8_t helloLen_{0};
+    };
+
+    /// Decides for GridConnect if nothing arrives from the remote end.
+    class DetectTimer : public ::Timer
+    {
+    public:
+        /// Constructor. @param parent owning port.
+        DetectTimer(NegotiatingHubPort *parent)
+            : ::Timer(parent->rawHub_.service()->executor()->active_timers())
+            , parent_(parent)
+        {
+        }
+
+        long long timeout() override
+        {
+            parent_->timerPending_ = false;
+            if (!is_triggered() && !parent_->bridgeStarted_)
+            {
+                parent_->start_bridge(false, CanBinaryFormat::FIXED);
+            }
+            return NONE;
+        }
+
+    private:
+        /// Owning port.
+        NegotiatingHubPort *parent_;
+    };
+
+    /// Sends the hello sequence to the remote end. @param fmt is the record
+    /// format to put into the hello.
+    void send_hello(CanBinaryFormat fmt)
+    {
+        auto *b = rawHub_.alloc();
+        uint8_t hello[CAN_BINARY_HELLO_LENGTH];
+        can_binary_hello(fmt, hello);
+        b->data()->assign((const char *)hello, sizeof(hello));
+        b->data()->skipMember_ = &detector_;
+        rawHub_.send(b);
+    }
+
+    /// Creates the bridge once the protocol is known. Must be called on the
+    /// executor.
+    ///
+    /// @param binary true for the binary protocol, false for GridConnect.
+    /// @param fmt record format when binary is true.
+    void start_bridge(bool binary, CanBinaryFormat fmt)
+    {
+        bridgeStarted_ = true;
+        timer_.ensure_triggered();
+        if (shutdown_)
+        {
+            return;
+        }
+        if (binary)
+        {
+            LOG(INFO, "CAN port %d: binary protocol, format %u",
+                fd_, (unsigned)fmt);
+            bridge_.reset(create_can_binary_adapter(
+                &readHub_, &rawHub_, canHub_, fmt, &detector_));
+        }
+        else
+        {
+            LOG(INFO, "CAN port %d: gridconnect protocol", fd_);
+            bridge_.reset(GCAdapterBase::CreateGridConnectAdapter(
+                &readHub_, &rawHub_, canHub_, false, &detector_));
+        }
+    }
+
+    /** Callback in case the connection is closed due to error. */
+    void notify() override
+    {
+        /* We cannot delete *this in this callback, because we don't know
+         * what executor we are running on. */
+        rawHub_.service()->executor()->add(this);
+    }
+
+    void run() override
+    {
+        if (!shutdown_)
+        {
+            shutdown_ = true;
+            rawHub_.unregister_port(&detector_);
+        }
+        if (timerPending_)
+        {
+            timer_.ensure_triggered();
+            rawHub_.service()->executor()->add(this);
+            return;
+        }
+        if ((bridge_ && !bridge_->shutdown()) || !rawHub_.is_waiting() ||
+            !detector_.is_waiting() || !readHub_.is_waiting())
+        {
+            // Yield.
+            rawHub_.service()->executor()->add(this);
+            return;
+        }
+        LOG(INFO, "CAN port: Shutting down port %d. (%p)", fd_,
+            bridge_.get());
+        if (onExit_)
+        {
+            onExit_->notify();
+            onExit_ = nullptr;
+        }
+        delete this;
+    }
+
+    /// CAN hub we are bridging to.
+    CanHubFlow *canHub_;
+    /// Hub of the fd. Members are the device and the detector.
+    HubFlow rawHub_;
+    /// Hub carrying the data read from the fd after the detection. The only
+    /// member is the parser of the bridge.
+    HubFlow readHub_;
+    /// Consumes the hello and forwards the data read from the fd.
+    Detector detector_;
+    /// Timeout for the detection.
+    DetectTimer timer_;
+    /// Translates between the CAN hub and rawHub_ / readHub_. Null until the
+    /// protocol is decided.
+    std::unique_ptr<GCAdapterBase> bridge_;
+    /// Reads and writes the fd.
+    std::unique_ptr<FdHubPortInterface> device_;
+    /// If not null, this notifiable will be called when the device is
+    /// closed.
+    Notifiable *onExit_;
+    /// File descriptor of the device, for logging.
+    int fd_;
+    /// Record format requested in client mode.
+    CanBinaryFormat fmt_;
+    /// True if we are sending the hello.
+    bool client_;
+    /// True once the protocol is decided.
+    bool bridgeStarted_{false};
+    /// True while the timer may still call us.
+    bool timerPending_{true};
+    /// True once the port is shutting down.
+    bool shutdown_{false};
+};
+
+void create_auto_port_for_can_hub(
+    CanHubFlow *can_hub, int fd, Notifiable *on_exit, bool use_select)
+{
+    new NegotiatingHubPort(
+        can_hub, fd, on_exit, use_select, false, CanBinaryFormat::FIXED);
+}
+
+void create_binary_port_for_can_hub(CanHubFlow *can_hub, int fd,
+    CanBinaryFormat fmt, Notifiable *on_exit, bool use_select)
+{
+    new NegotiatingHubPort(can_hub, fd, on_exit, use_select, true, fmt);
+}
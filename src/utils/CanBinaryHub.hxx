@@ -0,0 +1,195 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file CanBinaryHub.hxx
+ *
+ * Binary CAN-over-TCP framing, negotiated per connection alongside
+ * GridConnect.
+ *
+ * @author Balazs Racz
+ * @date 16 October 2026
+ */
+
+#ifndef _UTILS_CANBINARYHUB_HXX_
+#define _UTILS_CANBINARYHUB_HXX_
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "utils/Hub.hxx"
+
+class GCAdapterBase;
+
+/// Record formats of the binary CAN-over-TCP protocol.
+///
+/// Every record starts with a 5-byte header: one info byte (bit 7: extended
+/// frame, bit 6: remote frame, bits 5..4: zero, bits 3..0: data length
+/// code), then the 29- or 11-bit identifier in four bytes, big-endian. The
+/// header is followed by the payload.
+///
+/// A binary connection starts with the client sending the 4-byte hello
+/// {0xFF, 'C', 'B', format}; the server answers with the same four bytes.
+/// GridConnect traffic can never start with 0xFF, which makes the two
+/// protocols distinguishable on the first byte.
+enum class CanBinaryFormat : uint8_t
+{
+    /// 13-byte records: the payload is always 8 bytes, zero-padded.
+    FIXED = 1,
+    /// 5 + dlc byte records: only the used payload bytes are sent.
+    COMPACT = 2,
+};
+
+/// Longest record in any of the binary formats.
+static constexpr unsigned CAN_BINARY_MAX_RECORD = 13;
+/// Length of the hello sequence starting a binary connection.
+static constexpr unsigned CAN_BINARY_HELLO_LENGTH = 4;
+/// First byte of the hello sequence.
+static constexpr uint8_t CAN_BINARY_HELLO_START = 0xFF;
+
+/** Renders a CAN frame in the binary protocol.
+ *
+ * @param frame is the CAN frame to render.
+ * @param fmt is the record format to use.
+ * @param out is the output buffer, must have room for CAN_BINARY_MAX_RECORD
+ * bytes.
+ * @return the number of bytes written, 0 for error frames (which are not
+ * sent). */
+size_t can_binary_encode(
+    const struct can_frame *frame, CanBinaryFormat fmt, uint8_t *out);
+
+/** Fills in the hello sequence of a binary connection.
+ *
+ * @param fmt is the record format to request.
+ * @param out is the output buffer, CAN_BINARY_HELLO_LENGTH bytes long. */
+void can_binary_hello(CanBinaryFormat fmt, uint8_t *out);
+
+/** Checks a hello sequence of a binary connection.
+ *
+ * @param data is the received hello, CAN_BINARY_HELLO_LENGTH bytes long.
+ * @param fmt will be set to the requested record format.
+ * @return true if data is a valid hello. */
+bool can_binary_parse_hello(const uint8_t *data, CanBinaryFormat *fmt);
+
+/**
+   Finds record boundaries in a stream of binary CAN protocol bytes. Contains
+   an internal buffer holding the partial (or last found) record.
+
+   This class is not thread-safe, but thread-compatible.
+ */
+class CanBinaryParser
+{
+public:
+    /// Constructor. @param fmt is the record format of the stream.
+    CanBinaryParser(CanBinaryFormat fmt)
+        : fmt_(fmt)
+    {
+    }
+
+    /** Adds a sequence of bytes from the source stream. Stops after the first
+     * complete record.
+     * @param data is the next bytes from the source stream.
+     * @param len is the number of bytes in data.
+     * @param complete will be set to true if the internal buffer contains a
+     * complete record.
+     * @return the number of bytes consumed. */
+    size_t consume_bytes(const uint8_t *data, size_t len, bool *complete);
+
+    /** Parses the current record to a can_frame struct. Should be called if
+     * and only if the previous consume_bytes call set complete to true.
+     *
+     * @param output_frame is an output argument, non-NULL, into this we will
+     * be writing the binary frame. */
+    void parse_frame_to_output(struct can_frame *output_frame);
+
+private:
+    /// @return the length of the record whose header is in rbuf_.
+    unsigned record_length();
+
+    /// Record format of the stream.
+    CanBinaryFormat fmt_;
+    /// Number of bytes in rbuf_.
+    uint8_t offset_{0};
+    /// Collects the bytes of a partial record.
+    uint8_t rbuf_[CAN_BINARY_MAX_RECORD];
+};
+
+/** Creates a bridge between a string-typed Hub carrying the binary CAN
+ * protocol and a CAN hub. This is the binary counterpart of
+ * GCAdapterBase::CreateGridConnectAdapter().
+ *
+ * @param read_side is the Hub that the binary traffic is read from, to be
+ * parsed and sent to can_side.
+ * @param write_side is the Hub that the rendered binary traffic is written
+ * to.
+ * @param can_side the hub (of type struct can_frame) to bridge to.
+ * @param fmt is the record format of the binary stream.
+ * @param write_skip if not null, the rendered binary traffic will not be
+ * delivered to this member of write_side.
+ * @return a pointer to the created object. It can be deleted, which will
+ * terminate the link and unregister the link members from all hubs. */
+GCAdapterBase *create_can_binary_adapter(HubFlow *read_side,
+    HubFlow *write_side, CanHubFlow *can_side, CanBinaryFormat fmt,
+    HubPort *write_skip = nullptr);
+
+/** Adds a new port to a CAN hub that talks either GridConnect or the binary
+ * protocol, as chosen by the remote end. If the first bytes received are a
+ * binary hello, the hello is answered and the binary protocol is used;
+ * otherwise (including when the remote end sends nothing for a short time
+ * after connecting) the port is GridConnect. Suitable for the server side of
+ * TCP connections.
+ *
+ * The port is attached to the CAN hub only once the protocol is decided.
+ * CAN traffic before that (up to 250 msec for a remote end that does not
+ * send anything) is not delivered to this port.
+ *
+ * @param can_hub is the CAN hub to connect the port to.
+ * @param fd is the file descriptor to read/write data from/to.
+ * @param on_exit is a notifiable (may be null) which will be called in case
+ * an error is encountered on this port and the port is subsequently closed.
+ * @param use_select when true, the FD will be used with select, when false,
+ * separate threads will be started with blocking read and write calls. */
+void create_auto_port_for_can_hub(CanHubFlow *can_hub, int fd,
+    Notifiable *on_exit = nullptr, bool use_select = false);
+
+/** Adds a new port to a CAN hub that talks the binary protocol. Sends the
+ * hello and expects it to be answered with the same format. If the remote
+ * end answers anything else, or nothing within a short time, the port falls
+ * back to GridConnect, so that servers that do not know the binary protocol
+ * still work. Suitable for the client side of TCP connections to a server
+ * using create_auto_port_for_can_hub().
+ *
+ * @param can_hub is the CAN hub to connect the port to.
+ * @param fd is the file descriptor to read/write data from/to.
+ * @param fmt is the record format to request.
+ * @param on_exit is a notifiable (may be null) which will be called in case
+ * an error is encountered on this port and the port is subsequently closed.
+ * @param use_select when true, the FD will be used with select, when false,
+ * separate threads will be started with blocking read and write calls. */
+void create_binary_port_for_can_hub(CanHubFlow *can_hub, int fd,
+    CanBinaryFormat fmt, Notifiable *on_exit = nullptr,
+    bool use_select = false);
+
+#endif // _UTILS_CANBINARYHUB_HXX_
@@ -0,0 +1,146 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file ExecutorStatsLogger.hxx
+ *
+ * State flow that periodically prints the per-Executable statistics of an
+ * executor to the log.
+ *
+ * @author Balazs Racz
+ * @date 16 October 2026
+ */
+
+#ifndef _UTILS_EXECUTORSTATSLOGGER_HXX_
+#define _UTILS_EXECUTORSTATSLOGGER_HXX_
+
+#include "executor/StateFlow.hxx"
+#include "utils/logging.h"
+
+#if OPENMRN_FEATURE_EXECUTOR_STATS
+
+/// Prints the executables that used the most CPU time on a given executor
+/// every few seconds. Requires OPENMRN_FEATURE_EXECUTOR_STATS.
+///
+/// Each line shows the executable pointer, the run count, the total, average
+/// and maximum run time, and the average and maximum queue wait time. The
+/// statistics are cleared after each dump, so every dump covers one period.
+class ExecutorStatsLogger : public StateFlowBase
+{
+public:
+    /// Constructor.
+    ///
+    /// @param service Service specifying which thread to run this stateflow
+    /// on.
+    /// @param target executor whose statistics to print. May be the same as
+    /// the executor of service.
+    /// @param period_nsec how often to print.
+    /// @param top_n how many executables to print (the rest are summed up).
+    ExecutorStatsLogger(Service *service, ExecutorBase *target,
+        long long period_nsec = SEC_TO_NSEC(10), unsigned top_n = 8)
+        : StateFlowBase(service)
+        , target_(target)
+        , periodNsec_(period_nsec)
+        , topN_(top_n)
+    {
+        start_flow(STATE(delay));
+    }
+
+private:
+    /// Wait for the next dump. @return action.
+    Action delay()
+    {
+        return sleep_and_call(&timer_, periodNsec_, STATE(dump));
+    }
+
+    /// Print the statistics. @return action.
+    Action dump()
+    {
+        unsigned n = target_->stats()->snapshot(snapshot_);
+        target_->stats()->clear();
+        // The last entry is the overflow.
+        ExecutorStats::Entry rest = snapshot_[--n];
+        // Selection sort of the top entries by total run time.
+        unsigned shown = std::min(n, topN_);
+        for (unsigned i = 0; i < shown; ++i)
+        {
+            unsigned best = i;
+            for (unsigned j = i + 1; j < n; ++j)
+            {
+                if (snapshot_[j].totalRunNsec > snapshot_[best].totalRunNsec)
+                {
+                    best = j;
+                }
+            }
+            std::swap(snapshot_[i], snapshot_[best]);
+            print(snapshot_[i]);
+        }
+        for (unsigned i = shown; i < n; ++i)
+        {
+            rest.runCount += snapshot_[i].runCount;
+            rest.totalRunNsec += snapshot_[i].totalRunNsec;
+            rest.totalWaitNsec += snapshot_[i].totalWaitNsec;
+            rest.maxRunNsec = std::max(rest.maxRunNsec, snapshot_[i].maxRunNsec);
+            rest.maxWaitNsec =
+                std::max(rest.maxWaitNsec, snapshot_[i].maxWaitNsec);
+        }
+        if (rest.runCount)
+        {
+            rest.executable = nullptr;
+            print(rest);
+        }
+        return call_immediately(STATE(delay));
+    }
+
+    /// Prints one line to the log. @param e the entry to print.
+    void print(const ExecutorStats::Entry &e)
+    {
+        unsigned cnt = e.runCount ? e.runCount : 1;
+        LOG(INFO,
+            "exec %p: runs %u, run total %u usec avg %u max %u usec, wait avg "
+            "%u max %u usec",
+            e.executable, (unsigned)e.runCount,
+            (unsigned)(e.totalRunNsec / 1000),
+            (unsigned)(e.totalRunNsec / cnt / 1000),
+            (unsigned)(e.maxRunNsec / 1000),
+            (unsigned)(e.totalWaitNsec / cnt / 1000),
+            (unsigned)(e.maxWaitNsec / 1000));
+    }
+
+    /// Helper struct for timer state.
+    StateFlowTimer timer_ {this};
+    /// Executor whose statistics we print.
+    ExecutorBase *target_;
+    /// How often to print.
+    long long periodNsec_;
+    /// How many executables to print separately.
+    unsigned topN_;
+    /// Copy of the statistics table.
+    ExecutorStats::Entry snapshot_[ExecutorStats::TABLE_SIZE + 1];
+};
+
+#endif // OPENMRN_FEATURE_EXECUTOR_STATS
+
+#endif // _UTILS_EXECUTORSTATSLOGGER_HXX_
@@ -37,6 +37,8 @@
 #include "utils/GcStreamParser.hxx"
 #include "utils/gc_format.h"
 
+#include <string.h>
+
 bool GcStreamParser::consume_byte(char c)
 {
     if (c == ':')
@@ -75,6 +77,62 @@ bool GcStreamParser::consume_byte(char c)
     return false;
 }
 
+size_t GcStreamParser::consume_bytes(
+    const char *data, size_t len, bool *complete)
+{
+    const char *p = data;
+    const char *end = data + len;
+    *complete = false;
+    while (p < end)
+    {
+        if (offset_ < 0)
+        {
+            // Drops bytes to the floor until the next frame start.
+            p = static_cast<const char *>(memchr(p, ':', end - p));
+            if (!p)
+            {
+                return len;
+            }
+            offset_ = 0;
+            ++p;
+            continue;
+        }
+        const char *q = p;
+        while (q < end && *q != ';' && *q != ':')
+        {
+            ++q;
+        }
+        size_t room = sizeof(cbuf_) - 1 - offset_;
+        if (static_cast<size_t>(q - p) > room)
+        {
+            // We overran the buffer, so this can't be a valid frame.
+            // Reset and look for sync byte again.
+            p += room + 1;
+            offset_ = -1;
+            continue;
+        }
+        memcpy(cbuf_ + offset_, p, q - p);
+        offset_ += q - p;
+        p = q;
+        if (p == end)
+        {
+            break;
+        }
+        if (*p++ == ':')
+        {
+            // Frame is starting here.
+            offset_ = 0;
+            continue;
+        }
+        // Frame ends here.
+        cbuf_[offset_] = 0;
+        offset_ = -1;
+        *complete = true;
+        break;
+    }
+    return p - data;
+}
+
 void GcStreamParser::frame_buffer(std::string* payload) {
     if (offset_ >= 0) {
         payload->assign(cbuf_, offset_);
@@ -56,6 +56,16 @@ public:
      * internal buffer contains a complete frame. @param c next character. */
     bool consume_byte(char c);
 
+    /** Adds a sequence of characters from the source stream. Stops after the
+     * first complete frame. Equivalent to calling consume_byte for each
+     * character until it returns true.
+     * @param data is the next characters from the source stream.
+     * @param len is the number of characters in data.
+     * @param complete will be set to true if the internal buffer contains a
+     * complete frame.
+     * @return the number of characters consumed. */
+    size_t consume_bytes(const char *data, size_t len, bool *complete);
+
     /** Parses the current contents of the frame buffer to a can_frame
      * struct. Should be called if and inly if the previous consume_char call
      * returned true.
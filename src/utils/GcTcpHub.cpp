@@ -36,6 +36,7 @@
 #include "utils/GcTcpHub.hxx"
 
 #include "nmranet_config.h"
+#include "utils/CanBinaryHub.hxx"
 #include "utils/GridConnectHub.hxx"
 
 void GcTcpHub::on_new_connection(int fd)
@@ -46,7 +47,14 @@ void GcTcpHub::on_new_connection(int fd)
         AtomicHolder h(this);
         numClients_++;
     }
-    create_gc_port_for_can_hub(canHub_, fd, this, use_select);
+    if (acceptBinary_)
+    {
+        create_auto_port_for_can_hub(canHub_, fd, this, use_select);
+    }
+    else
+    {
+        create_gc_port_for_can_hub(canHub_, fd, this, use_select);
+    }
 }
 
 void GcTcpHub::notify()
@@ -58,8 +66,9 @@ void GcTcpHub::notify()
     }
 }
 
-GcTcpHub::GcTcpHub(CanHubFlow *can_hub, int port)
+GcTcpHub::GcTcpHub(CanHubFlow *can_hub, int port, bool accept_binary)
     : canHub_(can_hub)
+    , acceptBinary_(accept_binary)
     , tcpListener_(port,
           std::bind(&GcTcpHub::on_new_connection, this, std::placeholders::_1),
           "GcTcpHub")
@@ -51,7 +51,13 @@ public:
     /// @param can_hub Which CAN-hub should we attach the TCP gridconnect hub
     /// onto.
     /// @param port TCp port number to listen on.
-    GcTcpHub(CanHubFlow *can_hub, int port);
+    /// @param accept_binary if true, clients may switch the connection to
+    /// the binary CAN protocol (see CanBinaryHub.hxx) by sending its hello.
+    /// Then a new connection is not attached to the CAN hub until the
+    /// protocol is decided, which for a client that does not send anything
+    /// takes 250 msec. CAN traffic in this window is not delivered to that
+    /// client.
+    GcTcpHub(CanHubFlow *can_hub, int port, bool accept_binary = false);
     ~GcTcpHub();
 
     /// @return true of the listener is ready to accept incoming connections.
@@ -82,6 +88,8 @@ private:
     CanHubFlow *canHub_;
     /// How many clients are connected right now.
     unsigned numClients_ {0};
+    /// True if the clients may negotiate the binary protocol.
+    bool acceptBinary_;
     /// Helper object representing the listening on the socket.
     SocketListener tcpListener_;
 };
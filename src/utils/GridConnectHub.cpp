@@ -64,9 +64,10 @@ public:
     GCAdapter(HubFlow *gc_side, CanHubFlow *can_side, bool double_bytes)
         : parser_(can_side->service(), can_side, &formatter_)
         , formatter_(can_side->service(), gc_side, &parser_, double_bytes)
+        , readSide_(gc_side)
     {
         gc_side->register_port(&parser_);
-        can_side->register_port(&formatter_);
+        can_side->register_shared_port(&formatter_);
         isRegistered_ = 1;
     }
 
@@ -79,13 +80,17 @@ public:
     /// @param can_side  A hub of type struct can_frame, the binary side.
     /// @param double_bytes  if true, upon rendering data each byte will be
     /// doubled. This is an anciant workaround.
+    /// @param write_skip_member if not null, the rendered packets will not be
+    /// delivered to this member of gc_side_write.
     GCAdapter(HubFlow *gc_side_read, HubFlow *gc_side_write,
-        CanHubFlow *can_side, bool double_bytes)
+        CanHubFlow *can_side, bool double_bytes, HubPort *write_skip_member)
         : parser_(can_side->service(), can_side, &formatter_)
-        , formatter_(can_side->service(), gc_side_write, &parser_, double_bytes)
+        , formatter_(can_side->service(), gc_side_write,
+              write_skip_member ? write_skip_member : &parser_, double_bytes)
+        , readSide_(gc_side_read)
     {
         gc_side_read->register_port(&parser_);
-        can_side->register_port(&formatter_);
+        can_side->register_shared_port(&formatter_);
         isRegistered_ = 1;
     }
 
@@ -99,9 +104,7 @@ public:
         if (isRegistered_)
         {
             parser_.destination()->unregister_port(&formatter_);
-            /// @todo(balazs.racz) This is incorrect if the 3-pipe constructor
-            /// is used.
-            formatter_.destination()->unregister_port(&parser_);
+            readSide_->unregister_port(&parser_);
             isRegistered_ = 0;
         }
     }
@@ -135,6 +138,11 @@ public:
             , skipMember_(skip_member)
             , double_bytes_(double_bytes)
         {
+            if (config_gridconnect_buffer_adaptive() == CONSTANT_TRUE)
+            {
+                delayPort_.set_adaptive(
+                    USEC_TO_NSEC(config_gridconnect_buffer_delay_usec()));
+            }
         }
 
         /// @return where to write the packets to.
@@ -149,10 +157,10 @@ public:
         
         Action entry() override
         {
+            const can_frame &frame = message()->data()->payload();
             LOG(VERBOSE, "can packet arrived: %" PRIx32,
-                GET_CAN_FRAME_ID_EFF(*message()->data()));
-            char *end =
-                gc_format_generate(message()->data(), dbuf_, double_bytes_);
+                GET_CAN_FRAME_ID_EFF(frame));
+            char *end = gc_format_generate(&frame, dbuf_, double_bytes_);
             size_t size = (end - dbuf_);
             if (size)
             {
@@ -241,10 +249,14 @@ public:
         /// frames. @return next state.
         Action parse_more_data()
         {
-            while (inBufSize_--)
+            while (inBufSize_)
             {
-                char c = *inBuf_++;
-                if (streamSegmenter_.consume_byte(c))
+                bool complete;
+                size_t len = streamSegmenter_.consume_bytes(
+                    inBuf_, inBufSize_, &complete);
+                inBuf_ += len;
+                inBufSize_ -= len;
+                if (complete)
                 {
                     // End of frame. Allocate an output buffer and parse the
                     // frame.
@@ -300,6 +312,8 @@ private:
     GCToBinaryMember parser_;
     /// PipeMember doing the formatting.
     BinaryToGCMember formatter_;
+    /// Hub where parser_ is registered.
+    HubFlow *readSide_;
     /// 1 if the flows are registered.
     unsigned isRegistered_ : 1;
 };
@@ -314,9 +328,11 @@ GCAdapterBase *GCAdapterBase::CreateGridConnectAdapter(HubFlow *gc_side,
 GCAdapterBase *GCAdapterBase::CreateGridConnectAdapter(HubFlow *gc_side_read,
                                                        HubFlow *gc_side_write,
                                                        CanHubFlow *can_side,
-                                                       bool double_bytes)
+                                                       bool double_bytes,
+                                                       HubPort *write_skip)
 {
-    return new GCAdapter(gc_side_read, gc_side_write, can_side, double_bytes);
+    return new GCAdapter(
+        gc_side_read, gc_side_write, can_side, double_bytes, write_skip);
 }
 
 /// Implementation for the gridconnect bridge. Owns all necessary structures,
@@ -414,6 +430,12 @@ struct GcHubPort : public Executable
         } else {
             gcWrite_.reset(new FdHubPort<HubFlow>(&gcHub_, fd, this));
         }
+        if (config_gridconnect_port_write_queue_limit() > 0)
+        {
+            gcWrite_->set_queue_limit(
+                config_gridconnect_port_write_queue_limit(),
+                (HubQueuePolicy)config_gridconnect_port_write_queue_policy());
+        }
     }
     virtual ~GcHubPort()
     {
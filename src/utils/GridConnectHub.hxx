@@ -95,12 +95,15 @@ public:
     /// is done via.
     /// @param double_bytes  if true, any frame rendered into the GC protocol
     ///   will have their characters doubled.
+    /// @param write_skip if not null, the rendered GridConnect packets will
+    ///   not be delivered to this member of gc_side_write.
     ///
     /// @return a pointer to the created object. It can be deleted, which will
     ///   terminate the link and unregister the link members from both pipes.
     ///
     static GCAdapterBase *CreateGridConnectAdapter(HubFlow *gc_side_read,
-        HubFlow *gc_side_write, CanHubFlow *can_side, bool double_bytes);
+        HubFlow *gc_side_write, CanHubFlow *can_side, bool double_bytes,
+        HubPort *write_skip = nullptr);
 };
 
 /** Create this port for a CAN hub and all packets will be written to stdout in
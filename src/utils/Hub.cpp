@@ -0,0 +1,140 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file Hub.cpp
+ *
+ * Classification of hub traffic for the queue limits of hub ports.
+ *
+ * @author Balazs Racz
+ * @date 16 October 2026
+ */
+
+#include "utils/Hub.hxx"
+
+#include <string.h>
+
+/// @return true if a 29-bit CAN identifier is an OpenLCB message frame
+/// (global or addressed) whose MTI has the event-present bit set. @param id
+/// is the CAN identifier.
+static bool is_event_can_id(uint32_t id)
+{
+    // Bit 27: OpenLCB message; bits 26..24: frame type 1 (global or
+    // addressed message); bits 23..12: MTI, where 0x004 is the event
+    // present bit.
+    return (id & 0x0F000000) == 0x09000000 && (id & (0x004 << 12));
+}
+
+/// @return the value of a hex digit, or -1 if c is not one. @param c is the
+/// character to convert.
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9')
+    {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F')
+    {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f')
+    {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+bool hub_is_event_traffic(const HubData &msg)
+{
+    const string &data = msg.payload();
+    const char *p = data.data();
+    const char *end = p + data.size();
+    bool found = false;
+    while ((p = static_cast<const char *>(memchr(p, ':', end - p))))
+    {
+        // Every frame has to be an extended frame ":X" + 8 hex digits with
+        // an event MTI.
+        if (end - p < 10 || p[1] != 'X')
+        {
+            return false;
+        }
+        uint32_t id = 0;
+        for (int i = 2; i < 10; ++i)
+        {
+            int v = hex_value(p[i]);
+            if (v < 0)
+            {
+                return false;
+            }
+            id = (id << 4) | v;
+        }
+        if (!is_event_can_id(id))
+        {
+            return false;
+        }
+        found = true;
+        p += 10;
+    }
+    return found;
+}
+
+bool hub_is_event_traffic(const CanHubData &msg)
+{
+    const can_frame &data = msg.payload();
+    return IS_CAN_FRAME_EFF(data) && !IS_CAN_FRAME_ERR(data) &&
+        !IS_CAN_FRAME_RTR(data) && is_event_can_id(GET_CAN_FRAME_ID_EFF(data));
+}
+
+unsigned hub_priority_band(const CanHubData &msg)
+{
+    const can_frame &data = msg.payload();
+    if (!IS_CAN_FRAME_EFF(data) || IS_CAN_FRAME_ERR(data) ||
+        IS_CAN_FRAME_RTR(data))
+    {
+        return CAN_BAND_NORMAL;
+    }
+    uint32_t id = GET_CAN_FRAME_ID_EFF(data);
+    if (!(id & 0x08000000))
+    {
+        // Bit 27 clear: CAN control frame.
+        return CAN_BAND_CONTROL;
+    }
+    if ((id & 0x07000000) != 0x01000000)
+    {
+        // Datagram, stream and reserved frame types.
+        return CAN_BAND_BULK;
+    }
+    // Bits 11..10 of the MTI (bits 23..22 of the identifier) are the message
+    // priority.
+    switch ((id >> 22) & 3)
+    {
+        case 0:
+            return CAN_BAND_URGENT;
+        case 1:
+            return CAN_BAND_NORMAL;
+        default:
+            return CAN_BAND_BULK;
+    }
+}
@@ -34,6 +34,7 @@
 #ifndef _UTILS_HUB_HXX_
 #define _UTILS_HUB_HXX_
 
+#include <atomic>
 #include <stdint.h>
 #include <string>
 
@@ -53,7 +54,7 @@ public:
 
     /// @return the contained data as a const void pointer.
     const void* data() const {
-        return &value();
+        return static_cast<const S *>(this);
     }
 
     /// @return the contained data as a void pointer.
@@ -62,7 +63,7 @@ public:
     }
 
     /// @return the size of the contained structure.
-    size_t size() {
+    size_t size() const {
         return sizeof(S);
     }
 };
@@ -101,9 +102,57 @@ template <class T> class HubContainer : public T
 {
 public:
     // typedef FlowInterface<Buffer<HubContainer<T>>> HubMember;
-    HubContainer() : skipMember_(0)
+    HubContainer() : skipMember_(0), shared_(nullptr)
+    {
+    }
+
+    /// Copy constructor. Copies the payload, even if o refers to a shared
+    /// payload. @param o is the object to copy.
+    HubContainer(const HubContainer &o)
+        : T(o.payload())
+        , skipMember_(o.skipMember_)
+        , shared_(nullptr)
+    {
+    }
+
+    /// Assignment operator. Copies the payload, even if o refers to a shared
+    /// payload. @param o is the object to copy. @return *this.
+    HubContainer &operator=(const HubContainer &o)
+    {
+        if (this != &o)
+        {
+            T::operator=(o.payload());
+            skipMember_ = o.skipMember_;
+            release_shared();
+        }
+        return *this;
+    }
+
+    ~HubContainer()
+    {
+        release_shared();
+    }
+
+    /// @return the payload of this message. This is either *this, or the
+    /// payload of the buffer that was shared with @ref share. Ports that
+    /// are registered with GenericHubFlow::register_shared_port must read
+    /// the payload through this function.
+    const T &payload() const
     {
+        return shared_ ? *shared_->data() : *this;
     }
+
+    /// Makes this message refer to the payload of another buffer instead of
+    /// carrying a copy of it. Takes a reference on that buffer until *this
+    /// is destroyed. The shared payload must not be modified anymore. @param
+    /// b is the buffer whose payload to share.
+    void share(Buffer<HubContainer<T>> *b)
+    {
+        release_shared();
+        HubContainer<T> *root = b->data();
+        shared_ = root->shared_ ? root->shared_->ref() : b->ref();
+    }
+
     /// The type of the identified of these object in the HUB.
     typedef uintptr_t id_type;
     /// Defines which registered member of the hub should be skipped when the
@@ -114,6 +163,20 @@ public:
     {
         return reinterpret_cast<uintptr_t>(skipMember_);
     }
+
+private:
+    /// Drops the reference to the shared payload, if any.
+    void release_shared()
+    {
+        if (shared_)
+        {
+            shared_->unref();
+            shared_ = nullptr;
+        }
+    }
+
+    /// If not null, the payload is in this buffer (and *this is empty).
+    Buffer<HubContainer<T>> *shared_;
 };
 
 /** This class can be sent via a Buffer to a hub.
@@ -145,8 +208,339 @@ typedef StateFlow<Buffer<CanHubData>, QList<1>> CanHubPort;
 /// This should work for both 32 and 64-bit architectures.
 static const uintptr_t POINTER_MASK = UINTPTR_MAX;
 
+/// What a LimitedHubPort does when a buffer arrives and its queue is full.
+enum class HubQueuePolicy : uint8_t
+{
+    /// The oldest queued buffer is dropped.
+    DROP_OLDEST = 1,
+    /// The oldest event traffic buffer (queued or arriving) is dropped. Other
+    /// traffic is dropped (oldest first) only when there is no event traffic
+    /// to drop.
+    DROP_EVENTS_FIRST = 2,
+    /// The arriving buffer is dropped and the port is closed, as if the
+    /// device had an error.
+    DISCONNECT = 3,
+};
+
+/// Counters of the queue of a LimitedHubPort.
+struct HubQueueStats
+{
+    /// Number of buffers currently waiting in the queue.
+    size_t queued{0};
+    /// Largest number of buffers that were waiting in the queue at the same
+    /// time.
+    size_t highWater{0};
+    /// Number of buffers dropped because the queue was full.
+    size_t dropped{0};
+    /// True if the port was closed because the queue was full.
+    bool overflowed{false};
+};
+
+/// Default classification for HubQueuePolicy::DROP_EVENTS_FIRST: buffers of
+/// unknown hub types are never event traffic. @return false.
+template <class D> bool hub_is_event_traffic(const D &)
+{
+    return false;
+}
+
+/// @return true if every frame of a buffer of GridConnect text is an OpenLCB
+/// message carrying an event ID. @param data is the buffer to classify.
+bool hub_is_event_traffic(const HubData &data);
+
+/// @return true if the CAN frame is an OpenLCB message carrying an event
+/// ID. @param data is the frame to classify.
+bool hub_is_event_traffic(const CanHubData &data);
+
+/// Delivery bands of a CAN hub, from the most to the least urgent. Frames
+/// that the OpenLCB protocols need to see in order (datagram and stream
+/// frames with their acknowledgements) are all in the same band.
+enum HubCanBand : unsigned
+{
+    /// CAN control frames (alias allocation and mapping: CID, RID, AMD, AME,
+    /// AMR).
+    CAN_BAND_CONTROL = 0,
+    /// OpenLCB messages with MTI priority 0 (e.g. initialization complete,
+    /// traction control replies).
+    CAN_BAND_URGENT = 1,
+    /// OpenLCB messages with MTI priority 1 (e.g. event reports, traction
+    /// control commands) and frames that are not OpenLCB frames.
+    CAN_BAND_NORMAL = 2,
+    /// OpenLCB messages with MTI priority 2 or 3, datagram and stream frames.
+    CAN_BAND_BULK = 3,
+    /// Number of bands.
+    CAN_HUB_NUM_BANDS = 4,
+};
+
+/// Default classification for hub priority scheduling: buffers of unknown
+/// hub types all go to the first band. @return 0.
+template <class D> unsigned hub_priority_band(const D &)
+{
+    return 0;
+}
+
+/// @return the HubCanBand of a CAN frame, decoded from the frame type and
+/// the MTI in the CAN identifier. @param data is the frame to classify.
+unsigned hub_priority_band(const CanHubData &data);
+
+/// Counters of one priority band of a hub.
+struct HubBandStats
+{
+    /// Number of buffers dispatched from this band.
+    size_t frames{0};
+    /// Number of buffers dispatched from this band ahead of buffers of more
+    /// urgent bands, because this band was waiting for too long.
+    size_t promoted{0};
+    /// Number of buffers whose time spent in the queue was measured.
+    size_t samples{0};
+    /// Sum of the measured times in the queue, in nanoseconds.
+    long long totalLatency{0};
+    /// Largest measured time in the queue, in nanoseconds.
+    long long maxLatency{0};
+};
+
+/// Counters of the fan-out of a hub: how the messages were sent to the ports
+/// other than the last one (which receives the original buffer).
+struct HubFanoutStats
+{
+    /// Number of times a port received a private copy of a message.
+    size_t copiesMade{0};
+    /// Number of times a shared port received a handle to the payload
+    /// instead of a copy.
+    size_t copiesSaved{0};
+};
+
+/// Hub port with a bounded queue. Ports that write to a device (which may be
+/// arbitrarily slow, such as a TCP client) derive from this class so that
+/// the queue can not grow without limit. The limit is off by default.
+template <class D> class LimitedHubPort : public StateFlow<Buffer<D>, QList<1>>
+{
+public:
+    /// Base class type.
+    typedef StateFlow<Buffer<D>, QList<1>> Base;
+    /// Buffer type.
+    typedef Buffer<D> buffer_type;
+
+    /// Constructor. @param service defines the executor to run on.
+    LimitedHubPort(Service *service)
+        : Base(service)
+        , closed_(0)
+    {
+    }
+
+    /// Sets the queue limit. Thread-safe.
+    ///
+    /// @param max_queued is the maximum number of buffers waiting in the
+    /// queue (not counting the one being processed). 0 for no limit.
+    /// @param policy defines what happens when a buffer arrives and the queue
+    /// is full.
+    void set_queue_limit(size_t max_queued, HubQueuePolicy policy)
+    {
+        AtomicHolder h(this);
+        maxQueued_ = max_queued;
+        if (policy == policy_)
+        {
+            return;
+        }
+        policy_ = policy;
+        eventsQueued_ = 0;
+        if (policy == HubQueuePolicy::DROP_EVENTS_FIRST)
+        {
+            // Counts the event traffic already in the queue. The predicate
+            // never matches, so nothing is removed.
+            unsigned prio;
+            size_t *count = &eventsQueued_;
+            this->queue_remove_first(
+                [count](QMember *m) {
+                    if (hub_is_event_traffic(
+                            *static_cast<buffer_type *>(m)->data()))
+                    {
+                        ++*count;
+                    }
+                    return false;
+                },
+                &prio);
+        }
+    }
+
+    /// @return the counters of the queue. Thread-safe.
+    HubQueueStats queue_stats()
+    {
+        AtomicHolder h(this);
+        return stats_;
+    }
+
+    /// Turns off the limit. Must be called before sending a buffer to the
+    /// queue that must not be dropped (such as a shutdown marker).
+    void close_queue()
+    {
+        AtomicHolder h(this);
+        closed_ = 1;
+    }
+
+    /// Enqueues a buffer, enforcing the queue limit.
+    ///
+    /// @param msg is the buffer to enqueue.
+    /// @param priority is the priority of the buffer.
+    void send(buffer_type *msg, unsigned priority = UINT_MAX) override
+    {
+        // Classifies the buffer before taking the lock.
+        HubQueuePolicy policy = policy_.load(std::memory_order_relaxed);
+        bool is_event = policy == HubQueuePolicy::DROP_EVENTS_FIRST &&
+            hub_is_event_traffic(*msg->data());
+        buffer_type *drop = nullptr;
+        bool overflow = false;
+        {
+            AtomicHolder h(this);
+            if (policy_ != policy)
+            {
+                // Raced with set_queue_limit().
+                is_event = policy_ == HubQueuePolicy::DROP_EVENTS_FIRST &&
+                    hub_is_event_traffic(*msg->data());
+            }
+            if (maxQueued_ && stats_.queued >= maxQueued_ && !closed_)
+            {
+                drop = select_drop(msg, is_event, &overflow);
+                ++stats_.dropped;
+            }
+            if (drop != msg)
+            {
+                Base::send(msg, priority);
+                if (is_event)
+                {
+                    ++eventsQueued_;
+                }
+                if (++stats_.queued > stats_.highWater)
+                {
+                    stats_.highWater = stats_.queued;
+                }
+            }
+        }
+        if (drop)
+        {
+            drop->unref();
+        }
+        if (overflow)
+        {
+            queue_overflow();
+        }
+    }
+
+protected:
+    /// Takes the front entry of the queue. Must be called with the lock
+    /// held. @param priority will be set to the priority of the entry.
+    /// @return the entry, or nullptr if the queue is empty.
+    QMember *queue_next(unsigned *priority) override
+    {
+        QMember *m = Base::queue_next(priority);
+        if (m)
+        {
+            --stats_.queued;
+            if (eventsQueued_ &&
+                policy_ == HubQueuePolicy::DROP_EVENTS_FIRST &&
+                hub_is_event_traffic(*static_cast<buffer_type *>(m)->data()))
+            {
+                --eventsQueued_;
+            }
+        }
+        return m;
+    }
+
+    /// Called when a buffer arrives with the queue full and the policy is
+    /// HubQueuePolicy::DISCONNECT. Called on the thread sending the buffer,
+    /// without holding the lock. The implementation should close the
+    /// device.
+    virtual void queue_overflow()
+    {
+    }
+
+private:
+    /// Picks the buffer to drop when the queue is full. Called with the lock
+    /// held.
+    ///
+    /// @param msg is the arriving buffer.
+    /// @param is_event true if msg is event traffic.
+    /// @param overflow will be set to true if the port should be closed.
+    /// @return the buffer to drop; either msg or one that has been removed
+    /// from the queue.
+    buffer_type *select_drop(buffer_type *msg, bool is_event, bool *overflow)
+    {
+        unsigned prio;
+        switch (policy_)
+        {
+            case HubQueuePolicy::DISCONNECT:
+                stats_.overflowed = true;
+                closed_ = 1;
+                *overflow = true;
+                return msg;
+            case HubQueuePolicy::DROP_EVENTS_FIRST:
+            {
+                buffer_type *b = remove_first_event();
+                if (b)
+                {
+                    return b;
+                }
+                if (is_event)
+                {
+                    return msg;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+        return static_cast<buffer_type *>(queue_next(&prio));
+    }
+
+    /// Removes the oldest event traffic buffer from the queue. Called with
+    /// the lock held. @return the removed buffer, or nullptr if there is no
+    /// event traffic queued.
+    buffer_type *remove_first_event()
+    {
+        if (!eventsQueued_)
+        {
+            return nullptr;
+        }
+        unsigned prio;
+        QMember *m = this->queue_remove_first(
+            [](QMember *m) {
+                return hub_is_event_traffic(
+                    *static_cast<buffer_type *>(m)->data());
+            },
+            &prio);
+        if (!m)
+        {
+            return nullptr;
+        }
+        --stats_.queued;
+        --eventsQueued_;
+        return static_cast<buffer_type *>(m);
+    }
+
+    /// Maximum number of buffers in the queue, 0 for unlimited.
+    size_t maxQueued_{0};
+    /// Number of event traffic buffers in the queue. Only tracked with
+    /// HubQueuePolicy::DROP_EVENTS_FIRST; recounted when the policy changes.
+    size_t eventsQueued_{0};
+    /// Counters.
+    HubQueueStats stats_;
+    /// What to do when the queue is full. Written with the lock held; send()
+    /// reads it before taking the lock.
+    std::atomic<HubQueuePolicy> policy_{HubQueuePolicy::DROP_OLDEST};
+    /// 1 if the limit is turned off.
+    unsigned closed_ : 1;
+};
+
+
 /// Templated implementation of the HubFlow.
-template<class D> class GenericHubFlow : public DispatchFlow<Buffer<D>, 1>
+///
+/// With NUM_PRIO > 1 the hub delivers buffers in priority bands: each
+/// incoming buffer is put into a band by hub_priority_band(), and buffers of
+/// more urgent (lower numbered) bands are sent to the ports first. Each band
+/// is FIFO. A band that has buffers waiting while the hub served
+/// starvation_limit buffers of more urgent bands is served next, so that no
+/// band can be starved.
+template <class D, int NUM_PRIO = 1>
+class GenericHubFlow : public DispatchFlow<Buffer<D>, NUM_PRIO>
 {
 public:
     /// Payload of the buffer.
@@ -155,9 +549,15 @@ public:
     typedef Buffer<value_type> buffer_type;
     /// Base type of an individual port.
     typedef FlowInterface<buffer_type> port_type;
+    /// Base class type.
+    typedef DispatchFlow<Buffer<D>, NUM_PRIO> Base;
+
+    /// How many buffers of more urgent bands are served by default before a
+    /// waiting band gets its turn.
+    static constexpr unsigned DEFAULT_STARVATION_LIMIT = 8;
 
     /// Constructor. @param s defines which executor to run this on.
-    GenericHubFlow(Service *s) : DispatchFlow<Buffer<D>, 1>(s)
+    GenericHubFlow(Service *s) : Base(s)
     {
         this->negateMatch_ = true;
     }
@@ -175,13 +575,279 @@ public:
     {
         this->unregister_handler(port, reinterpret_cast<uintptr_t>(port),
                                  POINTER_MASK);
+        OSMutexLock l(&this->lock_);
+        for (unsigned i = 0; i < sharedPorts_.size(); ++i)
+        {
+            if (sharedPorts_[i] == port)
+            {
+                sharedPorts_.erase(sharedPorts_.begin() + i);
+                break;
+            }
+        }
     }
+
+    /// Adds a new port that takes part in shared fan-out. Such a port does
+    /// not get a private copy of the messages. Instead it receives a small
+    /// buffer whose payload refers to the payload of the message
+    /// (HubContainer::share), so the payload is not copied for it. The port
+    /// must read the payload only through HubContainer::payload(), and must
+    /// not modify the received buffers. Unregister with unregister_port.
+    /// @param port is the object to add.
+    void register_shared_port(port_type *port)
+    {
+        {
+            OSMutexLock l(&this->lock_);
+            sharedPorts_.push_back(port);
+        }
+        register_port(port);
+    }
+
+    /// @return how many copies of messages the hub made and saved for
+    /// sending them to the ports.
+    HubFanoutStats fanout_stats()
+    {
+        AtomicHolder h(this);
+        return fanoutStats_;
+    }
+
+    /// Enqueues a buffer for sending to the ports. When the hub has priority
+    /// bands, the band comes from the buffer's contents and priority is
+    /// ignored. @param msg is the buffer to send. @param priority is the
+    /// priority of the buffer.
+    void send(buffer_type *msg, unsigned priority = UINT_MAX) override
+    {
+        if (NUM_PRIO > 1)
+        {
+            priority = prioritize_ ? hub_priority_band(*msg->data()) : 0;
+            if (priority >= (unsigned)NUM_PRIO)
+            {
+                priority = NUM_PRIO - 1;
+            }
+            if (sampleLatency_)
+            {
+                long long now = os_get_time_monotonic();
+                AtomicHolder h(this);
+                if (!probe_[priority])
+                {
+                    probe_[priority] = msg;
+                    probeTime_[priority] = now;
+                }
+            }
+        }
+        Base::send(msg, priority);
+    }
+
+    /// Enables or disables delivery in priority bands. On by default when the
+    /// hub has more than one band. When disabled, all buffers are delivered
+    /// in FIFO order.
+    /// @param enable true to deliver by bands.
+    /// @param starvation_limit how many buffers of more urgent bands can be
+    /// served while a band is waiting. 0 turns off the starvation protection.
+    void set_priority_scheduling(
+        bool enable, unsigned starvation_limit = DEFAULT_STARVATION_LIMIT)
+    {
+        AtomicHolder h(this);
+        prioritize_ = enable;
+        starvationLimit_ = starvation_limit;
+    }
+
+    /// Enables or disables measuring the time buffers spend in the queue of
+    /// the hub. One buffer per band is measured at a time. Off by default.
+    /// @param enable true to measure.
+    void set_latency_sampling(bool enable)
+    {
+        AtomicHolder h(this);
+        sampleLatency_ = enable;
+        for (unsigned i = 0; i < NUM_PRIO; ++i)
+        {
+            probe_[i] = nullptr;
+        }
+    }
+
+    /// @return the counters of a priority band. @param band is the band to
+    /// query, must be less than NUM_PRIO.
+    HubBandStats band_stats(unsigned band)
+    {
+        HASSERT(band < (unsigned)NUM_PRIO);
+        AtomicHolder h(this);
+        return bandStats_[band];
+    }
+
+protected:
+    /// Starts dispatching a new message. @return next action.
+    StateFlowBase::Action entry() override
+    {
+        sharedIssued_ = false;
+        return Base::entry();
+    }
+
+    /// Sends the current message to lastHandlerToCall_ while keeping it for
+    /// the remaining ports. Shared ports get a handle to the payload, the
+    /// others a copy. @return next action.
+    StateFlowBase::Action allocate_and_clone() override
+    {
+        if (this->lastHandlerToCall_ &&
+            is_shared_port(this->lastHandlerToCall_))
+        {
+            return this->allocate_and_call(
+                static_cast<port_type *>(this->lastHandlerToCall_),
+                STATE(send_shared));
+        }
+        if (this->lastHandlerToCall_)
+        {
+            AtomicHolder h(this);
+            ++fanoutStats_.copiesMade;
+        }
+        return Base::allocate_and_clone();
+    }
+
+    /// Sends the current message to the last port. If shared ports are
+    /// reading the payload, a port that is not shared gets a copy instead of
+    /// the original buffer, since it would be allowed to modify that.
+    /// @return next action.
+    StateFlowBase::Action send_last() override
+    {
+        if (sharedIssued_ && !is_shared_port(this->lastHandlerToCall_))
+        {
+            {
+                AtomicHolder h(this);
+                ++fanoutStats_.copiesMade;
+            }
+            return Base::allocate_and_clone();
+        }
+        return Base::send_last();
+    }
+
+    /// Takes the allocated handle buffer, makes it refer to the payload of
+    /// the current message and sends it to lastHandlerToCall_. @return next
+    /// action.
+    StateFlowBase::Action send_shared()
+    {
+        port_type *h = static_cast<port_type *>(this->lastHandlerToCall_);
+        if (!h)
+        {
+            // got unregistered
+            BufferBase *b;
+            this->cast_allocation_result(&b);
+            if (b)
+            {
+                this->get_allocation_result(h)->unref();
+            }
+            return this->call_immediately(STATE(clone_done));
+        }
+        buffer_type *handle = this->get_allocation_result(h);
+        handle->data()->share(this->message());
+        handle->data()->skipMember_ = this->message()->data()->skipMember_;
+        sharedIssued_ = true;
+        {
+            AtomicHolder l(this);
+            ++fanoutStats_.copiesSaved;
+        }
+        h->send(handle);
+        return this->call_immediately(STATE(clone_done));
+    }
+
+    /// Takes the next buffer to dispatch from the queue. Called with the lock
+    /// held. @param priority will be set to the band of the buffer. @return
+    /// the buffer, nullptr if the queue is empty.
+    QMember *queue_next(unsigned *priority) override
+    {
+        if (NUM_PRIO == 1)
+        {
+            return Base::queue_next(priority);
+        }
+        auto *q = this->queue_locked();
+        unsigned top = 0;
+        while (top < (unsigned)NUM_PRIO && q->empty(top))
+        {
+            ++top;
+        }
+        if (top >= (unsigned)NUM_PRIO)
+        {
+            return nullptr;
+        }
+        unsigned band = top;
+        if (starvationLimit_)
+        {
+            for (unsigned i = top + 1; i < (unsigned)NUM_PRIO; ++i)
+            {
+                if (skipped_[i] >= starvationLimit_ && !q->empty(i))
+                {
+                    band = i;
+                    ++bandStats_[i].promoted;
+                    break;
+                }
+            }
+        }
+        QMember *item = q->next_locked(band);
+        skipped_[band] = 0;
+        for (unsigned i = band + 1; i < (unsigned)NUM_PRIO; ++i)
+        {
+            if (!q->empty(i))
+            {
+                ++skipped_[i];
+            }
+        }
+        HubBandStats *st = &bandStats_[band];
+        ++st->frames;
+        if (item == probe_[band])
+        {
+            long long latency = os_get_time_monotonic() - probeTime_[band];
+            probe_[band] = nullptr;
+            ++st->samples;
+            st->totalLatency += latency;
+            if (latency > st->maxLatency)
+            {
+                st->maxLatency = latency;
+            }
+        }
+        *priority = band;
+        return item;
+    }
+
+private:
+    /// @return true if a port was registered with register_shared_port.
+    /// @param port is the port to look up.
+    bool is_shared_port(void *port)
+    {
+        OSMutexLock l(&this->lock_);
+        for (port_type *p : sharedPorts_)
+        {
+            if (p == port)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Ports registered with register_shared_port.
+    std::vector<port_type *> sharedPorts_;
+    /// Counters of the fan-out.
+    HubFanoutStats fanoutStats_;
+    /// True if a shared port got a handle to the current message.
+    bool sharedIssued_ {false};
+    /// Counters for each band.
+    HubBandStats bandStats_[NUM_PRIO];
+    /// For each band, the buffer whose time in the queue is being measured.
+    QMember *probe_[NUM_PRIO] = {};
+    /// For each band, when probe_ was enqueued (os_get_time_monotonic).
+    long long probeTime_[NUM_PRIO] = {};
+    /// For each band, how many buffers of more urgent bands were served
+    /// since this band was last served while it had buffers waiting.
+    unsigned skipped_[NUM_PRIO] = {};
+    /// See set_priority_scheduling.
+    unsigned starvationLimit_ {DEFAULT_STARVATION_LIMIT};
+    /// true if buffers are delivered by band.
+    bool prioritize_ {true};
+    /// true if the time in the queue is measured.
+    bool sampleLatency_ {false};
 };
 
 /** A generic hub that proxies packets of untyped (aka string) data. */
 typedef GenericHubFlow<HubData> HubFlow;
 /** A hub that proxies packets of CAN frames. */
-typedef GenericHubFlow<CanHubData> CanHubFlow;
+typedef GenericHubFlow<CanHubData, CAN_HUB_NUM_BANDS> CanHubFlow;
 
 /** This port prints all traffic from a (string-typed) hub to stdout. */
 class DisplayPort : public HubPort
@@ -224,6 +890,23 @@ public:
         return fd_;
     }
 
+    /// Limits the number of buffers waiting to be written to the fd. By
+    /// default there is no limit. Thread-safe.
+    ///
+    /// @param max_queued is the maximum number of waiting buffers, 0 for no
+    /// limit.
+    /// @param policy defines what happens when a buffer arrives and the queue
+    /// is full.
+    virtual void set_queue_limit(size_t max_queued, HubQueuePolicy policy)
+    {
+    }
+
+    /// @return the counters of the write queue. Thread-safe.
+    virtual HubQueueStats queue_stats()
+    {
+        return HubQueueStats();
+    }
+
 protected:
     FdHubPortInterface() : fd_(-1) {}
 
@@ -251,6 +934,7 @@ public:
 protected:
     // For barrier_.
     template <class HFlow> friend class HubDeviceSelectReadFlow;
+    template <class HFlow, unsigned N> friend class HubDeviceSelectBatchReadFlow;
     friend class openlcb::FdToTcpParser;
 
     /// Constructor
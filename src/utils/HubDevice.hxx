@@ -37,6 +37,9 @@
 #include <unistd.h>
 
 #include "openmrn_features.h"
+#if OPENMRN_FEATURE_BSD_SOCKETS
+#include <sys/socket.h>
+#endif
 #include "utils/Hub.hxx"
 #include "executor/SemaphoreNotifiableBlock.hxx"
 
@@ -123,6 +126,26 @@ protected:
         unregister_write_port();
     }
 
+    /// Called by the write flow when the write queue is full and the policy
+    /// is to disconnect. Closes the port as if an IO error had occurred.
+    void close_on_overflow()
+    {
+        {
+            AtomicHolder h(this);
+            if (hasError_)
+            {
+                return;
+            }
+#if OPENMRN_FEATURE_BSD_SOCKETS
+            // Unblocks the write thread if it is stuck in a write to a
+            // socket.
+            ::shutdown(fd_, SHUT_RDWR);
+#endif
+        }
+        LOG(WARNING, "FdHubPort: write queue full, closing fd %d", fd_);
+        report_error();
+    }
+
     /// Read thread implementation with template-inspecific methods.
     class ReadThreadBase : public OSThread
     {
@@ -213,22 +236,28 @@ protected:
 /// writes, thus must be run on its own executor (and must never be run on the
 /// shared executor used by the stack).
 template <class Data>
-class FdHubWriteFlow : public StateFlow<Buffer<Data>, QList<1>>
+class FdHubWriteFlow : public LimitedHubPort<Data>
 {
 public:
     /// Constructor. @param parent is the owning port.
     FdHubWriteFlow(FdHubPortBase *parent)
-        : StateFlow<Buffer<Data>, QList<1>>(&parent->writeService_)
+        : LimitedHubPort<Data>(&parent->writeService_)
         , port_(parent)
     {
     }
 
+    /// Closes the port when the queue is full.
+    void queue_overflow() override
+    {
+        port_->close_on_overflow();
+    }
+
     /// Handles the next incoming entry. @return next action
     StateFlowBase::Action entry() OVERRIDE
     {
-        const uint8_t *buf =
-            reinterpret_cast<const uint8_t *>(this->message()->data()->data());
-        size_t size = this->message()->data()->size();
+        const auto &payload = this->message()->data()->payload();
+        const uint8_t *buf = reinterpret_cast<const uint8_t *>(payload.data());
+        size_t size = payload.size();
         while (size > 0)
         {
             {
@@ -298,7 +327,7 @@ public:
         , writeFlow_(this)
         , readThread_(this)
     {
-        hub_->register_port(&writeFlow_);
+        hub_->register_shared_port(&writeFlow_);
     }
 
     ~FdHubPort() OVERRIDE
@@ -306,9 +335,27 @@ public:
         writeThread_.shutdown();
     }
 
+    /// Limits the number of buffers waiting to be written to the fd.
+    ///
+    /// @param max_queued is the maximum number of waiting buffers, 0 for no
+    /// limit.
+    /// @param policy defines what happens when a buffer arrives and the queue
+    /// is full.
+    void set_queue_limit(size_t max_queued, HubQueuePolicy policy) override
+    {
+        writeFlow_.set_queue_limit(max_queued, policy);
+    }
+
+    /// @return the counters of the write queue.
+    HubQueueStats queue_stats() override
+    {
+        return writeFlow_.queue_stats();
+    }
+
     void unregister_write_port() OVERRIDE
     {
         hub_->unregister_port(&writeFlow_);
+        writeFlow_.close_queue();
         /* We put an empty message at the end of the queue. This will cause
          * wait until all pending messages are dealt with, and then ping the
          * barrier notifiable, commencing the shutdown. */
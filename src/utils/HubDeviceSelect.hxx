@@ -43,6 +43,11 @@
 #include <unistd.h>
 #include <stdio.h>
 #include <fcntl.h>
+#include <string.h>
+#ifdef OPENMRN_HAVE_WRITEV
+#include <sys/socket.h>
+#include <sys/uio.h>
+#endif
 
 #include "executor/StateFlow.hxx"
 #include "utils/Hub.hxx"
@@ -84,6 +89,8 @@ struct SelectBufferInfo<Buffer<HubContainer<StructContainer<T>>>>
 {
     /// Helper type for declaring the payload buffer type.
     typedef Buffer<HubContainer<StructContainer<T>>> buffer_type;
+    /// Type of one frame on the wire.
+    typedef T frame_type;
 
     /// struct buffers do not need to be resized.
     static void resize_target(buffer_type *b)
@@ -112,6 +119,8 @@ template <>
 struct SelectBufferInfo<Buffer<CanHubData>> {
     /// Helper type for declaring the payload buffer type.
     typedef Buffer<CanHubData> buffer_type;
+    /// Type of one frame on the wire.
+    typedef struct can_frame frame_type;
     
     /// CAN buffers do not need to be resized.
     static void resize_target(buffer_type *b)
@@ -241,6 +250,218 @@ private:
     typename HFlow::port_type *skipMember_;
 };
 
+/// @return true if fd is a message-oriented socket (datagram, raw or
+/// seqpacket, such as SocketCAN), where every read and write transfers
+/// exactly one frame. Returns false for stream sockets, pipes, ttys and
+/// devices. @param fd is the file descriptor to check.
+inline bool hub_fd_is_datagram(int fd)
+{
+#ifdef OPENMRN_HAVE_WRITEV
+    int type = 0;
+    socklen_t len = sizeof(type);
+    if (::getsockopt(fd, SOL_SOCKET, SO_TYPE, &type, &len) < 0)
+    {
+        return false;
+    }
+    return type != SOCK_STREAM;
+#else
+    return false;
+#endif
+}
+
+/// State flow implementing select-aware batched fd reads for struct-typed
+/// hubs (CAN frames, DCC packets etc). Every read syscall fills up to N frames
+/// into a local array; the frames are then forwarded to the hub one by one.
+/// On stream-type fds (pipes, ttys, TCP) one ::read fills the array, partial
+/// trailing frames are kept for the next read. On message-oriented sockets
+/// (SocketCAN) ::recvmmsg is used where available.
+///
+/// Use as the ReadFlow template argument of HubDeviceSelect, or use
+/// HubDeviceSelectBatch.
+template <class HFlow, unsigned N = 16>
+class HubDeviceSelectBatchReadFlow : public StateFlowBase
+{
+public:
+    /// Buffer type.
+    typedef typename HFlow::buffer_type buffer_type;
+    /// Type of a frame on the wire.
+    typedef typename SelectBufferInfo<buffer_type>::frame_type frame_type;
+
+    /// Constructor.
+    ///
+    /// @param device parent object.
+    /// @param dst where to send the incoming frames.
+    /// @param skip_member source port designation for the incoming frames.
+    HubDeviceSelectBatchReadFlow(FdHubPortService *device,
+        typename HFlow::port_type *dst, typename HFlow::port_type *skip_member)
+        : StateFlowBase(device)
+        , dst_(dst)
+        , skipMember_(skip_member)
+    {
+#ifdef OPENMRN_HAVE_MMSG
+        datagram_ = hub_fd_is_datagram(device->fd());
+        memset(msgs_, 0, sizeof(msgs_));
+        for (unsigned i = 0; i < N; ++i)
+        {
+            iov_[i].iov_base = frames_ + i;
+            iov_[i].iov_len = sizeof(frame_type);
+            msgs_[i].msg_hdr.msg_iov = iov_ + i;
+            msgs_[i].msg_hdr.msg_iovlen = 1;
+        }
+#endif
+        this->start_flow(STATE(try_read));
+    }
+
+    /// Unregisters the current flow from the hub.
+    void shutdown()
+    {
+        auto *e = this->service()->executor();
+        if (e->is_selected(&selectHelper_))
+        {
+            e->unselect(&selectHelper_);
+        }
+        set_terminated();
+        notify_barrier();
+    }
+
+    /// @return the parent object.
+    FdHubPortService *device()
+    {
+        return static_cast<FdHubPortService *>(this->service());
+    }
+
+    /// Reads as many frames as are available (up to N) from the
+    /// fd. @return next state.
+    Action try_read()
+    {
+        int fd = device()->fd();
+        ssize_t ret;
+#ifdef OPENMRN_HAVE_MMSG
+        if (datagram_)
+        {
+            ret = ::recvmmsg(fd, msgs_, N, MSG_DONTWAIT, nullptr);
+            if (ret > 0)
+            {
+                // Drops frames of unexpected size by compacting the array.
+                count_ = 0;
+                for (unsigned i = 0; i < (unsigned)ret; ++i)
+                {
+                    if (msgs_[i].msg_len != sizeof(frame_type))
+                    {
+                        continue;
+                    }
+                    if (count_ != i)
+                    {
+                        frames_[count_] = frames_[i];
+                    }
+                    ++count_;
+                }
+                next_ = 0;
+                return call_immediately(STATE(allocate_buffer));
+            }
+        }
+        else
+#endif
+        {
+            uint8_t *p = reinterpret_cast<uint8_t *>(frames_);
+            ret = ::read(fd, p + partial_, sizeof(frames_) - partial_);
+            if (ret > 0)
+            {
+                partial_ += ret;
+                count_ = partial_ / sizeof(frame_type);
+                next_ = 0;
+                return call_immediately(STATE(allocate_buffer));
+            }
+        }
+        if (ret < 0 &&
+            (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            selectHelper_.reset(Selectable::READ, fd, 0);
+            selectHelper_.set_wakeup(this);
+            this->service()->executor()->select(&selectHelper_);
+            return wait();
+        }
+        // EOF or error reading the socket.
+        notify_barrier();
+        set_terminated();
+        device()->report_read_error();
+        return exit();
+    }
+
+    /// Allocates a new buffer for the next frame from the array. @return next
+    /// state.
+    Action allocate_buffer()
+    {
+        if (next_ >= count_)
+        {
+            if (!datagram_)
+            {
+                // Moves the partial trailing frame to the front.
+                uint8_t *p = reinterpret_cast<uint8_t *>(frames_);
+                size_t used = count_ * sizeof(frame_type);
+                partial_ -= used;
+                if (partial_)
+                {
+                    memmove(p, p + used, partial_);
+                }
+            }
+            count_ = 0;
+            return call_immediately(STATE(try_read));
+        }
+        return this->allocate_and_call(dst_, STATE(send_frame));
+    }
+
+    /// Fills the allocated buffer with the next frame and sends it to the
+    /// hub. @return next state.
+    Action send_frame()
+    {
+        auto *b = this->get_allocation_result(dst_);
+        b->data()->skipMember_ = skipMember_;
+        HASSERT(b->data()->size() == sizeof(frame_type));
+        memcpy(b->data()->data(), frames_ + next_, sizeof(frame_type));
+        dst_->send(b, 0);
+        ++next_;
+        return call_immediately(STATE(allocate_buffer));
+    }
+
+private:
+    /** Calls into the parent flow's barrier notify, but makes sure to
+     * only do this once in the lifetime of *this. */
+    void notify_barrier()
+    {
+        if (barrierOwned_)
+        {
+            barrierOwned_ = false;
+            device()->barrier_.notify();
+        }
+    }
+
+    /// true iff pending parent->barrier_.notify()
+    bool barrierOwned_{true};
+    /// Helper object for read/write FD asynchronously.
+    StateFlowSelectHelper selectHelper_{this};
+    /// Where do we forward the messages we created.
+    typename HFlow::port_type *dst_;
+    /// What should be the source port designation.
+    typename HFlow::port_type *skipMember_;
+    /// true if we are reading the fd with recvmmsg.
+    bool datagram_{false};
+    /// Number of complete frames in frames_.
+    unsigned count_{0};
+    /// Index of the next frame in frames_ to forward to the hub.
+    unsigned next_{0};
+    /// Number of bytes filled in frames_ (stream fds only).
+    size_t partial_{0};
+    /// Frames read from the fd.
+    frame_type frames_[N];
+#ifdef OPENMRN_HAVE_MMSG
+    /// Scatter entries for recvmmsg, one per frame.
+    struct iovec iov_[N];
+    /// Message headers for recvmmsg, one per frame.
+    struct mmsghdr msgs_[N];
+#endif
+};
+
 /// HubPort that connects a select-aware device to a strongly typed Hub.
 ///
 /// The device is given by either the path to the device or the fd to an opened
@@ -270,7 +491,7 @@ public:
         barrier_.reset(
             on_error ? on_error : EmptyNotifiable::DefaultInstance());
         barrier_.new_child();
-        hub_->register_port(write_port());
+        hub_->register_shared_port(write_port());
     }
 #endif
 
@@ -297,7 +518,7 @@ public:
 #else
         ::fcntl(fd, F_SETFL, O_RDWR | O_NONBLOCK);
 #endif
-        hub_->register_port(write_port());
+        hub_->register_shared_port(write_port());
     }
 
     /// If the barrier has not been called yet, will notify it inline.
@@ -342,6 +563,7 @@ public:
         LOG(VERBOSE, "HubDeviceSelect::unregister write port %p %p",
             write_port(), &writeFlow_);
         hub_->unregister_port(&writeFlow_);
+        writeFlow_.close_queue();
         /* We put an empty message at the end of the queue. This will cause
          * wait until all pending messages are dealt with, and then ping the
          * barrier notifiable, commencing the shutdown. */
@@ -357,9 +579,50 @@ public:
         return writeFlow_.is_waiting();
     }
 
+    /// Enables or disables batched writes. When enabled, the write flow takes
+    /// all buffers queued up for the fd (up to MAX_WRITE_BATCH) and writes
+    /// them with one ::writev (stream fds) or ::sendmmsg (message-oriented
+    /// sockets) syscall. Has no effect on platforms without writev. Must be
+    /// called on the executor of the hub or before any traffic is flowing.
+    /// @param enabled true to turn on batching.
+    void set_batched_writes(bool enabled)
+    {
+#ifdef OPENMRN_HAVE_WRITEV
+#ifdef OPENMRN_HAVE_MMSG
+        batchWrites_ = enabled;
+#else
+        batchWrites_ = enabled && !hub_fd_is_datagram(fd_);
+#endif
+#endif
+    }
+
+    /// Maximum number of buffers written in one syscall in batched mode.
+    static constexpr unsigned MAX_WRITE_BATCH = 16;
+
+    /// Limits the number of buffers waiting to be written to the fd. With
+    /// HubQueuePolicy::DISCONNECT the port is closed on the executor of the
+    /// hub, so buffers must only be sent to write_port() from there.
+    ///
+    /// @param max_queued is the maximum number of waiting buffers, 0 for no
+    /// limit.
+    /// @param policy defines what happens when a buffer arrives and the queue
+    /// is full.
+    void set_queue_limit(size_t max_queued, HubQueuePolicy policy) override
+    {
+        writeFlow_.set_queue_limit(max_queued, policy);
+    }
+
+    /// @return the counters of the write queue.
+    HubQueueStats queue_stats() override
+    {
+        return writeFlow_.queue_stats();
+    }
+
 protected:
+    /// Buffer type.
+    typedef typename HFlow::buffer_type buffer_type;
     /// Base stateflow for the WriteFlow.
-    typedef StateFlow<typename HFlow::buffer_type, QList<1>> WriteFlowBase;
+    typedef LimitedHubPort<typename HFlow::value_type> WriteFlowBase;
     /// State flow implementing select-aware fd writes.
     class WriteFlow : public WriteFlowBase
     {
@@ -403,12 +666,24 @@ protected:
             if (device()->fd() < 0) {
                 return this->release_and_exit();
             }
+#ifdef OPENMRN_HAVE_WRITEV
+            if (device()->batchWrites_)
+            {
+                return collect_batch();
+            }
+#endif
             return this->write_repeated(&selectHelper_, device()->fd(),
-                this->message()->data()->data(),
-                this->message()->data()->size(), STATE(write_done),
+                this->message()->data()->payload().data(),
+                this->message()->data()->payload().size(), STATE(write_done),
                 this->priority());
         }
 
+        /// Closes the device when the queue is full.
+        void queue_overflow() override
+        {
+            device()->close_on_overflow();
+        }
+
         /// State flow call. @return next state.
         StateFlowBase::Action write_done()
         {
@@ -418,9 +693,145 @@ protected:
             return this->release_and_exit();
         }
 
+#ifdef OPENMRN_HAVE_WRITEV
+        /// Appends a buffer to the iov array of the current batch. @param b
+        /// is the buffer to append.
+        void add_to_batch(buffer_type *b)
+        {
+            if (!b->data()->payload().size())
+            {
+                // Empty buffers (such as the shutdown marker) only need to be
+                // released.
+                return;
+            }
+            iov_[numIov_].iov_base = (void *)b->data()->payload().data();
+            iov_[numIov_].iov_len = b->data()->payload().size();
+            ++numIov_;
+        }
+
+        /// Takes the current message and every buffer waiting in the queue
+        /// (up to MAX_WRITE_BATCH) into one batch. @return next state.
+        StateFlowBase::Action collect_batch()
+        {
+            numIov_ = 0;
+            headIov_ = 0;
+            numBatch_ = 0;
+            add_to_batch(this->message());
+            {
+                AtomicHolder h(this);
+                while (numBatch_ < MAX_WRITE_BATCH - 1)
+                {
+                    unsigned prio;
+                    QMember *m = this->queue_next(&prio);
+                    if (!m)
+                    {
+                        break;
+                    }
+                    batch_[numBatch_++] = static_cast<buffer_type *>(m);
+                }
+            }
+            for (unsigned i = 0; i < numBatch_; ++i)
+            {
+                add_to_batch(batch_[i]);
+            }
+            return this->call_immediately(STATE(try_write_batch));
+        }
+
+        /// Writes as much of the current batch as the fd accepts. @return
+        /// next state.
+        StateFlowBase::Action try_write_batch()
+        {
+            int fd = device()->fd();
+            if (headIov_ >= numIov_ || fd < 0)
+            {
+                return this->call_immediately(STATE(batch_done));
+            }
+            ssize_t ret;
+#ifdef OPENMRN_HAVE_MMSG
+            if (device()->datagram_)
+            {
+                unsigned n = numIov_ - headIov_;
+                for (unsigned i = 0; i < n; ++i)
+                {
+                    memset(&msgs_[i], 0, sizeof(msgs_[i]));
+                    msgs_[i].msg_hdr.msg_iov = iov_ + headIov_ + i;
+                    msgs_[i].msg_hdr.msg_iovlen = 1;
+                }
+                ret = ::sendmmsg(fd, msgs_, n, MSG_DONTWAIT);
+                if (ret > 0)
+                {
+                    headIov_ += ret;
+                    return this->again();
+                }
+            }
+            else
+#endif
+            {
+                ret = ::writev(fd, iov_ + headIov_, numIov_ - headIov_);
+                if (ret > 0)
+                {
+                    // Skips over the fully written entries and adjusts the
+                    // partially written one.
+                    size_t done = ret;
+                    while (headIov_ < numIov_ && done >= iov_[headIov_].iov_len)
+                    {
+                        done -= iov_[headIov_].iov_len;
+                        ++headIov_;
+                    }
+                    if (done)
+                    {
+                        iov_[headIov_].iov_base =
+                            (uint8_t *)iov_[headIov_].iov_base + done;
+                        iov_[headIov_].iov_len -= done;
+                    }
+                    return this->again();
+                }
+            }
+            if (ret < 0 &&
+                (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+            {
+                // Blocked.
+                selectHelper_.reset(Selectable::WRITE, fd, this->priority());
+                selectHelper_.set_wakeup(this);
+                this->service()->executor()->select(&selectHelper_);
+                return this->wait();
+            }
+            device()->report_write_error();
+            return this->call_immediately(STATE(batch_done));
+        }
+
+        /// Releases all buffers of the batch. @return next state.
+        StateFlowBase::Action batch_done()
+        {
+            this->release();
+            for (unsigned i = 0; i < numBatch_; ++i)
+            {
+                batch_[i]->unref();
+            }
+            numBatch_ = 0;
+            return this->exit();
+        }
+#endif // OPENMRN_HAVE_WRITEV
+
     private:
         /// Helper class for asynchronous writes.
         StateFlowBase::StateFlowSelectHelper selectHelper_{this};
+#ifdef OPENMRN_HAVE_WRITEV
+        /// Buffers taken from the queue in addition to message().
+        buffer_type *batch_[MAX_WRITE_BATCH - 1];
+        /// Number of entries in batch_.
+        unsigned numBatch_{0};
+        /// Data to write, one entry per non-empty buffer.
+        struct iovec iov_[MAX_WRITE_BATCH];
+        /// Number of entries in iov_.
+        unsigned numIov_{0};
+        /// First entry in iov_ that is not completely written yet.
+        unsigned headIov_{0};
+#ifdef OPENMRN_HAVE_MMSG
+        /// Message headers for sendmmsg.
+        struct mmsghdr msgs_[MAX_WRITE_BATCH];
+#endif
+#endif // OPENMRN_HAVE_WRITEV
     };
 
 protected:
@@ -449,8 +860,32 @@ protected:
         }
     }
 
+    /** Closes the device because a slow reader let the write queue fill
+     * up. Must be called on the executor. */
+    void close_on_overflow()
+    {
+        if (fd_ < 0) {
+            return;
+        }
+        LOG(WARNING, "HubDeviceSelect: write queue full, closing fd %d", fd_);
+        unregister_write_port();
+        int fd = fd_;
+        fd_ = -1;
+        readFlow_.shutdown();
+        writeFlow_.shutdown();
+        ::close(fd);
+    }
+
     /// Hub whose data we are trying to send.
     HFlow *hub_;
+#ifdef OPENMRN_HAVE_WRITEV
+    /// true if the write flow should coalesce queued buffers.
+    bool batchWrites_{false};
+#ifdef OPENMRN_HAVE_MMSG
+    /// true if the fd is a message-oriented socket.
+    bool datagram_{hub_fd_is_datagram(fd_)};
+#endif
+#endif
     /// StateFlow for reading data from the fd. Woken when data arrives.
     ReadFlow readFlow_;
     /// StateFlow for writing data to the fd. Woken by data to send or the fd
@@ -458,6 +893,40 @@ protected:
     WriteFlow writeFlow_;
 };
 
+/// HubDeviceSelect for struct-typed hubs (such as CanHubFlow) with batching
+/// turned on in both directions: each read syscall fetches up to 16 frames,
+/// and each write syscall sends all frames queued for the device.
+template <class HFlow>
+class HubDeviceSelectBatch
+    : public HubDeviceSelect<HFlow, HubDeviceSelectBatchReadFlow<HFlow>>
+{
+public:
+    /// Base class type.
+    typedef HubDeviceSelect<HFlow, HubDeviceSelectBatchReadFlow<HFlow>> Base;
+
+#ifndef __WINNT__
+    /// Creates a batching hub port for the device specified by `path'.
+    HubDeviceSelectBatch(
+        HFlow *hub, const char *path, Notifiable *on_error = nullptr)
+        : Base(hub, path, on_error)
+    {
+        this->set_batched_writes(true);
+    }
+#endif
+
+    /// Creates a batching hub port for the opened device specified by `fd'.
+    ///
+    /// @param hub the hub to open the port on
+    /// @param fd the filedes to read/write data from/to.
+    /// @param on_error notifiable that will be called when a write or read
+    /// error is encountered.
+    HubDeviceSelectBatch(HFlow *hub, int fd, Notifiable *on_error = nullptr)
+        : Base(hub, fd, on_error)
+    {
+        this->set_batched_writes(true);
+    }
+};
+
 #endif // FEATURE_EXECUTOR_SELECT
 
 
@@ -0,0 +1,889 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file HubDeviceUring.hxx
+ *
+ * Hub port for file descriptors using io_uring for the data transfer.
+ *
+ * @author Balazs Racz
+ * @date 16 October 2026
+ */
+
+#ifndef _UTILS_HUBDEVICEURING_HXX_
+#define _UTILS_HUBDEVICEURING_HXX_
+
+#include "utils/HubDeviceSelect.hxx"
+
+#if defined(OPENMRN_HAVE_IO_URING) && defined(OPENMRN_FEATURE_EXECUTOR_SELECT)
+
+#include <errno.h>
+
+#include "utils/IoUring.hxx"
+
+/// Buffer traits for HubDeviceUring. Struct-typed hubs take one frame per
+/// buffer; string-typed hubs take whatever was read in one buffer.
+template <class BType> struct UringBufferInfo
+{
+    /// Type of one frame on the wire.
+    typedef typename SelectBufferInfo<BType>::frame_type frame_type;
+    /// Size of the read area for stream fds.
+    static constexpr size_t READ_SIZE = 16 * sizeof(frame_type);
+    /// Size of one read on message-oriented sockets.
+    static constexpr size_t DATAGRAM_SIZE = sizeof(frame_type);
+
+    /// @return how many bytes to put into the next buffer, or 0 if the data
+    /// is not enough for a buffer. @param avail is the number of bytes read.
+    static size_t unit(size_t avail)
+    {
+        return avail >= sizeof(frame_type) ? sizeof(frame_type) : 0;
+    }
+
+    /// Copies data into a freshly allocated buffer. @param b is the
+    /// buffer, @param data is the payload, @param len is the number of bytes
+    /// (always a value returned by unit()).
+    static void fill(BType *b, const uint8_t *data, size_t len)
+    {
+        HASSERT(b->data()->size() == len);
+        memcpy(b->data()->data(), data, len);
+    }
+};
+
+/// Buffer traits of HubDeviceUring for string-typed hubs.
+template <> struct UringBufferInfo<HubFlow::buffer_type>
+{
+    /// Size of the read area for stream fds.
+    static constexpr size_t READ_SIZE = 1024;
+    /// Size of one read on message-oriented sockets.
+    static constexpr size_t DATAGRAM_SIZE = 64;
+
+    /// @return how many bytes to put into the next buffer. @param avail is
+    /// the number of bytes read.
+    static size_t unit(size_t avail)
+    {
+        return avail;
+    }
+
+    /// Copies data into a freshly allocated buffer. @param b is the
+    /// buffer, @param data is the payload, @param len is the number of bytes.
+    static void fill(HubFlow::buffer_type *b, const uint8_t *data, size_t len)
+    {
+        b->data()->assign((const char *)data, len);
+    }
+};
+
+/// HubPort that connects an fd (SocketCAN socket, tty, pipe or TCP socket) to
+/// a Hub, performing the reads and writes via a per-port io_uring instance
+/// instead of one syscall per transfer. All processing happens on the
+/// executor of the hub: the completion queue of the ring is waited upon with
+/// ExecutorBase::select(), so this works with both the select and the epoll
+/// executor backends. No additional threads are started.
+///
+/// Reads go into a read area that is registered with the ring (fixed
+/// buffer), then the data is copied into hub buffers. On stream fds there is
+/// one outstanding read of up to READ_SIZE bytes; partial frames are kept for
+/// the next read. On message-oriented sockets a linked chain of
+/// READ_CHAIN single-frame reads is outstanding, which keeps the frames in
+/// order.
+///
+/// Writes take all buffers queued for the port (up to MAX_WRITE_BATCH) and
+/// submit them straight from the hub buffers: with one WRITEV on stream fds,
+/// or as linked writes on message-oriented sockets.
+///
+/// The fd is switched to blocking mode, which makes io_uring wait for
+/// readiness internally. Use create_hub_device_uring() to fall back to
+/// HubDeviceSelect on kernels without io_uring support.
+template <class HFlow> class HubDeviceUring : public FdHubPortService
+{
+public:
+    /// Buffer type.
+    typedef typename HFlow::buffer_type buffer_type;
+    /// Buffer traits.
+    typedef UringBufferInfo<buffer_type> Info;
+
+    /// Number of linked reads outstanding on message-oriented sockets.
+    static constexpr unsigned READ_CHAIN = 16;
+    /// Maximum number of buffers written in one submission.
+    static constexpr unsigned MAX_WRITE_BATCH = 16;
+
+    static_assert(READ_CHAIN <= 32, "completions are tracked in a bitmask");
+
+    /// Creates an io_uring hub port for the opened device specified by
+    /// `fd'. It can be a hardware device, socket or pipe.
+    ///
+    /// The port takes ownership of fd and closes it when it shuts down.
+    /// O_NONBLOCK is cleared while the port uses the fd, and the original
+    /// flags are restored before closing.
+    ///
+    /// @param hub the hub to open the port on
+    /// @param fd the filedes to read/write data from/to.
+    /// @param on_error notifiable that will be called when a write or read
+    /// error is encountered.
+    HubDeviceUring(HFlow *hub, int fd, Notifiable *on_error = nullptr)
+        : FdHubPortService(hub->service()->executor(), fd)
+        , hub_(hub)
+        , ring_(RING_ENTRIES)
+        , completionFlow_(this)
+        , readFlow_(this)
+        , writeFlow_(this)
+    {
+        HASSERT(fd_ >= 0);
+        HASSERT(ring_.valid());
+        barrier_.reset(
+            on_error ? on_error : EmptyNotifiable::DefaultInstance());
+        barrier_.new_child();
+        datagram_ = hub_fd_is_datagram(fd_);
+        // The reads are left to the ring, which needs a blocking fd. The
+        // flags are shared with any duplicate of the fd, so they are
+        // restored when the port closes it.
+        savedFlags_ = ::fcntl(fd_, F_GETFL);
+        ::fcntl(fd_, F_SETFL, savedFlags_ & ~O_NONBLOCK);
+        struct iovec iov = {readBuf_, sizeof(readBuf_)};
+        fixedBuffers_ = ring_.register_buffers(&iov, 1) == 0;
+        hub_->register_shared_port(write_port());
+        completionFlow_.start();
+        readFlow_.start();
+    }
+
+    /// If the barrier has not been called yet, will notify it inline.
+    virtual ~HubDeviceUring()
+    {
+        if (fd_ >= 0)
+        {
+            unregister_write_port();
+            int fd = -1;
+            executor()->sync_run([this, &fd]() {
+                fd = fd_;
+                fd_ = -1;
+                readFlow_.shutdown();
+                writeFlow_.shutdown();
+            });
+            close_fd(fd);
+        }
+        bool completed = false;
+        while (!completed)
+        {
+            executor()->sync_run([this, &completed]() {
+                if (barrier_.is_done())
+                {
+                    completed = true;
+                }
+            });
+        }
+        executor()->sync_run([this]() { completionFlow_.shutdown(); });
+    }
+
+    /// @return parent hub flow.
+    HFlow *hub()
+    {
+        return hub_;
+    }
+
+    /// @return the write flow belonging to this device.
+    typename HFlow::port_type *write_port()
+    {
+        return &writeFlow_;
+    }
+
+    /// Removes the current write port from the registry of the source hub.
+    void unregister_write_port()
+    {
+        hub_->unregister_port(&writeFlow_);
+        writeFlow_.close_queue();
+        /* We put an empty message at the end of the queue. This will cause
+         * wait until all pending messages are dealt with, and then ping the
+         * barrier notifiable, commencing the shutdown. */
+        auto *b = writeFlow_.alloc();
+        b->set_done(&barrier_);
+        writeFlow_.send(b);
+    }
+
+    /// @return true if there is no pending data to write. Can be used to check
+    /// safe destruction.
+    bool write_done()
+    {
+        return writeFlow_.is_waiting();
+    }
+
+    /// Limits the number of buffers waiting to be written to the fd. With
+    /// HubQueuePolicy::DISCONNECT the port is closed on the executor of the
+    /// hub, so buffers must only be sent to write_port() from there.
+    ///
+    /// @param max_queued is the maximum number of waiting buffers, 0 for no
+    /// limit.
+    /// @param policy defines what happens when a buffer arrives and the queue
+    /// is full.
+    void set_queue_limit(size_t max_queued, HubQueuePolicy policy) override
+    {
+        writeFlow_.set_queue_limit(max_queued, policy);
+    }
+
+    /// @return the counters of the write queue.
+    HubQueueStats queue_stats() override
+    {
+        return writeFlow_.queue_stats();
+    }
+
+private:
+    /// Number of submission queue entries of the ring. Covers the reads, the
+    /// writes and the cancellations of both.
+    static constexpr unsigned RING_ENTRIES = 64;
+
+    /// Tag in the high bits of the cqe user data.
+    enum OpKind
+    {
+        OP_READ = 1,
+        OP_WRITE = 2,
+        OP_CANCEL = 3,
+    };
+
+    /// @return the user data for an operation. @param kind is the type of
+    /// operation, @param slot is the index of the operation within its flow.
+    static uint64_t tag(OpKind kind, unsigned slot)
+    {
+        return ((uint64_t)kind << 32) | slot;
+    }
+
+    /// Submits the prepared entries to the kernel.
+    void submit()
+    {
+        int ret = ring_.submit();
+        if (ret < 0)
+        {
+            LOG_ERROR("HubDeviceUring: io_uring_enter failed: %d", ret);
+        }
+    }
+
+    /// Requests cancellation of an outstanding operation. @param user_data
+    /// is the tag of the operation to cancel.
+    void cancel(uint64_t user_data)
+    {
+        struct io_uring_sqe *sqe = ring_.get_sqe();
+        HASSERT(sqe);
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = user_data;
+        sqe->user_data = tag(OP_CANCEL, 0);
+    }
+
+    /// State flow waiting for the completion queue of the ring to become
+    /// non-empty, then dispatching the completions to the read and write
+    /// flows.
+    class CompletionFlow : public StateFlowBase
+    {
+    public:
+        /// Constructor. @param dev is the parent object.
+        CompletionFlow(HubDeviceUring *dev)
+            : StateFlowBase(dev)
+        {
+        }
+
+        /// Starts waiting for completions.
+        void start()
+        {
+            this->start_flow(STATE(reap));
+        }
+
+        /// Stops waiting for completions.
+        void shutdown()
+        {
+            auto *e = this->service()->executor();
+            if (e->is_selected(&selectHelper_))
+            {
+                e->unselect(&selectHelper_);
+            }
+            this->set_terminated();
+        }
+
+        /// @return parent object.
+        HubDeviceUring *device()
+        {
+            return static_cast<HubDeviceUring *>(this->service());
+        }
+
+        /// Dispatches all available completions. @return next state.
+        Action reap()
+        {
+            IoUring *ring = &device()->ring_;
+            while (struct io_uring_cqe *cqe = ring->peek_cqe())
+            {
+                uint64_t data = cqe->user_data;
+                int res = cqe->res;
+                ring->cqe_seen();
+                unsigned slot = data & 0xffffffffu;
+                switch (data >> 32)
+                {
+                    case OP_READ:
+                        device()->readFlow_.complete(slot, res);
+                        break;
+                    case OP_WRITE:
+                        device()->writeFlow_.complete(slot, res);
+                        break;
+                    default:
+                        break;
+                }
+            }
+            selectHelper_.reset(Selectable::READ, ring->fd(), 0);
+            selectHelper_.set_wakeup(this);
+            this->service()->executor()->select(&selectHelper_);
+            return wait();
+        }
+
+    private:
+        /// Helper object for waiting on the ring fd.
+        StateFlowSelectHelper selectHelper_{this};
+    };
+
+    /// State flow submitting reads to the ring and forwarding the incoming
+    /// data to the hub.
+    class ReadFlow : public StateFlowBase
+    {
+    public:
+        /// Constructor. @param dev is the parent object.
+        ReadFlow(HubDeviceUring *dev)
+            : StateFlowBase(dev)
+        {
+        }
+
+        /// Starts reading.
+        void start()
+        {
+            this->start_flow(STATE(submit_reads));
+        }
+
+        /// Cancels the outstanding reads and terminates the flow once they
+        /// have all completed.
+        void shutdown()
+        {
+            shutdown_ = true;
+            for (unsigned i = 0; i < submitted_; ++i)
+            {
+                if (!(doneMask_ & (1u << i)))
+                {
+                    device()->cancel(tag(OP_READ, i));
+                }
+            }
+            device()->submit();
+        }
+
+        /// Callback from the completion flow. @param slot is the index of
+        /// the read, @param res is the result of the read.
+        void complete(unsigned slot, int res)
+        {
+            HASSERT(slot < submitted_);
+            result_[slot] = res;
+            doneMask_ |= 1u << slot;
+            if (waiting_)
+            {
+                waiting_ = false;
+                this->notify();
+            }
+        }
+
+        /// @return parent object.
+        HubDeviceUring *device()
+        {
+            return static_cast<HubDeviceUring *>(this->service());
+        }
+
+        /// Puts the next set of reads into the ring. @return next state.
+        Action submit_reads()
+        {
+            if (shutdown_ || device()->fd() < 0)
+            {
+                return call_immediately(STATE(terminate));
+            }
+            HubDeviceUring *dev = device();
+            submitted_ = dev->datagram_ ? READ_CHAIN : 1;
+            doneMask_ = 0;
+            next_ = 0;
+            for (unsigned i = 0; i < submitted_; ++i)
+            {
+                uint8_t *buf;
+                size_t len;
+                if (dev->datagram_)
+                {
+                    buf = dev->readBuf_ + i * Info::DATAGRAM_SIZE;
+                    len = Info::DATAGRAM_SIZE;
+                }
+                else
+                {
+                    buf = dev->readBuf_ + partial_;
+                    len = Info::READ_SIZE - partial_;
+                }
+                struct io_uring_sqe *sqe = dev->ring_.get_sqe();
+                HASSERT(sqe);
+                sqe->opcode =
+                    dev->fixedBuffers_ ? IORING_OP_READ_FIXED : IORING_OP_READ;
+                sqe->fd = dev->fd();
+                sqe->addr = (uintptr_t)buf;
+                sqe->len = len;
+                sqe->buf_index = 0;
+                sqe->user_data = tag(OP_READ, i);
+                if (i + 1 < submitted_)
+                {
+                    sqe->flags |= IOSQE_IO_LINK;
+                }
+            }
+            dev->submit();
+            return call_immediately(STATE(process));
+        }
+
+        /// Handles the next completed read. @return next state.
+        Action process()
+        {
+            if (next_ >= submitted_)
+            {
+                if (failed_ && !shutdown_)
+                {
+                    return call_immediately(STATE(read_error));
+                }
+                return call_immediately(STATE(submit_reads));
+            }
+            if (!(doneMask_ & (1u << next_)))
+            {
+                waiting_ = true;
+                return wait();
+            }
+            int res = result_[next_];
+            if (res > 0)
+            {
+                HubDeviceUring *dev = device();
+                if (dev->datagram_)
+                {
+                    data_ = dev->readBuf_ + next_ * Info::DATAGRAM_SIZE;
+                    avail_ = Info::unit(res) == (size_t)res ? res : 0;
+                }
+                else
+                {
+                    data_ = dev->readBuf_;
+                    avail_ = partial_ + res;
+                }
+                return call_immediately(STATE(allocate_buffer));
+            }
+            if (res == 0 ||
+                (res != -ECANCELED && res != -EAGAIN && res != -EINTR))
+            {
+                // EOF or error reading the fd.
+                failed_ = true;
+            }
+            ++next_;
+            return again();
+        }
+
+        /// Allocates a buffer for the next unit of data. @return next state.
+        Action allocate_buffer()
+        {
+            size_t len = avail_ ? Info::unit(avail_) : 0;
+            if (!len)
+            {
+                if (!device()->datagram_)
+                {
+                    // Moves the partial trailing frame to the front.
+                    partial_ = avail_;
+                    if (partial_ && data_ != device()->readBuf_)
+                    {
+                        memmove(device()->readBuf_, data_, partial_);
+                    }
+                }
+                ++next_;
+                return call_immediately(STATE(process));
+            }
+            return allocate_and_call(device()->hub_, STATE(send_buffer));
+        }
+
+        /// Fills the allocated buffer and sends it to the hub. @return next
+        /// state.
+        Action send_buffer()
+        {
+            auto *b = get_allocation_result(device()->hub_);
+            size_t len = Info::unit(avail_);
+            Info::fill(b, data_, len);
+            b->data()->skipMember_ = device()->write_port();
+            device()->hub_->send(b, 0);
+            data_ += len;
+            avail_ -= len;
+            return call_immediately(STATE(allocate_buffer));
+        }
+
+        /// Handles an EOF or error on the fd. @return next state.
+        Action read_error()
+        {
+            set_terminated();
+            device()->barrier_.notify();
+            device()->report_read_error();
+            return exit();
+        }
+
+        /// Finishes the flow after a shutdown. @return next state.
+        Action terminate()
+        {
+            set_terminated();
+            device()->barrier_.notify();
+            return exit();
+        }
+
+    private:
+        /// Results of the reads in the current submission.
+        int result_[READ_CHAIN];
+        /// Number of reads submitted in the current chain.
+        unsigned submitted_{0};
+        /// Bit i is set if read i of the current chain completed.
+        uint32_t doneMask_{0};
+        /// Next completed read to process.
+        unsigned next_{0};
+        /// Bytes of an incomplete frame at the beginning of the read area
+        /// (stream fds only).
+        size_t partial_{0};
+        /// Data not yet forwarded from the current read.
+        const uint8_t *data_{nullptr};
+        /// Number of bytes at data_.
+        size_t avail_{0};
+        /// true if the flow is waiting for complete() to be called.
+        bool waiting_{false};
+        /// true if a read returned EOF or an error.
+        bool failed_{false};
+        /// true if the device is shutting down.
+        bool shutdown_{false};
+    };
+
+    /// Base stateflow for the WriteFlow.
+    typedef LimitedHubPort<typename HFlow::value_type> WriteFlowBase;
+
+    /// State flow writing batches of buffers via the ring.
+    class WriteFlow : public WriteFlowBase
+    {
+    public:
+        /// Constructor. @param dev is the parent object.
+        WriteFlow(HubDeviceUring *dev)
+            : WriteFlowBase(dev)
+        {
+        }
+
+        /// Destructor.
+        ~WriteFlow()
+        {
+            HASSERT(this->is_waiting());
+        }
+
+        /// Cancels the outstanding writes. The flow will then drain its
+        /// queue without writing.
+        void shutdown()
+        {
+            if (!outstanding_)
+            {
+                return;
+            }
+            for (unsigned i = 0; i < submitted_; ++i)
+            {
+                device()->cancel(tag(OP_WRITE, i));
+            }
+            device()->submit();
+        }
+
+        /// Closes the device when the queue is full.
+        void queue_overflow() override
+        {
+            device()->close_on_overflow();
+        }
+
+        /// Callback from the completion flow. @param slot is the index of
+        /// the write, @param res is the result of the write.
+        void complete(unsigned slot, int res)
+        {
+            result_[slot] = res;
+            HASSERT(outstanding_);
+            if (--outstanding_ == 0)
+            {
+                this->notify();
+            }
+        }
+
+        /// @return parent object.
+        HubDeviceUring *device()
+        {
+            return static_cast<HubDeviceUring *>(this->service());
+        }
+
+        StateFlowBase::Action entry() OVERRIDE
+        {
+            if (device()->fd() < 0)
+            {
+                return this->release_and_exit();
+            }
+            numIov_ = 0;
+            headIov_ = 0;
+            numBatch_ = 0;
+            add_to_batch(this->message());
+            {
+                AtomicHolder h(this);
+                while (numBatch_ < MAX_WRITE_BATCH - 1)
+                {
+                    unsigned prio;
+                    QMember *m = this->queue_next(&prio);
+                    if (!m)
+                    {
+                        break;
+                    }
+                    batch_[numBatch_++] = static_cast<buffer_type *>(m);
+                }
+            }
+            for (unsigned i = 0; i < numBatch_; ++i)
+            {
+                add_to_batch(batch_[i]);
+            }
+            return this->call_immediately(STATE(submit_writes));
+        }
+
+        /// Submits the unwritten part of the batch. @return next state.
+        StateFlowBase::Action submit_writes()
+        {
+            HubDeviceUring *dev = device();
+            if (headIov_ >= numIov_ || dev->fd() < 0)
+            {
+                return this->call_immediately(STATE(batch_done));
+            }
+            submitted_ = dev->datagram_ ? numIov_ - headIov_ : 1;
+            for (unsigned i = 0; i < submitted_; ++i)
+            {
+                struct io_uring_sqe *sqe = dev->ring_.get_sqe();
+                HASSERT(sqe);
+                sqe->fd = dev->fd();
+                if (dev->datagram_)
+                {
+                    sqe->opcode = IORING_OP_WRITE;
+                    sqe->addr = (uintptr_t)iov_[headIov_ + i].iov_base;
+                    sqe->len = iov_[headIov_ + i].iov_len;
+                    if (i + 1 < submitted_)
+                    {
+                        sqe->flags |= IOSQE_IO_LINK;
+                    }
+                }
+                else
+                {
+                    sqe->opcode = IORING_OP_WRITEV;
+                    sqe->addr = (uintptr_t)(iov_ + headIov_);
+                    sqe->len = numIov_ - headIov_;
+                }
+                sqe->user_data = tag(OP_WRITE, i);
+            }
+            outstanding_ = submitted_;
+            dev->submit();
+            return this->wait_and_call(STATE(write_complete));
+        }
+
+        /// Evaluates the results of the submitted writes. @return next state.
+        StateFlowBase::Action write_complete()
+        {
+            bool error = false;
+            for (unsigned i = 0; i < submitted_; ++i)
+            {
+                int res = result_[i];
+                if (res < 0 && res != -ECANCELED && res != -EAGAIN &&
+                    res != -EINTR)
+                {
+                    error = true;
+                }
+            }
+            if (device()->datagram_)
+            {
+                // Skips over the leading frames that went out.
+                for (unsigned i = 0; i < submitted_ && result_[i] > 0; ++i)
+                {
+                    ++headIov_;
+                }
+            }
+            else if (result_[0] > 0)
+            {
+                // Skips over the fully written entries and adjusts the
+                // partially written one.
+                size_t done = result_[0];
+                while (headIov_ < numIov_ && done >= iov_[headIov_].iov_len)
+                {
+                    done -= iov_[headIov_].iov_len;
+                    ++headIov_;
+                }
+                if (done)
+                {
+                    iov_[headIov_].iov_base =
+                        (uint8_t *)iov_[headIov_].iov_base + done;
+                    iov_[headIov_].iov_len -= done;
+                }
+            }
+            else if (result_[0] == 0)
+            {
+                error = true;
+            }
+            if (error && device()->fd() >= 0)
+            {
+                device()->report_write_error();
+                return this->call_immediately(STATE(batch_done));
+            }
+            return this->call_immediately(STATE(submit_writes));
+        }
+
+        /// Releases all buffers of the batch. @return next state.
+        StateFlowBase::Action batch_done()
+        {
+            this->release();
+            for (unsigned i = 0; i < numBatch_; ++i)
+            {
+                batch_[i]->unref();
+            }
+            numBatch_ = 0;
+            return this->exit();
+        }
+
+    private:
+        /// Appends a buffer to the iov array of the current batch. @param b
+        /// is the buffer to append.
+        void add_to_batch(buffer_type *b)
+        {
+            if (!b->data()->payload().size())
+            {
+                // Empty buffers (such as the shutdown marker) only need to be
+                // released.
+                return;
+            }
+            iov_[numIov_].iov_base = (void *)b->data()->payload().data();
+            iov_[numIov_].iov_len = b->data()->payload().size();
+            ++numIov_;
+        }
+
+        /// Buffers taken from the queue in addition to message().
+        buffer_type *batch_[MAX_WRITE_BATCH - 1];
+        /// Number of entries in batch_.
+        unsigned numBatch_{0};
+        /// Data to write, one entry per non-empty buffer.
+        struct iovec iov_[MAX_WRITE_BATCH];
+        /// Number of entries in iov_.
+        unsigned numIov_{0};
+        /// First entry in iov_ that is not completely written yet.
+        unsigned headIov_{0};
+        /// Results of the writes in the current submission.
+        int result_[MAX_WRITE_BATCH];
+        /// Number of writes in the current submission.
+        unsigned submitted_{0};
+        /// Number of writes in the current submission not yet completed.
+        unsigned outstanding_{0};
+    };
+
+    /** The assumption here is that the write flow still has entries in its
+     * queue that need to be removed. */
+    void report_write_error() override
+    {
+        readFlow_.shutdown();
+        unregister_write_port();
+        if (fd_ >= 0)
+        {
+            close_fd(fd_);
+            fd_ = -1;
+        }
+    }
+
+    /** Callback from the ReadFlow when the read has seen an error. The read
+     * count will already have been taken out of the barrier, and the read
+     * flow in terminated state. */
+    void report_read_error() override
+    {
+        writeFlow_.shutdown();
+        unregister_write_port();
+        if (fd_ >= 0)
+        {
+            close_fd(fd_);
+            fd_ = -1;
+        }
+    }
+
+    /** Closes the device because a slow reader let the write queue fill
+     * up. Must be called on the executor. */
+    void close_on_overflow()
+    {
+        if (fd_ < 0)
+        {
+            return;
+        }
+        LOG(WARNING, "HubDeviceUring: write queue full, closing fd %d", fd_);
+        unregister_write_port();
+        int fd = fd_;
+        fd_ = -1;
+        readFlow_.shutdown();
+        writeFlow_.shutdown();
+        close_fd(fd);
+    }
+
+    /// Restores the file status flags that the fd had when it was given to
+    /// us, then closes it. @param fd is the file descriptor.
+    void close_fd(int fd)
+    {
+        ::fcntl(fd, F_SETFL, savedFlags_);
+        ::close(fd);
+    }
+
+    /// Hub whose data we are trying to send.
+    HFlow *hub_;
+    /// Ring performing the transfers of this port.
+    IoUring ring_;
+    /// true if readBuf_ is registered with the ring.
+    bool fixedBuffers_{false};
+    /// true if the fd is a message-oriented socket.
+    bool datagram_{false};
+    /// File status flags of the fd before the constructor cleared
+    /// O_NONBLOCK.
+    int savedFlags_{0};
+    /// Read area; also used as READ_CHAIN slots on message-oriented sockets.
+    uint8_t readBuf_[Info::READ_SIZE > READ_CHAIN * Info::DATAGRAM_SIZE
+            ? Info::READ_SIZE
+            : READ_CHAIN * Info::DATAGRAM_SIZE];
+    /// StateFlow dispatching the completions of the ring.
+    CompletionFlow completionFlow_;
+    /// StateFlow for reading data from the fd.
+    ReadFlow readFlow_;
+    /// StateFlow for writing data to the fd. Woken by data to send.
+    WriteFlow writeFlow_;
+};
+
+/// Creates a hub port for an opened fd, using HubDeviceUring if the running
+/// kernel supports io_uring, and HubDeviceSelect otherwise.
+///
+/// @param hub the hub to open the port on
+/// @param fd the filedes to read/write data from/to.
+/// @param on_error notifiable that will be called when a write or read
+/// error is encountered.
+/// @return the new port. Delete it to close the port.
+template <class HFlow>
+FdHubPortService *create_hub_device_uring(
+    HFlow *hub, int fd, Notifiable *on_error = nullptr)
+{
+    if (IoUring::is_supported())
+    {
+        return new HubDeviceUring<HFlow>(hub, fd, on_error);
+    }
+    return new HubDeviceSelect<HFlow>(hub, fd, on_error);
+}
+
+#endif // OPENMRN_HAVE_IO_URING && OPENMRN_FEATURE_EXECUTOR_SELECT
+
+#endif // _UTILS_HUBDEVICEURING_HXX_
@@ -0,0 +1,204 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file IoUring.cpp
+ *
+ * Minimal wrapper around the Linux io_uring system calls.
+ *
+ * @author Balazs Racz
+ * @date 16 October 2026
+ */
+
+#include "utils/IoUring.hxx"
+
+#ifdef OPENMRN_HAVE_IO_URING
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+IoUring::IoUring(unsigned entries)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    fd_ = syscall(__NR_io_uring_setup, entries, &p);
+    if (fd_ < 0)
+    {
+        fd_ = -1;
+        return;
+    }
+    sqRingSize_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cqRingSize_ = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED)
+    {
+        sqRing_ = nullptr;
+        cleanup();
+        return;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP)
+    {
+        cqRing_ = sqRing_;
+    }
+    else
+    {
+        cqRing_ = mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+        if (cqRing_ == MAP_FAILED)
+        {
+            cqRing_ = nullptr;
+            cleanup();
+            return;
+        }
+    }
+    sqesSize_ = p.sq_entries * sizeof(struct io_uring_sqe);
+    sqes_ = (struct io_uring_sqe *)mmap(nullptr, sqesSize_,
+        PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+        IORING_OFF_SQES);
+    if (sqes_ == MAP_FAILED)
+    {
+        sqes_ = nullptr;
+        cleanup();
+        return;
+    }
+    uint8_t *sq = (uint8_t *)sqRing_;
+    sqHead_ = (unsigned *)(sq + p.sq_off.head);
+    sqTail_ = (unsigned *)(sq + p.sq_off.tail);
+    sqMask_ = *(unsigned *)(sq + p.sq_off.ring_mask);
+    sqEntries_ = *(unsigned *)(sq + p.sq_off.ring_entries);
+    sqArray_ = (unsigned *)(sq + p.sq_off.array);
+    sqeTail_ = sqeSubmitted_ = *sqTail_;
+    uint8_t *cq = (uint8_t *)cqRing_;
+    cqHead_ = (unsigned *)(cq + p.cq_off.head);
+    cqTail_ = (unsigned *)(cq + p.cq_off.tail);
+    cqMask_ = *(unsigned *)(cq + p.cq_off.ring_mask);
+    cqes_ = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+}
+
+IoUring::~IoUring()
+{
+    cleanup();
+}
+
+void IoUring::cleanup()
+{
+    if (sqes_)
+    {
+        munmap(sqes_, sqesSize_);
+        sqes_ = nullptr;
+    }
+    if (cqRing_ && cqRing_ != sqRing_)
+    {
+        munmap(cqRing_, cqRingSize_);
+    }
+    cqRing_ = nullptr;
+    if (sqRing_)
+    {
+        munmap(sqRing_, sqRingSize_);
+        sqRing_ = nullptr;
+    }
+    if (fd_ >= 0)
+    {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool IoUring::is_supported()
+{
+    static int supported = -1;
+    if (supported < 0)
+    {
+        IoUring probe(1);
+        supported = probe.valid() ? 1 : 0;
+    }
+    return supported;
+}
+
+struct io_uring_sqe *IoUring::get_sqe()
+{
+    unsigned head = __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE);
+    if (sqeTail_ - head >= sqEntries_)
+    {
+        return nullptr;
+    }
+    unsigned idx = sqeTail_ & sqMask_;
+    struct io_uring_sqe *sqe = &sqes_[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqArray_[idx] = idx;
+    ++sqeTail_;
+    return sqe;
+}
+
+int IoUring::submit()
+{
+    unsigned count = sqeTail_ - sqeSubmitted_;
+    if (!count)
+    {
+        return 0;
+    }
+    // Publishes the new entries to the kernel.
+    __atomic_store_n(sqTail_, sqeTail_, __ATOMIC_RELEASE);
+    sqeSubmitted_ = sqeTail_;
+    int ret;
+    do
+    {
+        ret = syscall(__NR_io_uring_enter, fd_, count, 0, 0, nullptr, 0);
+    } while (ret < 0 && errno == EINTR);
+    return ret < 0 ? -errno : ret;
+}
+
+struct io_uring_cqe *IoUring::peek_cqe()
+{
+    unsigned head = *cqHead_;
+    if (head == __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE))
+    {
+        return nullptr;
+    }
+    return &cqes_[head & cqMask_];
+}
+
+void IoUring::cqe_seen()
+{
+    __atomic_store_n(cqHead_, *cqHead_ + 1, __ATOMIC_RELEASE);
+}
+
+int IoUring::register_buffers(const struct iovec *iovs, unsigned count)
+{
+    int ret = syscall(
+        __NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, iovs, count);
+    return ret < 0 ? -errno : 0;
+}
+
+#endif // OPENMRN_HAVE_IO_URING
@@ -0,0 +1,148 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file IoUring.hxx
+ *
+ * Minimal wrapper around the Linux io_uring system calls.
+ *
+ * @author Balazs Racz
+ * @date 16 October 2026
+ */
+
+#ifndef _UTILS_IOURING_HXX_
+#define _UTILS_IOURING_HXX_
+
+#include "openmrn_features.h"
+
+#ifdef OPENMRN_HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <stdint.h>
+#include <sys/uio.h>
+
+#include "utils/macros.h"
+
+/// Minimal wrapper around an io_uring instance, using the raw system calls
+/// (no liburing dependency). Not thread-safe: all calls must come from the
+/// same thread, typically the executor owning the ring.
+///
+/// The ring fd becomes readable when there are completions to reap, so it
+/// can be waited upon with ExecutorBase::select().
+class IoUring
+{
+public:
+    /// Creates the ring. Check valid() afterwards. @param entries is the
+    /// number of submission queue entries (rounded up to a power of two by
+    /// the kernel).
+    IoUring(unsigned entries);
+
+    ~IoUring();
+
+    /// @return true if the ring was successfully set up.
+    bool valid()
+    {
+        return fd_ >= 0;
+    }
+
+    /// @return the file descriptor of the ring.
+    int fd()
+    {
+        return fd_;
+    }
+
+    /// @return true if the running kernel supports io_uring (and it is not
+    /// disabled by policy). The result is computed once.
+    static bool is_supported();
+
+    /// Allocates a submission queue entry. The entry is zeroed. @return
+    /// nullptr if the submission queue is full.
+    struct io_uring_sqe *get_sqe();
+
+    /// Submits all entries allocated with get_sqe() since the last
+    /// call. @return number of entries submitted, or -errno.
+    int submit();
+
+    /// @return the next completion entry, or nullptr if there is none
+    /// available. Call cqe_seen() when done with it.
+    struct io_uring_cqe *peek_cqe();
+
+    /// Releases the completion entry returned by peek_cqe().
+    void cqe_seen();
+
+    /// Registers fixed buffers with the ring to be used by READ_FIXED and
+    /// WRITE_FIXED operations. @param iovs is the array of buffers, @param
+    /// count is the number of entries. @return 0 on success or -errno.
+    int register_buffers(const struct iovec *iovs, unsigned count);
+
+private:
+    /// Unmaps the rings and closes the fd.
+    void cleanup();
+
+    /// File descriptor of the ring, -1 if setup failed.
+    int fd_{-1};
+    /// Mapped submission queue ring.
+    void *sqRing_{nullptr};
+    /// Size of the mapping of sqRing_.
+    size_t sqRingSize_{0};
+    /// Mapped completion queue ring (may be equal to sqRing_).
+    void *cqRing_{nullptr};
+    /// Size of the mapping of cqRing_.
+    size_t cqRingSize_{0};
+    /// Mapped array of submission queue entries.
+    struct io_uring_sqe *sqes_{nullptr};
+    /// Size of the mapping of sqes_.
+    size_t sqesSize_{0};
+
+    /// Kernel's consumer index of the submission queue.
+    unsigned *sqHead_;
+    /// Our producer index of the submission queue.
+    unsigned *sqTail_;
+    /// Index mask of the submission queue.
+    unsigned sqMask_;
+    /// Number of submission queue entries.
+    unsigned sqEntries_;
+    /// Indirection array of the submission queue.
+    unsigned *sqArray_;
+    /// Tail of the entries handed out by get_sqe().
+    unsigned sqeTail_{0};
+    /// Tail of the entries already published to the kernel.
+    unsigned sqeSubmitted_{0};
+
+    /// Our consumer index of the completion queue.
+    unsigned *cqHead_;
+    /// Kernel's producer index of the completion queue.
+    unsigned *cqTail_;
+    /// Index mask of the completion queue.
+    unsigned cqMask_;
+    /// Completion queue entries.
+    struct io_uring_cqe *cqes_;
+
+    DISALLOW_COPY_AND_ASSIGN(IoUring);
+};
+
+#endif // OPENMRN_HAVE_IO_URING
+
+#endif // _UTILS_IOURING_HXX_
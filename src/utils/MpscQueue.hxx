@@ -0,0 +1,145 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file MpscQueue.hxx
+ *
+ * Lock-free intrusive multiple-producer single-consumer queue of QMember
+ * entries.
+ *
+ * @author Balazs Racz
+ * @date 16 October 2026
+ */
+
+#ifndef _UTILS_MPSCQUEUE_HXX_
+#define _UTILS_MPSCQUEUE_HXX_
+
+#include <atomic>
+
+#include "utils/QMember.hxx"
+#include "utils/macros.h"
+
+/// Lock-free intrusive queue with multiple producers and a single consumer.
+///
+/// Any thread may call insert() concurrently; the consumer thread calls
+/// next() to take the entries in FIFO order. The entries are linked
+/// through the QMember::next pointer, so an entry may be on at most one queue
+/// at a time, same as with @ref Q. Neither insert() nor next() takes a lock.
+///
+/// This is the intrusive MPSC queue algorithm of Dmitry Vyukov. An insert
+/// costs one atomic exchange and one store. There is a short window within
+/// insert() when the queue is not fully linked; if the consumer runs in that
+/// window, next() returns nullptr while empty() returns false. The consumer
+/// then has to wait for the producer to finish (e.g. by yielding) and retry.
+/// This is only safe with preemptive scheduling on several cores or when the
+/// producers cannot be starved by the consumer, so it is not suitable for
+/// inserting from an ISR or from a lower priority thread on a single-core
+/// RTOS.
+class MpscQueue
+{
+public:
+    MpscQueue()
+        : back_(&stub_)
+        , front_(&stub_)
+    {
+    }
+
+    /// Adds an entry to the back of the queue. May be called from any
+    /// thread.
+    /// @param item entry to add. Must not be in any queue.
+    void insert(QMember *item)
+    {
+        HASSERT(item->next == nullptr);
+        QMember *prev = back_.exchange(item, std::memory_order_acq_rel);
+        __atomic_store_n(&prev->next, item, __ATOMIC_RELEASE);
+    }
+
+    /// Takes the entry from the front of the queue. May be called only from
+    /// the consumer thread.
+    /// @return the oldest entry, or nullptr if the queue is empty (or an
+    /// insert is in progress).
+    QMember *next()
+    {
+        QMember *front = front_;
+        QMember *nxt = __atomic_load_n(&front->next, __ATOMIC_ACQUIRE);
+        if (front == &stub_)
+        {
+            if (!nxt)
+            {
+                return nullptr;
+            }
+            // Skips the stub.
+            front_ = front = nxt;
+            stub_.next = nullptr;
+            nxt = __atomic_load_n(&front->next, __ATOMIC_ACQUIRE);
+        }
+        if (nxt)
+        {
+            front_ = nxt;
+            front->next = nullptr;
+            return front;
+        }
+        if (front != back_.load(std::memory_order_acquire))
+        {
+            // A producer is in the middle of an insert.
+            return nullptr;
+        }
+        // front is the last entry. We put back the stub so that front can be
+        // unlinked.
+        insert(&stub_);
+        nxt = __atomic_load_n(&front->next, __ATOMIC_ACQUIRE);
+        if (nxt)
+        {
+            front_ = nxt;
+            front->next = nullptr;
+            return front;
+        }
+        return nullptr;
+    }
+
+    /// @return true if there are no entries in the queue. May be called from
+    /// any thread. Returns false while an insert() is in progress.
+    bool empty()
+    {
+        return back_.load(std::memory_order_acquire) == &stub_;
+    }
+
+private:
+    /// Placeholder entry that keeps the queue non-empty internally.
+    class Stub : public QMember
+    {
+    };
+
+    /// Last entry of the queue. Producers swap themselves in here.
+    std::atomic<QMember *> back_;
+    /// First entry of the queue. Owned by the consumer.
+    QMember *front_;
+    /// Placeholder entry.
+    Stub stub_;
+
+    DISALLOW_COPY_AND_ASSIGN(MpscQueue);
+};
+
+#endif // _UTILS_MPSCQUEUE_HXX_
@@ -68,6 +68,8 @@ protected:
     friend class Q;
     /** This class is a helper of SimpleQueue */
     friend class SimpleQueue;
+    /** This class is a helper of MpscQueue */
+    friend class MpscQueue;
     /** ActiveTimers needs to iterate through the queue. */
     friend class ActiveTimers;
     /** ActiveTimers needs to iterate through the queue. */
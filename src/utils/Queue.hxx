@@ -200,6 +200,41 @@ public:
 
         return Result(qm, 0);
     }
+
+    /** Removes the first item of the queue for which a predicate is
+     * true. Needs external locking. The cost is linear in the position of the
+     * removed item.
+     * @param pred is called with the items, front to back, until it returns
+     *        true.
+     * @return the removed item, NULL if pred was false for all items
+     */
+    template <class Pred> QMember *remove_first_locked(Pred pred)
+    {
+        QMember *prev = NULL;
+        for (QMember *qm = head; qm; prev = qm, qm = qm->next)
+        {
+            if (!pred(qm))
+            {
+                continue;
+            }
+            if (prev)
+            {
+                prev->next = qm->next;
+            }
+            else
+            {
+                head = qm->next;
+            }
+            if (tail == qm)
+            {
+                tail = prev;
+            }
+            qm->next = NULL;
+            --count;
+            return qm;
+        }
+        return NULL;
+    }
     
     /** Get the number of pending items in the queue.
      * @param index in the list to operate on
@@ -509,6 +544,15 @@ public:
         return list[index].next_locked().item;
     }
 
+    /** Get an item from the front of the queue. Needs external locking.
+     * @param index in the list to operate on
+     * @return item retrieved from queue, NULL if no item available
+     */
+    QMember *next_locked(unsigned index)
+    {
+        return list[index].next_locked().item;
+    }
+
     /** Get an item from the front of the queue queue in priority order.
      * @return item retrieved from queue + index, NULL if no item available
      */
@@ -531,6 +575,36 @@ public:
         return Result();
     }
 
+    /** Removes the first item for which a predicate is true, in priority
+     * order. Needs external locking.
+     * @param pred is called with the items until it returns true.
+     * @return removed item + index, NULL if pred was false for all items
+     */
+    template <class Pred> Result remove_first_locked(Pred pred)
+    {
+        for (unsigned i = 0; i < ITEMS; ++i)
+        {
+            QMember *result = list[i].remove_first_locked(pred);
+            if (result)
+            {
+                return Result(result, i);
+            }
+        }
+        return Result();
+    }
+
+    /** Removes the first item of one priority band for which a predicate is
+     * true. Needs external locking.
+     * @param index in the list to operate on
+     * @param pred is called with the items, front to back, until it returns
+     *        true.
+     * @return the removed item, NULL if pred was false for all items
+     */
+    template <class Pred> QMember *remove_first_locked(unsigned index, Pred pred)
+    {
+        return list[index].remove_first_locked(pred);
+    }
+
     /** Get the number of pending items in the queue.
      * @param index in the list to operate on
      * @return number of pending items in the queue
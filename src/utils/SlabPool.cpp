@@ -0,0 +1,330 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file SlabPool.cpp
+ *
+ * Size-class slab allocator with per-thread caches for the main buffer pool.
+ *
+ * @author Balazs Racz
+ * @date 16 October 2026
+ */
+
+#include "utils/SlabPool.hxx"
+
+#include <string.h>
+
+#include "openmrn_features.h"
+
+#if OPENMRN_FEATURE_THREAD_PTHREAD
+#include <pthread.h>
+#endif
+
+extern "C" {
+/// malloc implementation used for allocating buffer space. Defined in
+/// os/stack_malloc.c (weak).
+extern void *buffer_malloc(size_t length);
+}
+
+/// Thread cache of the current thread. The type is SlabPool::ThreadCache.
+static thread_local void *g_slab_thread_cache = nullptr;
+
+#if OPENMRN_FEATURE_THREAD_PTHREAD
+/// Holds the thread cache of each thread as well, so that the cache gets
+/// released when the thread exits.
+static pthread_key_t g_slab_thread_key;
+/// Makes sure g_slab_thread_key is created only once.
+static pthread_once_t g_slab_thread_key_once = PTHREAD_ONCE_INIT;
+
+void SlabPool::thread_key_init()
+{
+    HASSERT(0 ==
+        pthread_key_create(&g_slab_thread_key, &release_thread_cache));
+}
+#endif
+
+SlabPool::SlabPool()
+    : DynamicPool(Bucket::init(0))
+{
+    memset(classes_, 0, sizeof(classes_));
+}
+
+SlabPool::~SlabPool()
+{
+    // The threads may still point to their caches; make sure they will not
+    // touch this pool anymore. The slabs are not returned to the heap, same
+    // as the buckets of a DynamicPool.
+    AtomicHolder h(&lock_);
+    for (ThreadCache *tc = caches_; tc; tc = tc->next)
+    {
+        tc->owner = nullptr;
+    }
+}
+
+unsigned SlabPool::size_class(size_t size)
+{
+    if (size <= class_size(0))
+    {
+        return 0;
+    }
+    unsigned bits =
+        sizeof(unsigned long) * 8 - __builtin_clzl((unsigned long)size - 1);
+    unsigned c = bits - MIN_SHIFT;
+    return c < NUM_CLASSES ? c : NUM_CLASSES;
+}
+
+SlabPool::ThreadCache *SlabPool::thread_cache()
+{
+    ThreadCache *tc = static_cast<ThreadCache *>(g_slab_thread_cache);
+    if (!tc)
+    {
+        tc = static_cast<ThreadCache *>(malloc(sizeof(ThreadCache)));
+        HASSERT(tc);
+        memset(tc, 0, sizeof(*tc));
+        tc->owner = this;
+        {
+            AtomicHolder h(&lock_);
+            tc->next = caches_;
+            caches_ = tc;
+        }
+        g_slab_thread_cache = tc;
+#if OPENMRN_FEATURE_THREAD_PTHREAD
+        pthread_once(&g_slab_thread_key_once, &thread_key_init);
+        pthread_setspecific(g_slab_thread_key, tc);
+#endif
+    }
+    return tc->owner == this ? tc : nullptr;
+}
+
+void SlabPool::release_thread_cache(void *cache)
+{
+    ThreadCache *tc = static_cast<ThreadCache *>(cache);
+    g_slab_thread_cache = nullptr;
+    SlabPool *pool = tc->owner;
+    if (pool)
+    {
+        AtomicHolder h(&pool->lock_);
+        for (unsigned c = 0; c < NUM_CLASSES; ++c)
+        {
+            Magazine *m = &tc->magazines[c];
+            SizeClass *sc = &pool->classes_[c];
+            for (unsigned i = 0; i < m->count; ++i)
+            {
+                FreeObject *o = static_cast<FreeObject *>(m->objects[i]);
+                o->next = sc->depot;
+                sc->depot = o;
+            }
+            sc->depotCount += m->count;
+            sc->hits += m->hits;
+            sc->misses += m->misses;
+        }
+        for (ThreadCache **link = &pool->caches_; *link;
+             link = &(*link)->next)
+        {
+            if (*link == tc)
+            {
+                *link = tc->next;
+                break;
+            }
+        }
+    }
+    ::free(tc);
+}
+
+unsigned SlabPool::take(unsigned c, void **objects, unsigned count)
+{
+    SizeClass *sc = &classes_[c];
+    {
+        AtomicHolder h(&lock_);
+        if (sc->depot)
+        {
+            unsigned n = 0;
+            while (sc->depot && n < count)
+            {
+                objects[n++] = sc->depot;
+                sc->depot = sc->depot->next;
+            }
+            sc->depotCount -= n;
+            return n;
+        }
+    }
+    // Depot is empty: carves up a new slab. The heap is called outside of
+    // the lock.
+    size_t object_size = class_size(c);
+    unsigned per_slab = SLAB_BYTES / object_size;
+    if (!per_slab)
+    {
+        per_slab = 1;
+    }
+    char *slab = static_cast<char *>(buffer_malloc(per_slab * object_size));
+    HASSERT(slab);
+    unsigned n = per_slab < count ? per_slab : count;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        objects[i] = slab + i * object_size;
+    }
+    AtomicHolder h(&lock_);
+    sc->slabs++;
+    sc->objects += per_slab;
+    totalSize += per_slab * object_size;
+    for (unsigned i = n; i < per_slab; ++i)
+    {
+        FreeObject *o = reinterpret_cast<FreeObject *>(slab + i * object_size);
+        o->next = sc->depot;
+        sc->depot = o;
+        sc->depotCount++;
+    }
+    return n;
+}
+
+void SlabPool::give(unsigned c, void **objects, unsigned count)
+{
+    SizeClass *sc = &classes_[c];
+    AtomicHolder h(&lock_);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        FreeObject *o = static_cast<FreeObject *>(objects[i]);
+        o->next = sc->depot;
+        sc->depot = o;
+    }
+    sc->depotCount += count;
+}
+
+BufferBase *SlabPool::alloc_untyped(size_t size, Executable *flow)
+{
+    void *object;
+    unsigned c = size_class(size);
+    if (c >= NUM_CLASSES)
+    {
+        /* big items are just malloc'd freely */
+        object = malloc(size);
+        HASSERT(object);
+        AtomicHolder h(&lock_);
+        totalSize += size;
+    }
+    else if (ThreadCache *tc = thread_cache())
+    {
+        Magazine *m = &tc->magazines[c];
+        if (m->count)
+        {
+            ++m->hits;
+        }
+        else
+        {
+            ++m->misses;
+            m->count = take(c, m->objects, MAGAZINE_SIZE / 2);
+        }
+        object = m->objects[--m->count];
+    }
+    else
+    {
+        take(c, &object, 1);
+        AtomicHolder h(&lock_);
+        ++classes_[c].misses;
+    }
+    BufferBase *result = new (object) BufferBase(size, this);
+    if (flow)
+    {
+        flow->alloc_result(result);
+    }
+    return result;
+}
+
+void SlabPool::free(BufferBase *item)
+{
+    size_t size = item->size();
+    unsigned c = size_class(size);
+    void *object = item;
+    if (c >= NUM_CLASSES)
+    {
+        /* big items are just freed */
+        {
+            AtomicHolder h(&lock_);
+            totalSize -= size;
+        }
+        ::free(object);
+        return;
+    }
+    ThreadCache *tc = thread_cache();
+    if (!tc)
+    {
+        give(c, &object, 1);
+        return;
+    }
+    Magazine *m = &tc->magazines[c];
+    if (m->count >= MAGAZINE_SIZE)
+    {
+        // Keeps the older half for the next allocations on this thread.
+        give(c, m->objects + MAGAZINE_SIZE / 2, MAGAZINE_SIZE / 2);
+        m->count = MAGAZINE_SIZE / 2;
+    }
+    m->objects[m->count++] = object;
+}
+
+size_t SlabPool::free_items()
+{
+    size_t total = 0;
+    for (unsigned c = 0; c < NUM_CLASSES; ++c)
+    {
+        total += free_items(class_size(c));
+    }
+    return total;
+}
+
+size_t SlabPool::free_items(size_t size)
+{
+    unsigned c = size_class(size);
+    if (c >= NUM_CLASSES)
+    {
+        return 0;
+    }
+    Stats s;
+    get_stats(c, &s);
+    return s.depotFree + s.cachedFree;
+}
+
+void SlabPool::get_stats(unsigned size_class, Stats *stats)
+{
+    HASSERT(size_class < NUM_CLASSES);
+    memset(stats, 0, sizeof(*stats));
+    stats->objectSize = class_size(size_class);
+    AtomicHolder h(&lock_);
+    const SizeClass &sc = classes_[size_class];
+    stats->slabs = sc.slabs;
+    stats->objects = sc.objects;
+    stats->depotFree = sc.depotCount;
+    stats->hits = sc.hits;
+    stats->misses = sc.misses;
+    // The magazines are read without synchronization with their threads, so
+    // these numbers are approximate.
+    for (ThreadCache *tc = caches_; tc; tc = tc->next)
+    {
+        const Magazine &m = tc->magazines[size_class];
+        stats->cachedFree += m.count;
+        stats->hits += m.hits;
+        stats->misses += m.misses;
+    }
+    stats->inUse = stats->objects - stats->depotFree - stats->cachedFree;
+}
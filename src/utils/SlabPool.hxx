@@ -0,0 +1,229 @@
+/** \copyright
+ * Copyright (c) 2026, Balazs Racz
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are  permitted provided that the following conditions are met:
+ *
+ *  - Redistributions of source code must retain the above copyright notice,
+ *    this list of conditions and the following disclaimer.
+ *
+ *  - Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+ * ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE
+ * LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+ * CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+ * SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+ * INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+ * CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+ * ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ * POSSIBILITY OF SUCH DAMAGE.
+ *
+ * \file SlabPool.hxx
+ *
+ * Size-class slab allocator with per-thread caches for the main buffer pool.
+ *
+ * @author Balazs Racz
+ * @date 16 October 2026
+ */
+
+#ifndef _UTILS_SLABPOOL_HXX_
+#define _UTILS_SLABPOOL_HXX_
+
+#include <stdint.h>
+
+#include "utils/Buffer.hxx"
+
+/// Buffer pool that serves allocations from power-of-two size classes carved
+/// out of larger slabs, with a small per-thread cache (magazine) of free
+/// objects for each size class.
+///
+/// Allocating and freeing a buffer on a thread that has objects in its
+/// magazine takes no lock at all. When the magazine runs empty it is refilled
+/// with a batch of objects from the global depot of the size class; when it
+/// is full, half of it is returned to the depot. Buffers freed on a different
+/// thread than where they were allocated thus flow back to the allocating
+/// thread through the depot. Only the depot operations and the allocation of
+/// new slabs take the pool lock.
+///
+/// The thread cache is bound to the first SlabPool that a given thread uses
+/// (normally the mainBufferPool). Other SlabPool instances on the same thread
+/// always go to the depot. Allocations larger than the largest size class are
+/// served from the heap directly.
+///
+/// Selected as the implementation of the mainBufferPool with
+/// OPENMRN_FEATURE_BUFFER_SLAB=1.
+class SlabPool : public DynamicPool
+{
+public:
+    /// log2 of the smallest size class in bytes.
+    static constexpr unsigned MIN_SHIFT = 5;
+    /// Number of size classes. The largest class is 1 << (MIN_SHIFT +
+    /// NUM_CLASSES - 1) bytes.
+    static constexpr unsigned NUM_CLASSES = 8;
+    /// How many free objects a thread caches at most per size class.
+    static constexpr unsigned MAGAZINE_SIZE = 8;
+    /// Approximate number of bytes to allocate from the heap when a size
+    /// class runs out of free objects. Size classes larger than this get one
+    /// object per slab.
+    static constexpr unsigned SLAB_BYTES = 1024;
+
+    /// Statistics of one size class.
+    struct Stats
+    {
+        /// Size of the objects in this class, in bytes.
+        unsigned objectSize;
+        /// How many slabs were allocated from the heap for this class.
+        unsigned slabs;
+        /// How many objects were carved out of these slabs.
+        unsigned objects;
+        /// How many objects are currently allocated by the application.
+        unsigned inUse;
+        /// How many free objects are in the depot.
+        unsigned depotFree;
+        /// How many free objects are in the thread caches.
+        unsigned cachedFree;
+        /// Allocations that were served from the thread cache.
+        unsigned hits;
+        /// Allocations that had to go to the depot (or allocate a new slab).
+        unsigned misses;
+    };
+
+    SlabPool();
+    ~SlabPool();
+
+    /** Number of free items in the pool.
+     * @return number of free items in the pool
+     */
+    size_t free_items() override;
+
+    /** Number of free items in the pool for a given allocation size.
+     * @param size size of interest
+     * @return number of free items in the pool for a given allocation size
+     */
+    size_t free_items(size_t size) override;
+
+    /// Fills in the statistics of a size class.
+    /// @param size_class is the index of the size class, 0 <= size_class <
+    /// NUM_CLASSES.
+    /// @param stats will be filled with the current statistics.
+    void get_stats(unsigned size_class, Stats *stats);
+
+    /// @return the object size of a given size class in bytes.
+    /// @param size_class is the index of the size class.
+    static constexpr size_t class_size(unsigned size_class)
+    {
+        return size_t(1) << (MIN_SHIFT + size_class);
+    }
+
+private:
+    /// Overlay on a free object to link it into the depot.
+    struct FreeObject
+    {
+        FreeObject *next;
+    };
+
+    /// Per-thread cache of free objects for one size class.
+    struct Magazine
+    {
+        /// Number of valid entries in objects.
+        unsigned count;
+        /// Allocations served from this magazine.
+        unsigned hits;
+        /// Allocations that had to refill this magazine.
+        unsigned misses;
+        /// Free objects, the last one is allocated next.
+        void *objects[MAGAZINE_SIZE];
+    };
+
+    /// Per-thread cache of the pool.
+    struct ThreadCache
+    {
+        /// The pool this cache belongs to.
+        SlabPool *owner;
+        /// Links all caches of the pool for the statistics.
+        ThreadCache *next;
+        /// One magazine per size class.
+        Magazine magazines[NUM_CLASSES];
+    };
+
+    /// Global state of one size class. Protected by lock_.
+    struct SizeClass
+    {
+        /// Linked list of free objects.
+        FreeObject *depot;
+        /// Number of entries in depot.
+        unsigned depotCount;
+        /// Number of slabs allocated.
+        unsigned slabs;
+        /// Number of objects carved out of slabs.
+        unsigned objects;
+        /// Hits of the caches of exited threads.
+        unsigned hits;
+        /// Misses counted for threads without a cache, and misses of the
+        /// caches of exited threads.
+        unsigned misses;
+    };
+
+    /** Get a free item out of the pool.
+     * @param size tells how much to allocate (in bytes)
+     * @param flow if !NULL, then the alloc call is considered async and will
+     *        behave as if @ref alloc_async() was called.
+     * @return the allocated buffer.
+     */
+    BufferBase *alloc_untyped(size_t size, Executable *flow) override;
+
+    /** Releases an item back to the free pool.
+     * @param item pointer to item to release
+     */
+    void free(BufferBase *item) override;
+
+    /// @return the size class for an allocation of size bytes, or NUM_CLASSES
+    /// if the allocation is too large.
+    /// @param size is the allocation size in bytes.
+    static unsigned size_class(size_t size);
+
+    /// @return the cache of the current thread, or nullptr if the current
+    /// thread's cache belongs to a different pool. Creates the cache on the
+    /// first call of a thread.
+    ThreadCache *thread_cache();
+
+    /// Creates the thread-specific key whose destructor releases the thread
+    /// caches. Called once.
+    static void thread_key_init();
+
+    /// Returns the free objects of a thread cache to the depot of its pool,
+    /// and frees the cache. Called when the thread exits (on platforms with
+    /// pthread keys). @param cache is the ThreadCache of the exiting thread.
+    static void release_thread_cache(void *cache);
+
+    /// Moves up to count objects from the depot of a size class to an array.
+    /// Allocates a new slab if the depot is empty.
+    /// @param c is the size class.
+    /// @param objects is the destination array.
+    /// @param count how many objects to move at most.
+    /// @return how many objects were moved (at least one).
+    unsigned take(unsigned c, void **objects, unsigned count);
+
+    /// Returns objects from an array to the depot of a size class.
+    /// @param c is the size class.
+    /// @param objects is the source array.
+    /// @param count how many objects to move.
+    void give(unsigned c, void **objects, unsigned count);
+
+    /// Protects classes_, caches_ and the totalSize.
+    ::Atomic lock_;
+    /// State of the size classes.
+    SizeClass classes_[NUM_CLASSES];
+    /// All thread caches of this pool.
+    ThreadCache *caches_ {nullptr};
+
+    DISALLOW_COPY_AND_ASSIGN(SlabPool);
+};
+
+#endif // _UTILS_SLABPOOL_HXX_
@@ -85,6 +85,14 @@
  * vs the overhead used by the framework.
  */
 
+/** @var _sym_executor_run_budget
+ *
+ * @brief How many Executables to take from each priority band in one batch
+ * of the executor loop. 0 disables the batch mode. Larger batches mean fewer
+ * timer checks and select calls per Executable, at the cost of higher
+ * priority work waiting until the batch is finished.
+ */
+
 /** @var _sym_can_tx_buffer_size
  * @brief default software buffer size for CAN transmission
  */
@@ -120,6 +128,12 @@
  * the hope that we can complete the buffers.
  */
 
+/** @var _sym_gridconnect_buffer_adaptive
+ *
+ * @brief If true, the delay of outgoing gridconnect bytes follows the packet
+ * rate, with gridconnect_buffer_delay_usec as the maximum latency.
+ */
+
 /**
  * @}
  */
@@ -131,6 +145,7 @@ DEFAULT_CONST(main_thread_priority, 0xdefa01);
 DEFAULT_CONST(main_thread_stack_size, 2048);
 DEFAULT_CONST(executor_max_sleep_msec, 40);
 DEFAULT_CONST(executor_select_prescaler, 5);
+DEFAULT_CONST(executor_run_budget, 0);
 
 DEFAULT_CONST(can_tx_buffer_size, 16);
 DEFAULT_CONST(can_rx_buffer_size, 16);
@@ -142,6 +157,7 @@ DEFAULT_CONST(gc_generate_newlines, 0);
 
 DEFAULT_CONST(gridconnect_buffer_size, 65);
 DEFAULT_CONST(gridconnect_buffer_delay_usec, 300);
+DEFAULT_CONST_FALSE(gridconnect_buffer_adaptive);
 
 /// Number of pending packets per inbound gridconnect port. There is memory
 /// cost associated with setting this number high.
@@ -150,6 +166,10 @@ DEFAULT_CONST(gridconnect_port_max_incoming_packets, 6);
 DEFAULT_CONST(gridconnect_bridge_max_incoming_packets, 1);
 /// 1 = infinite
 DEFAULT_CONST(gridconnect_bridge_max_outgoing_packets, 1);
+/// 0 = infinite
+DEFAULT_CONST(gridconnect_port_write_queue_limit, 0);
+/// Drop oldest.
+DEFAULT_CONST(gridconnect_port_write_queue_policy, 1);
 
 DEFAULT_CONST_FALSE(gridconnect_tcp_use_select);
 
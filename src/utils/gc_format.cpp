@@ -34,10 +34,15 @@
 //#define LOGLEVEL VERBOSE
 
 #include <stdint.h>
+#include <string.h>
 #include "utils/logging.h"
 #include "utils/gc_format.h"
 #include "can_frame.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 extern "C" {
 
 /** Build an ASCII character representation of a nibble value (uppercase hex).
@@ -56,6 +61,7 @@ static char nibble_to_ascii(int nibble)
     return ('A' + (nibble - 10));
 }
 
+#if !defined(__SSE2__)
 /** Tries to parse a hex character to a nibble. Understands both upper and
     lowercase hex.
     @param c is the character to convert.
@@ -77,21 +83,117 @@ static int ascii_to_nibble(const char c)
     }
     return -1;
 }
+#endif // !__SSE2__
 
+/** Converts 16 bytes to 32 uppercase hex characters.
+ * @param src is the input (16 bytes).
+ * @param dst is the output (32 characters, not terminated).
+ */
+static void hex_encode16(const uint8_t *src, char *dst)
+{
+#if defined(__SSE2__)
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i letter_offset = _mm_set1_epi8('A' - '0' - 10);
+    __m128i in = _mm_loadu_si128((const __m128i *)src);
+    __m128i lo = _mm_and_si128(in, mask);
+    __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 4), mask);
+    __m128i n[2] = {_mm_unpacklo_epi8(hi, lo), _mm_unpackhi_epi8(hi, lo)};
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        __m128i letter =
+            _mm_and_si128(_mm_cmpgt_epi8(n[i], nine), letter_offset);
+        __m128i c = _mm_add_epi8(_mm_add_epi8(n[i], zero_char), letter);
+        _mm_storeu_si128((__m128i *)(dst + 16 * i), c);
+    }
+#else
+    for (unsigned i = 0; i < 16; ++i)
+    {
+        dst[2 * i] = nibble_to_ascii(src[i] >> 4);
+        dst[2 * i + 1] = nibble_to_ascii(src[i]);
+    }
+#endif
+}
 
-int gc_format_parse(const char* buf, struct can_frame* can_frame)
+/** Converts 32 hex characters (upper or lowercase) to 16 bytes.
+ * @param src is the input (32 characters).
+ * @param dst is the output (16 bytes).
+ * @return false if there was an invalid character in the input; in this case
+ * the output is undefined.
+ */
+static bool hex_decode16(const char *src, uint8_t *dst)
+{
+#if defined(__SSE2__)
+    const __m128i minus_one = _mm_set1_epi8(-1);
+    const __m128i ten = _mm_set1_epi8(10);
+    const __m128i six = _mm_set1_epi8(6);
+    const __m128i zero_char = _mm_set1_epi8('0');
+    const __m128i upper_a = _mm_set1_epi8('A');
+    const __m128i case_mask = _mm_set1_epi8((char)0xDF);
+    const __m128i low_byte = _mm_set1_epi16(0x00ff);
+    __m128i words[2];
+    for (unsigned i = 0; i < 2; ++i)
+    {
+        __m128i c = _mm_loadu_si128((const __m128i *)(src + 16 * i));
+        __m128i digit = _mm_sub_epi8(c, zero_char);
+        __m128i is_digit = _mm_and_si128(
+            _mm_cmpgt_epi8(digit, minus_one), _mm_cmplt_epi8(digit, ten));
+        __m128i letter = _mm_sub_epi8(_mm_and_si128(c, case_mask), upper_a);
+        __m128i is_letter = _mm_and_si128(
+            _mm_cmpgt_epi8(letter, minus_one), _mm_cmplt_epi8(letter, six));
+        if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) != 0xffff)
+        {
+            return false;
+        }
+        __m128i nibble = _mm_or_si128(_mm_and_si128(is_digit, digit),
+            _mm_and_si128(is_letter, _mm_add_epi8(letter, ten)));
+        // Each 16-bit lane has the high nibble in the low byte and the low
+        // nibble in the high byte.
+        words[i] = _mm_or_si128(
+            _mm_slli_epi16(_mm_and_si128(nibble, low_byte), 4),
+            _mm_srli_epi16(nibble, 8));
+    }
+    _mm_storeu_si128((__m128i *)dst, _mm_packus_epi16(words[0], words[1]));
+    return true;
+#else
+    for (unsigned i = 0; i < 16; ++i)
+    {
+        int nh = ascii_to_nibble(src[2 * i]);
+        int nl = ascii_to_nibble(src[2 * i + 1]);
+        if (nh < 0 || nl < 0)
+        {
+            return false;
+        }
+        dst[i] = (nh << 4) | nl;
+    }
+    return true;
+#endif
+}
+
+/** Parses a GridConnect packet that ends at a given pointer or at a ';' or
+ * \0 character, whichever comes first.
+ *
+ * @param buf is the start of the packet (the leading ':' is optional).
+ * @param end is the end of the buffer.
+ * @param can_frame is the output frame.
+ * @return 0 in case of success, -1 if there was a packet format error (in this
+ * case the frame is set to an error frame).
+ */
+static int gc_format_parse_range(
+    const char *buf, const char *end, struct can_frame *can_frame)
 {
     CLR_CAN_FRAME_ERR(*can_frame);
-    if (*buf == ':')
+    if (buf < end && *buf == ':')
     {
         // skip leading :
         ++buf;
     }
-    if (*buf == 'X')
+    if (buf < end && *buf == 'X')
     {
         SET_CAN_FRAME_EFF(*can_frame);
     }
-    else if (*buf == 'S') 
+    else if (buf < end && *buf == 'S') 
     {
         CLR_CAN_FRAME_EFF(*can_frame);
     } else
@@ -101,37 +203,54 @@ int gc_format_parse(const char* buf, struct can_frame* can_frame)
         return -1;
     }
     buf++;
-    uint32_t id = 0;
-    while (1)
+    // Locates the end of the identifier and the end of the payload.
+    const char *id_start = buf;
+    while (buf < end && *buf != 'N' && *buf != 'R' && *buf != ';' && *buf)
     {
-        int nibble = ascii_to_nibble(*buf);
-        if (nibble >= 0)
-        {
-            id <<= 4;
-            id |= nibble;
-            ++buf;
-        }
-        else if (*buf == 'N')
-        {
-            // end of ID, frame is coming.
-            CLR_CAN_FRAME_RTR(*can_frame);
-            ++buf;
-            break;
-        }
-        else if (*buf == 'R')
-        {
-            // end of ID, remote frame is coming.
-            SET_CAN_FRAME_RTR(*can_frame);
-            ++buf;
-            break;
-        }
-        else
-        {
-            // This character should not happen here.
-            SET_CAN_FRAME_ERR(*can_frame);
-            return -1;
-        }
-    } // while parsing ID
+        ++buf;
+    }
+    if (buf >= end || (*buf != 'N' && *buf != 'R'))
+    {
+        // This character should not happen here.
+        SET_CAN_FRAME_ERR(*can_frame);
+        return -1;
+    }
+    unsigned id_len = buf - id_start;
+    if (*buf == 'R')
+    {
+        // end of ID, remote frame is coming.
+        SET_CAN_FRAME_RTR(*can_frame);
+    }
+    else
+    {
+        // end of ID, frame is coming.
+        CLR_CAN_FRAME_RTR(*can_frame);
+    }
+    const char *data_start = ++buf;
+    while (buf < end && *buf != ';' && *buf)
+    {
+        ++buf;
+    }
+    unsigned data_len = buf - data_start;
+    if (id_len > 8 || data_len > 16 || (data_len & 1))
+    {
+        SET_CAN_FRAME_ERR(*can_frame);
+        return -1;
+    }
+    // Right-aligns the identifier in the first 8 characters, then the payload,
+    // padded with zeros to 16 bytes.
+    char hex[32];
+    memset(hex, '0', sizeof(hex));
+    memcpy(hex + 8 - id_len, id_start, id_len);
+    memcpy(hex + 8, data_start, data_len);
+    uint8_t raw[16];
+    if (!hex_decode16(hex, raw))
+    {
+        SET_CAN_FRAME_ERR(*can_frame);
+        return -1;
+    }
+    uint32_t id = ((uint32_t)raw[0] << 24) | ((uint32_t)raw[1] << 16) |
+        ((uint32_t)raw[2] << 8) | raw[3];
     if (IS_CAN_FRAME_EFF(*can_frame))
     {
         SET_CAN_FRAME_ID_EFF(*can_frame, id);
@@ -140,31 +259,58 @@ int gc_format_parse(const char* buf, struct can_frame* can_frame)
     { 
         SET_CAN_FRAME_ID(*can_frame, id);
     }
-    int index = 0;
-    while ((*buf != 0) && (*buf != ';'))
-    {
-        int nh = ascii_to_nibble(*buf++);
-        int nl = ascii_to_nibble(*buf++);
-        if (nh < 0 || nl < 0)
-        {
-            SET_CAN_FRAME_ERR(*can_frame);
-            return -1;
-        }
-        can_frame->data[index++] = (nh << 4) | nl;
-    } // while parsing data
-    can_frame->can_dlc = index;
+    memcpy(can_frame->data, raw + 4, data_len / 2);
+    can_frame->can_dlc = data_len / 2;
     CLR_CAN_FRAME_ERR(*can_frame);
     return 0;
 }
 
-/// Helper function for appending to a buffer ONCE.
-///
-/// @param dst buffer to append data to
-/// @param value one character to append to.
-///
-static void output_single(char*& dst, char value)
+int gc_format_parse(const char* buf, struct can_frame* can_frame)
 {
-    *dst++ = value;
+    return gc_format_parse_range(buf, buf + strlen(buf), can_frame);
+}
+
+size_t gc_format_parse_bulk(const char *buf, size_t len,
+    struct can_frame *frames, size_t max_frames, size_t *consumed)
+{
+    const char *p = buf;
+    const char *end = buf + len;
+    size_t count = 0;
+    while (count < max_frames)
+    {
+        const char *start = (const char *)memchr(p, ':', end - p);
+        if (!start)
+        {
+            // Only garbage left.
+            p = end;
+            break;
+        }
+        const char *stop = (const char *)memchr(start, ';', end - start);
+        if (!stop)
+        {
+            // Partial packet; keep it for the next call.
+            p = start;
+            break;
+        }
+        // A ':' inside the packet starts a new packet.
+        const char *restart =
+            (const char *)memchr(start + 1, ':', stop - start - 1);
+        if (restart)
+        {
+            p = restart;
+            continue;
+        }
+        if (gc_format_parse_range(start, stop, frames + count) == 0)
+        {
+            ++count;
+        }
+        p = stop + 1;
+    }
+    if (consumed)
+    {
+        *consumed = p - buf;
+    }
+    return count;
 }
 
 /// Helper function for appending to a buffer TWICE. Used in the implementation
@@ -179,6 +325,59 @@ static void output_double(char*& dst, char value)
     *dst++ = value;
 }
 
+/** Formats a can frame in the (non-doubled) GridConnect protocol using the
+ * bulk hex converter.
+ *
+ * @param can_frame is the input frame; must not be an error frame.
+ * @param buf is the output buffer (at least 29 bytes).
+ * @return the pointer to the buffer character after the formatted can frame.
+ */
+static char *gc_format_generate_single(
+    const struct can_frame *can_frame, char *buf)
+{
+    uint8_t raw[16];
+    uint32_t id;
+    if (IS_CAN_FRAME_EFF(*can_frame))
+    {
+        id = GET_CAN_FRAME_ID_EFF(*can_frame);
+    }
+    else
+    {
+        id = GET_CAN_FRAME_ID(*can_frame);
+    }
+    raw[0] = id >> 24;
+    raw[1] = id >> 16;
+    raw[2] = id >> 8;
+    raw[3] = id;
+    memcpy(raw + 4, can_frame->data, 8);
+    memset(raw + 12, 0, 4);
+    char hex[32];
+    hex_encode16(raw, hex);
+    *buf++ = ':';
+    if (IS_CAN_FRAME_EFF(*can_frame))
+    {
+        *buf++ = 'X';
+        memcpy(buf, hex, 8);
+        buf += 8;
+    }
+    else
+    {
+        *buf++ = 'S';
+        memcpy(buf, hex + 5, 3);
+        buf += 3;
+    }
+    /* handle remote or normal */
+    *buf++ = IS_CAN_FRAME_RTR(*can_frame) ? 'R' : 'N';
+    unsigned dlc = can_frame->can_dlc > 8 ? 8 : can_frame->can_dlc;
+    memcpy(buf, hex + 8, 2 * dlc);
+    buf += 2 * dlc;
+    *buf++ = ';';
+    if (config_gc_generate_newlines() == CONSTANT_TRUE) {
+        *buf++ = '\n';
+    }
+    return buf;
+}
+
 /** Formats a can frame in the GridConnect protocol.
 
     If requested, it can create the double protocol with leading !!, trailing ;;
@@ -203,17 +402,12 @@ char* gc_format_generate(const struct can_frame* can_frame, char* buf, int doubl
         LOG(VERBOSE, "GC generate: incoming frame ERR.");
         return buf;
     }
-    void (*output)(char*& dst, char value);
-    if (double_format)
-    {
-        output = output_double;
-        output(buf, '!');
-    }
-    else
+    if (!double_format)
     {
-        output = output_single;
-        output(buf, ':');
+        return gc_format_generate_single(can_frame, buf);
     }
+    void (*output)(char*& dst, char value) = output_double;
+    output(buf, '!');
     uint32_t id;
     int offset;
     if (IS_CAN_FRAME_EFF(*can_frame))
@@ -253,4 +447,15 @@ char* gc_format_generate(const struct can_frame* can_frame, char* buf, int doubl
     return buf;
 }
 
+size_t gc_format_generate_bulk(const struct can_frame *frames, size_t count,
+    char *buf, int double_format)
+{
+    char *p = buf;
+    for (size_t i = 0; i < count; ++i)
+    {
+        p = gc_format_generate(frames + i, p, double_format);
+    }
+    return p - buf;
+}
+
 }
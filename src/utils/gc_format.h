@@ -34,6 +34,8 @@
 #ifndef _UTILS_GC_FORMAT_H_
 #define _UTILS_GC_FORMAT_H_
 
+#include <stddef.h>
+
 #include "utils/constants.hxx"
 
 #ifdef __cplusplus
@@ -79,6 +81,46 @@ int gc_format_parse(const char* buf, struct can_frame* can_frame);
 */
 char* gc_format_generate(const struct can_frame* can_frame, char* buf, int double_format);
 
+/** Parses all complete GridConnect packets from a buffer of characters.
+
+    Characters outside of packets are skipped. Packets that fail to parse are
+    dropped. The hex conversion uses SIMD instructions where available.
+
+    @param buf is the input character buffer (not necessarily terminated).
+
+    @param len is the number of characters in buf.
+
+    @param frames is the output array of CAN frames.
+
+    @param max_frames is the size of the frames array.
+
+    @param consumed if not NULL, will be set to the number of characters
+    processed. The remaining characters (a partial packet, or packets that did
+    not fit into frames) should be presented again in the next call.
+
+    @return the number of frames written to the output.
+*/
+size_t gc_format_parse_bulk(const char *buf, size_t len,
+    struct can_frame *frames, size_t max_frames, size_t *consumed);
+
+/** Formats an array of can frames in the GridConnect protocol.
+
+    Error frames are skipped.
+
+    @param frames is the input array.
+
+    @param count is the number of frames in the input.
+
+    @param buf is the output buffer. The caller must ensure this is big enough
+    to hold the resulting frames (29 or 58 bytes per frame).
+
+    @param double_format if non-zero, the doubling format will be generated.
+
+    @return the number of characters written to buf.
+*/
+size_t gc_format_generate_bulk(const struct can_frame *frames, size_t count,
+    char *buf, int double_format);
+
 #ifdef __cplusplus
 }
 #endif